@@ -0,0 +1,831 @@
+// src/BenchISY.c
+#define _GNU_SOURCE     // recvmmsg / struct mmsghdr (Linux)
+#include "Commun.h"
+
+#include <signal.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+/*
+    ─────────────────────────────────────────────────────────────────────────
+    BenchISY (make isy-bench)
+    ─────────────────────────────────────────────────────────────────────────
+    Rôle :
+      - Générateur de charge : N clients simulés sur la boucle locale, sans UI,
+        contre un ServeurISY déjà lancé (adresse lue dans conf/server.conf).
+      - Déroulé :
+          1) CREATE de G groupes, puis JOIN de chaque client (client i -> groupe i % G)
+             et handshake "(joined)" vers son groupe (latences CREATE / JOIN mesurées)
+          2) MSG à débit fixe (--rate msg/s au total, répartis entre les clients)
+             pendant --duration s ; chaque texte embarque l'horloge d'envoi :
+               "#B <client> <seq> <ns>" (+ bourrage jusqu'à --size octets)
+          3) réception pendant --drain ms après le dernier envoi
+      - Chaque diffusion reçue donne une latence de bout en bout (envoi client ->
+        groupe -> réception client, même horloge CLOCK_MONOTONIC) ; un message doit
+        être reçu par tous les membres de son groupe (lui compris) : attendus - reçus
+        = pertes.
+      - Pertes injectées (--loss p) : pendant la mesure, chaque datagramme reçu par
+        un client est jeté avec la probabilité p avant traitement (tirage
+        pseudo-aléatoire de graine --seed : mêmes pertes d'un passage à l'autre).
+        En binaire, chaque client remet les diffusions numérotées dans l'ordre
+        comme ClientISY (fenêtre, NACK des trous, GAP, abandon après relances) :
+        les latences incluent donc le temps de reprise. En texte, rien n'est repris.
+      - Résultat : résumé lisible sur stderr, une ligne JSON sur stdout (suivi des
+        régressions).
+
+    Usage :
+      BenchISY [server.conf] [--clients N] [--groups G] [--rate R] [--duration S]
+               [--size B] [--drain MS] [--proto text|bin] [--loss P] [--seed N]
+      --rate 0 : sans limite (un message par client à chaque tour de boucle).
+      --loss P : probabilité de perte injectée à la réception (0 <= P < 1).
+
+    Boucle (Linux) : un seul thread, epoll sur les sockets clients et un timerfd
+    (cadence d'envoi, 1 ms). Les groupes créés s'arrêtent d'eux-mêmes (inactivité).
+*/
+
+#ifdef __linux__
+
+#define BENCH_TICK_NS   1000000L   // cadence d'envoi (timerfd)
+#define BENCH_REPLY_MS  2000       // attente max d'une réponse serveur (CREATE / JOIN)
+#define BENCH_JOIN_MS   3000       // attente max des handshakes "(joined)"
+#define BENCH_RCVBUF    (4 << 20)  // tampon de réception de chaque client
+#define BENCH_TAG       "#B "      // début du texte d'un message de bench
+#define BENCH_RECV_BATCH 32        // datagrammes lus par recvmmsg
+#define GNAME_LEN       32         // nom de groupe (même taille que côté serveur)
+
+/* ───────────────────────── Histogramme ───────────────────────── */
+/*
+    Histogramme log-linéaire en ns : 64 cases par puissance de 2 (précision ~1.5 %),
+    de 0 à 2^40 ns. Case de v : v si v < 128, sinon 64*s + (v >> s) avec
+    s = log2(v) - 6.
+*/
+#define HIST_SUB   64
+#define HIST_MAXLG 40
+#define HIST_N     (HIST_SUB * (HIST_MAXLG - 5))
+
+typedef struct {
+    uint64_t c[HIST_N];
+    uint64_t n;
+    uint64_t max;
+} Hist;
+
+static unsigned hist_idx(uint64_t v){
+    if(v >= (1ull << HIST_MAXLG)) v = (1ull << HIST_MAXLG) - 1;
+    if(v < 2 * HIST_SUB) return (unsigned)v;
+    unsigned s = (unsigned)(63 - __builtin_clzll(v)) - 6;
+    return HIST_SUB * s + (unsigned)(v >> s);
+}
+
+/* Milieu de la case k (ns) */
+static double hist_val(unsigned k){
+    if(k < 2 * HIST_SUB) return (double)k;
+    unsigned s = k / HIST_SUB - 1;
+    uint64_t lo = (uint64_t)(k - HIST_SUB * s) << s;
+    return (double)lo + (double)(1ull << s) / 2.0;
+}
+
+static void hist_add(Hist *h, uint64_t v){
+    h->c[hist_idx(v)]++;
+    h->n++;
+    if(v > h->max) h->max = v;
+}
+
+/* Quantile q (0..1) en µs, 0 si vide */
+static double hist_q_us(const Hist *h, double q){
+    if(!h->n) return 0.0;
+    uint64_t want = (uint64_t)(q * (double)h->n);
+    if(want >= h->n) want = h->n - 1;
+
+    uint64_t acc = 0;
+    for(unsigned k=0;k<HIST_N;k++){
+        acc += h->c[k];
+        if(acc > want){
+            double v = hist_val(k);
+            return (v < (double)h->max ? v : (double)h->max) / 1000.0;
+        }
+    }
+    return (double)h->max / 1000.0;
+}
+
+/* ───────────────────────── État ───────────────────────── */
+
+typedef struct {
+    char name[GNAME_LEN];
+    uint16_t port;
+    int gid;                    // mono-port : gid du groupe, -1 sinon
+    struct sockaddr_in addr;    // destination des MSG
+    unsigned members;           // clients ayant terminé le handshake
+} BGroup;
+
+/* Nature d'une diffusion reçue (classée à l'arrivée, comptée à la remise) */
+#define BK_NONE     0
+#define BK_BENCH    1       // message de bench : ts = horloge d'envoi
+#define BK_FOREIGN  2       // "#B ..." illisible
+#define BK_JOINED   3       // écho de son propre "(joined)"
+
+/* Diffusion classée : ce qu'une case de la fenêtre garde (la trame elle-même n'est pas gardée) */
+typedef struct {
+    uint8_t  kind;
+    uint64_t ts;
+} RxSlot;
+
+/*
+    Client simulé. En binaire, flux numéroté remis dans l'ordre par la fenêtre
+    commune (ISYRx, Commun.h), comme dans ClientISY ; win = contenu des cases.
+*/
+typedef struct {
+    int fd;
+    unsigned group;
+    int joined;
+    uint32_t seq;
+    char user[EME_LEN];
+
+    ISYRx    rx;
+    RxSlot  *win;
+} BClient;
+
+typedef struct {
+    char     srv_ip[64];
+    uint16_t srv_port;
+    unsigned clients;
+    unsigned groups;
+    double   rate;              // msg/s au total (0 = sans limite)
+    double   duration;          // s
+    unsigned size;              // octets de texte par message
+    unsigned drain_ms;
+    int      bin;               // trames binaires (sinon texte)
+    double   loss;              // probabilité de perte injectée à la réception
+    uint64_t seed;              // graine du tirage des pertes
+} BenchConf;
+
+static BenchConf bc;
+static BGroup  *bgroups;
+static BClient *bclients;
+static unsigned *senders;           // clients ayant fini le handshake (seuls émetteurs)
+static unsigned  nsenders;
+static int       loss_on;           // injection active (phase de mesure)
+static uint64_t  rng;
+static volatile sig_atomic_t stop_req = 0;
+
+static struct {
+    uint64_t sent, send_err;
+    uint64_t expected, delivered, foreign;
+    uint64_t dropped;                   // datagrammes jetés par --loss
+    uint64_t nacks, recovered, dups, gap_lost;   // sommes des fenêtres clients (bench_report)
+    Hist create, join, lat;
+} st;
+
+static void on_sigint(int sig){
+    (void)sig;
+    stop_req = 1;
+}
+
+static uint64_t mono_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Perte injectée ? (xorshift64*, reproductible à graine égale) */
+static int loss_draw(void){
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    uint64_t x = rng * 0x2545F4914F6CDD1Dull;
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0) < bc.loss;
+}
+
+/* SERVER_IP / SERVER_PORT de server.conf (0.0.0.0 => 127.0.0.1) */
+static int load_conf(const char *path, BenchConf *c){
+    FILE *f = fopen(path, "r");
+    if(!f) return -1;
+
+    char line[256], k[64], v[64];
+    while(fgets(line, sizeof line, f)){
+        char *hash = strchr(line, '#');
+        if(hash) *hash = '\0';
+        if(sscanf(line, "%63[^=]=%63s", k, v) != 2) continue;
+
+        if(!strcmp(k, "SERVER_IP"))        isy_strcpy(c->srv_ip, sizeof c->srv_ip, v);
+        else if(!strcmp(k, "SERVER_PORT")) c->srv_port = (uint16_t)atoi(v);
+    }
+    fclose(f);
+
+    if(!strcmp(c->srv_ip, "0.0.0.0")) isy_strcpy(c->srv_ip, sizeof c->srv_ip, "127.0.0.1");
+    return 0;
+}
+
+/* ───────────────────────── Requêtes serveur ───────────────────────── */
+
+/*
+    Envoie une requête CREATE / JOIN (texte ou binaire selon bc.bin) et attend la
+    réponse OK : remplit port / gid du groupe. Retourne la latence (ns), 0 si échec
+    (why = réponse reçue, ou "timeout").
+*/
+static uint64_t srv_request(int s, const struct sockaddr_in *srv, int create,
+                            BGroup *g, const char *user, uint16_t cport,
+                            char *why, size_t wsz){
+    uint8_t out[ISY_BIN_MAX];
+    size_t n;
+
+    if(bc.bin){
+        ISYWr w;
+        isy_bin_begin(&w, out, sizeof out, create ? ISY_OP_CREATE : ISY_OP_JOIN, 0, ISY_BIN_NOGID, 0);
+        isy_bin_cstr(&w, g->name);
+        isy_bin_cstr(&w, user);
+        n = isy_bin_end(&w);
+    }else if(create){
+        n = (size_t)snprintf((char*)out, sizeof out, "CREATE %s %s", g->name, user);
+    }else{
+        n = (size_t)snprintf((char*)out, sizeof out, "JOIN %s %s 127.0.0.1 %u", g->name, user, (unsigned)cport);
+    }
+
+    uint64_t t0 = mono_ns();
+    if(sendto(s, out, n, 0, (const struct sockaddr*)srv, sizeof *srv) < 0){
+        snprintf(why, wsz, "sendto: %s", strerror(errno));
+        return 0;
+    }
+
+    struct pollfd pf = { s, POLLIN, 0 };
+    if(poll(&pf, 1, BENCH_REPLY_MS) != 1){
+        snprintf(why, wsz, "timeout");
+        return 0;
+    }
+
+    char in[ISY_BIN_MAX + 1];
+    ssize_t r = recv(s, in, sizeof in - 1, 0);
+    uint64_t dt = mono_ns() - t0;
+    if(r <= 0){
+        snprintf(why, wsz, "recv: %s", strerror(errno));
+        return 0;
+    }
+    in[r] = '\0';
+
+    ISYHdr h;
+    ISYRd rd;
+    int fr = isy_bin_parse(in, (size_t)r, &h, &rd);
+    if(fr == 1){
+        if(h.op != ISY_OP_OK){
+            char reason[64] = "?";
+            if(h.op == ISY_OP_ERR) (void)isy_rd_cstr(&rd, reason, sizeof reason);
+            snprintf(why, wsz, "ERR %s", reason);
+            return 0;
+        }
+        size_t nl;
+        (void)isy_rd_str(&rd, &nl);
+        g->port = isy_rd_u16(&rd);
+        g->gid = (h.gid == ISY_BIN_NOGID) ? -1 : (int)h.gid;
+    }else{
+        // "OK <group> <port> [token|-] [@<gid>]"
+        unsigned port = 0;
+        if(strncmp(in, "OK ", 3) != 0 || sscanf(in + 3, "%*s %u", &port) != 1){
+            trimnl(in);
+            snprintf(why, wsz, "%s", in);
+            return 0;
+        }
+        g->port = (uint16_t)port;
+        char *at = strchr(in, ISY_MUX_TAG);
+        g->gid = at ? atoi(at + 1) : -1;
+    }
+    return dt ? dt : 1;
+}
+
+/* ───────────────────────── Messages client -> groupe ───────────────────────── */
+
+/* Envoie "MSG <user> <text>" au groupe du client (préfixe @gid / gid d'en-tête en mono-port) */
+static int client_send(const BClient *c, const char *text, size_t tlen){
+    const BGroup *g = &bgroups[c->group];
+    uint8_t out[ISY_BIN_MAX];
+    size_t n;
+
+    if(bc.bin){
+        ISYWr w;
+        isy_bin_begin(&w, out, sizeof out, ISY_OP_MSG, 0,
+                      g->gid >= 0 ? (uint32_t)g->gid : ISY_BIN_NOGID, 0);
+        isy_bin_cstr(&w, c->user);
+        isy_bin_str(&w, text, tlen);
+        n = isy_bin_end(&w);
+    }else{
+        int k = (g->gid >= 0) ? snprintf((char*)out, sizeof out, "%c%d ", ISY_MUX_TAG, g->gid) : 0;
+        k += snprintf((char*)out + k, sizeof out - (size_t)k, "MSG %s ", c->user);
+        if((size_t)k + tlen > sizeof out) return -1;
+        memcpy(out + k, text, tlen);
+        n = (size_t)k + tlen;
+    }
+
+    return sendto(c->fd, out, n, 0, (const struct sockaddr*)&g->addr, sizeof g->addr) < 0 ? -1 : 0;
+}
+
+/*
+    Texte porté par une diffusion reçue (ligne "... <user> : <texte>" ou trame CHAT) :
+    *user / *ulen = émetteur, retourne le texte (terminé par '\0'), NULL sinon.
+*/
+static const char *chat_text(char *buf, size_t n, const char **user, size_t *ulen){
+    ISYHdr h;
+    ISYRd r;
+    int fr = isy_bin_parse(buf, n, &h, &r);
+
+    if(fr == 1){
+        if(h.op != ISY_OP_CHAT) return NULL;
+        size_t gl, tl;
+        (void)isy_rd_str(&r, &gl);
+        *user = isy_rd_str(&r, ulen);
+        const char *t = isy_rd_str(&r, &tl);
+        if(r.err) return NULL;
+        char *tw = (char*)t;
+        tw[tl] = '\0';          // octet suivant la trame (buf a une place de plus)
+        return t;
+    }
+    if(fr < 0) return NULL;
+
+    buf[n] = '\0';
+    char *sep = strstr(buf, " : ");
+    if(!sep) return NULL;
+    char *u = sep;
+    while(u > buf && u[-1] != ' ') u--;
+    *user = u;
+    *ulen = (size_t)(sep - u);
+    return sep + 3;
+}
+
+/* Classe une diffusion reçue par le client c (BK_*) ; *ts = horloge d'envoi d'un message de bench */
+static int client_classify(const BClient *c, char *buf, size_t n, uint64_t *ts){
+    const char *user;
+    size_t ulen;
+    const char *text = chat_text(buf, n, &user, &ulen);
+    if(!text) return BK_NONE;
+
+    if(!strncmp(text, BENCH_TAG, strlen(BENCH_TAG))){
+        unsigned long from, seq;
+        unsigned long long t;
+        if(sscanf(text + strlen(BENCH_TAG), "%lu %lu %llu", &from, &seq, &t) != 3 ||
+           from >= bc.clients)
+            return BK_FOREIGN;
+        *ts = (uint64_t)t;
+        return BK_BENCH;
+    }
+
+    // Handshake : sa propre annonce "(joined)" revient => membre du groupe
+    if(!strcmp(text, "(joined)") && ulen == strlen(c->user) && !memcmp(user, c->user, ulen))
+        return BK_JOINED;
+    return BK_NONE;
+}
+
+/* Remise (dans l'ordre du flux) d'une diffusion classée */
+static void client_deliver(BClient *c, int kind, uint64_t ts){
+    switch(kind){
+    case BK_BENCH: {
+        uint64_t now = mono_ns();
+        hist_add(&st.lat, now > ts ? now - ts : 0);
+        st.delivered++;
+        break;
+    }
+    case BK_FOREIGN:
+        st.foreign++;
+        break;
+    case BK_JOINED:
+        if(!c->joined){
+            c->joined = 1;
+            bgroups[c->group].members++;
+        }
+        break;
+    }
+}
+
+/* ───────────────────────── Reprise (binaire) ───────────────────────── */
+
+static uint64_t mono_ms(void){
+    return mono_ns() / 1000000ull;
+}
+
+/* Rappels de la fenêtre (ISYRx) : arg = BClient, fr = RxSlot classé à l'arrivée */
+static void rx_on_store(void *arg, const void *fr, size_t n, unsigned slot){
+    (void)n;
+    ((BClient*)arg)->win[slot] = *(const RxSlot*)fr;
+}
+
+static void rx_on_deliver(void *arg, const void *fr, size_t n, unsigned slot){
+    BClient *c = (BClient*)arg;
+    const RxSlot *sl = fr ? (const RxSlot*)fr : &c->win[slot];
+    (void)n;
+    client_deliver(c, sl->kind, sl->ts);
+}
+
+/* NACK d'une plage manquante [from, from + n) vers le groupe du client */
+static void rx_on_nack(void *arg, uint32_t from, uint32_t n){
+    const BClient *c = (const BClient*)arg;
+    const BGroup *g = &bgroups[c->group];
+    uint8_t fr[ISY_BIN_HDR + 2];
+    ISYWr w;
+    isy_bin_begin(&w, fr, sizeof fr, ISY_OP_NACK, 0, g->gid >= 0 ? (uint32_t)g->gid : ISY_BIN_NOGID, from);
+    isy_bin_u16(&w, (uint16_t)n);
+    size_t len = isy_bin_end(&w);
+    if(len) (void)sendto(c->fd, fr, len, 0, (const struct sockaddr*)&g->addr, sizeof g->addr);
+}
+
+static const ISYRxOps rx_ops = { rx_on_store, rx_on_deliver, rx_on_nack, NULL };
+
+/* Relances échues de tous les clients (binaire) */
+static void rx_tick_all(void){
+    if(!bc.bin) return;
+    long long now = (long long)mono_ms();
+    for(unsigned i=0;i<bc.clients;i++) isy_rx_tick(&bclients[i].rx, now);
+}
+
+/* Traite une diffusion reçue par le client c : GAP, flux numéroté, ou remise directe */
+static void client_on_dgram(BClient *c, char *buf, size_t n){
+    if(c->win){
+        ISYHdr h;
+        ISYRd r;
+        const BGroup *g = &bgroups[c->group];
+        if(isy_bin_parse(buf, n, &h, &r) == 1 && (h.seq || h.op == ISY_OP_GAP)){
+            // mono-port : un autre flux (gid d'en-tête) ne touche pas la fenêtre
+            if(h.gid != (g->gid >= 0 ? (uint32_t)g->gid : ISY_BIN_NOGID)){
+                st.foreign++;
+                return;
+            }
+            if(h.op == ISY_OP_GAP){
+                unsigned cnt = isy_rd_u16(&r);
+                if(!r.err) isy_rx_gap(&c->rx, h.seq, cnt, (long long)mono_ms());
+                return;
+            }
+            RxSlot sl = { BK_NONE, 0 };
+            sl.kind = (uint8_t)client_classify(c, buf, n, &sl.ts);
+            isy_rx_frame(&c->rx, h.seq, &sl, sizeof sl, (long long)mono_ms());
+            return;
+        }
+    }
+
+    uint64_t ts = 0;
+    int kind = client_classify(c, buf, n, &ts);
+    client_deliver(c, kind, ts);
+}
+
+/*
+    Lit tout ce qui attend sur le socket du client ci, par lots recvmmsg : le coût
+    de réception du bench reste petit devant celui du groupe mesuré.
+*/
+static void client_recv(unsigned ci){
+    static char bufs[BENCH_RECV_BATCH][ISY_BIN_MAX + 2];
+    static struct iovec iov[BENCH_RECV_BATCH];
+    static struct mmsghdr mm[BENCH_RECV_BATCH];
+    BClient *c = &bclients[ci];
+
+    for(;;){
+        for(unsigned k=0;k<BENCH_RECV_BATCH;k++){
+            iov[k].iov_base = bufs[k];
+            iov[k].iov_len = sizeof bufs[k] - 1;
+            memset(&mm[k].msg_hdr, 0, sizeof mm[k].msg_hdr);
+            mm[k].msg_hdr.msg_iov = &iov[k];
+            mm[k].msg_hdr.msg_iovlen = 1;
+        }
+
+        int n = recvmmsg(c->fd, mm, BENCH_RECV_BATCH, MSG_DONTWAIT, NULL);
+        if(n <= 0) return;
+        for(int k=0;k<n;k++){
+            if(loss_on && loss_draw()){
+                st.dropped++;
+                continue;
+            }
+            client_on_dgram(c, bufs[k], mm[k].msg_len);
+        }
+        if(n < BENCH_RECV_BATCH) return;
+    }
+}
+
+/* ───────────────────────── Phases ───────────────────────── */
+
+/* CREATE des groupes puis JOIN + "(joined)" de chaque client */
+static void bench_setup(void){
+    struct sockaddr_in srv;
+    memset(&srv, 0, sizeof srv);
+    srv.sin_family = AF_INET;
+    srv.sin_port = htons(bc.srv_port);
+    if(inet_pton(AF_INET, bc.srv_ip, &srv.sin_addr) != 1) die_msg("SERVER_IP invalide");
+
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if(s < 0) die_perror("socket");
+
+    char why[128];
+    for(unsigned k=0;k<bc.groups;k++){
+        BGroup *g = &bgroups[k];
+        snprintf(g->name, sizeof g->name, "bench%ld_%u", (long)getpid(), k);
+
+        uint64_t dt = srv_request(s, &srv, 1, g, "bench", 0, why, sizeof why);
+        if(!dt){
+            fprintf(stderr, "[Bench] CREATE %s : %s\n", g->name, why);
+            exit(1);
+        }
+        hist_add(&st.create, dt);
+
+        g->addr = srv;
+        g->addr.sin_port = htons(g->port);
+    }
+
+    for(unsigned i=0;i<bc.clients;i++){
+        BClient *c = &bclients[i];
+        c->group = i % bc.groups;
+        snprintf(c->user, sizeof c->user, "u%u", i);
+
+        c->fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if(c->fd < 0) die_perror("socket client");
+        int rb = BENCH_RCVBUF;
+        (void)setsockopt(c->fd, SOL_SOCKET, SO_RCVBUF, &rb, sizeof rb);
+        if(bc.bin){
+            isy_rx_init(&c->rx, &rx_ops, c);
+            c->win = (RxSlot*)calloc(ISY_RX_WINDOW, sizeof *c->win);
+            if(!c->win) die_msg("calloc");
+        }
+
+        struct sockaddr_in a;
+        memset(&a, 0, sizeof a);
+        a.sin_family = AF_INET;
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(bind(c->fd, (struct sockaddr*)&a, sizeof a) < 0) die_perror("bind client");
+        socklen_t al = sizeof a;
+        (void)getsockname(c->fd, (struct sockaddr*)&a, &al);
+
+        BGroup tmp = bgroups[c->group];
+        uint64_t dt = srv_request(s, &srv, 0, &tmp, c->user, ntohs(a.sin_port), why, sizeof why);
+        if(!dt){
+            fprintf(stderr, "[Bench] JOIN %s (%s) : %s\n", tmp.name, c->user, why);
+            exit(1);
+        }
+        hist_add(&st.join, dt);
+    }
+    close(s);
+}
+
+/* Handshakes "(joined)" : renvoyés toutes les 100 ms jusqu'à l'écho (ou BENCH_JOIN_MS) */
+static unsigned bench_join(int ep){
+    struct epoll_event evs[64];
+    uint64_t until = mono_ns() + (uint64_t)BENCH_JOIN_MS * 1000000ull;
+    unsigned joined = 0;
+
+    while(joined < bc.clients && mono_ns() < until && !stop_req){
+        for(unsigned i=0;i<bc.clients;i++){
+            if(!bclients[i].joined) (void)client_send(&bclients[i], "(joined)", 8);
+        }
+
+        uint64_t next = mono_ns() + 100000000ull;
+        for(;;){
+            uint64_t now = mono_ns();
+            if(now >= next) break;
+            int ne = epoll_wait(ep, evs, 64, (int)((next - now) / 1000000ull) + 1);
+            for(int e=0;e<ne;e++){
+                if(evs[e].data.u32 < bc.clients) client_recv(evs[e].data.u32);
+            }
+            rx_tick_all();
+        }
+
+        joined = 0;
+        for(unsigned i=0;i<bc.clients;i++) joined += (unsigned)bclients[i].joined;
+    }
+    return joined;
+}
+
+/* Un message de bench depuis le client ci (membre de son groupe) */
+static void bench_send_one(unsigned ci){
+    BClient *c = &bclients[ci];
+
+    char text[TXT_LEN];
+    int k = snprintf(text, sizeof text, BENCH_TAG "%u %u %llu", ci, c->seq++,
+                     (unsigned long long)mono_ns());
+    size_t tlen = (size_t)k;
+    if(bc.size > tlen){
+        memset(text + tlen, 'x', bc.size - tlen);
+        text[tlen] = ' ';
+        tlen = bc.size;
+    }
+
+    if(client_send(c, text, tlen) < 0){
+        st.send_err++;
+        return;
+    }
+    st.sent++;
+    st.expected += bgroups[c->group].members;
+}
+
+/*
+    Phase de mesure : envois cadencés par le timerfd (rate * temps écoulé - déjà
+    envoyés, répartis en tourniquet sur les clients membres : chaque appel compte,
+    la boucle se termine toujours), réceptions au fil de l'eau, puis drain_ms de
+    réception seule.
+*/
+static double bench_run(int ep){
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(tfd < 0) die_perror("timerfd_create");
+    struct itimerspec its = { { 0, BENCH_TICK_NS }, { 0, BENCH_TICK_NS } };
+    if(timerfd_settime(tfd, 0, &its, NULL) < 0) die_perror("timerfd_settime");
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.u32 = bc.clients };
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev) < 0) die_perror("epoll_ctl");
+
+    struct epoll_event evs[64];
+    uint64_t t0 = mono_ns();
+    uint64_t t_end = t0 + (uint64_t)(bc.duration * 1e9);
+    uint64_t t_stop = 0;
+    unsigned rr = 0;
+    loss_on = bc.loss > 0;
+
+    for(;;){
+        uint64_t now = mono_ns();
+        if(!t_stop && (now >= t_end || stop_req)) t_stop = now;
+        if(t_stop && now >= t_stop + (uint64_t)bc.drain_ms * 1000000ull) break;
+
+        int unlimited = (bc.rate <= 0 && !t_stop);
+        int ne = epoll_wait(ep, evs, 64, unlimited ? 0 : 1);
+        if(ne < 0){
+            if(errno == EINTR) continue;
+            die_perror("epoll_wait");
+        }
+
+        for(int e=0;e<ne;e++){
+            uint32_t k = evs[e].data.u32;
+            if(k < bc.clients){
+                client_recv(k);
+                continue;
+            }
+            uint64_t ticks;
+            (void)!read(tfd, &ticks, sizeof ticks);
+            rx_tick_all();
+            if(t_stop || bc.rate <= 0) continue;
+
+            uint64_t due = (uint64_t)(bc.rate * (double)(mono_ns() - t0) / 1e9);
+            while(st.sent + st.send_err < due){
+                bench_send_one(senders[rr]);
+                rr = (rr + 1) % nsenders;
+            }
+        }
+        if(unlimited){
+            for(unsigned i=0;i<nsenders;i++) bench_send_one(senders[i]);
+        }
+    }
+    loss_on = 0;
+    close(tfd);
+    return (double)(t_stop - t0) / 1e9;
+}
+
+/* ───────────────────────── Résultats ───────────────────────── */
+
+static void bench_report(double secs, unsigned joined){
+    for(unsigned i=0;i<bc.clients;i++){
+        const ISYRx *q = &bclients[i].rx;
+        st.nacks += q->nacks;
+        st.recovered += q->recovered;
+        st.dups += q->dups;
+        st.gap_lost += q->lost;
+    }
+    double loss = st.expected ? 1.0 - (double)st.delivered / (double)st.expected : 0.0;
+    if(loss < 0) loss = 0;
+    if(secs <= 0) secs = 1e-9;
+
+    fprintf(stderr, "[Bench] %u clients, %u groupes (%u membres), %s, %.1f s\n",
+            bc.clients, bc.groups, joined, bc.bin ? "binaire" : "texte", secs);
+    fprintf(stderr, "[Bench] CREATE p50 %.0f us p99 %.0f us | JOIN p50 %.0f us p99 %.0f us\n",
+            hist_q_us(&st.create, .50), hist_q_us(&st.create, .99),
+            hist_q_us(&st.join, .50), hist_q_us(&st.join, .99));
+    fprintf(stderr, "[Bench] envoyés %llu (%.0f msg/s, %llu erreurs) | reçus %llu / %llu attendus (%.0f msg/s) | pertes %.3f %%\n",
+            (unsigned long long)st.sent, (double)st.sent / secs, (unsigned long long)st.send_err,
+            (unsigned long long)st.delivered, (unsigned long long)st.expected,
+            (double)st.delivered / secs, loss * 100.0);
+    if(bc.loss > 0 || bc.bin)
+        fprintf(stderr, "[Bench] pertes injectées %.2f %% (graine %llu) : %llu jetés | NACK %llu, repris %llu, doublons %llu, abandonnés %llu\n",
+                bc.loss * 100.0, (unsigned long long)bc.seed, (unsigned long long)st.dropped,
+                (unsigned long long)st.nacks, (unsigned long long)st.recovered,
+                (unsigned long long)st.dups, (unsigned long long)st.gap_lost);
+    fprintf(stderr, "[Bench] latence p50 %.1f us p99 %.1f us p999 %.1f us max %.1f us\n",
+            hist_q_us(&st.lat, .50), hist_q_us(&st.lat, .99), hist_q_us(&st.lat, .999),
+            (double)st.lat.max / 1000.0);
+
+    printf("{\"clients\":%u,\"groups\":%u,\"joined\":%u,\"proto\":\"%s\",\"rate\":%.0f,"
+           "\"duration_s\":%.3f,\"size\":%u,"
+           "\"create_us\":{\"n\":%llu,\"p50\":%.1f,\"p99\":%.1f},"
+           "\"join_us\":{\"n\":%llu,\"p50\":%.1f,\"p99\":%.1f},"
+           "\"sent\":%llu,\"send_errors\":%llu,\"expected\":%llu,\"delivered\":%llu,"
+           "\"foreign\":%llu,\"loss\":%.6f,\"send_rate\":%.1f,\"delivery_rate\":%.1f,"
+           "\"inject\":{\"p\":%.4f,\"seed\":%llu,\"dropped\":%llu,\"nacks\":%llu,"
+           "\"recovered\":%llu,\"dups\":%llu,\"abandoned\":%llu},"
+           "\"latency_us\":{\"p50\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}}\n",
+           bc.clients, bc.groups, joined, bc.bin ? "bin" : "text", bc.rate,
+           secs, bc.size,
+           (unsigned long long)st.create.n, hist_q_us(&st.create, .50), hist_q_us(&st.create, .99),
+           (unsigned long long)st.join.n, hist_q_us(&st.join, .50), hist_q_us(&st.join, .99),
+           (unsigned long long)st.sent, (unsigned long long)st.send_err,
+           (unsigned long long)st.expected, (unsigned long long)st.delivered,
+           (unsigned long long)st.foreign, loss, (double)st.sent / secs, (double)st.delivered / secs,
+           bc.loss, (unsigned long long)bc.seed, (unsigned long long)st.dropped,
+           (unsigned long long)st.nacks, (unsigned long long)st.recovered,
+           (unsigned long long)st.dups, (unsigned long long)st.gap_lost,
+           hist_q_us(&st.lat, .50), hist_q_us(&st.lat, .99), hist_q_us(&st.lat, .999),
+           (double)st.lat.max / 1000.0);
+    fflush(stdout);
+}
+
+static void usage(const char *argv0){
+    fprintf(stderr,
+        "Usage: %s [server.conf] [--clients N] [--groups G] [--rate msg/s] [--duration s]\n"
+        "          [--size octets] [--drain ms] [--proto text|bin] [--loss p] [--seed n]\n", argv0);
+    exit(2);
+}
+
+int main(int argc, char **argv){
+    const char *conf = "conf/server.conf";
+
+    memset(&bc, 0, sizeof bc);
+    isy_strcpy(bc.srv_ip, sizeof bc.srv_ip, "127.0.0.1");
+    bc.srv_port = 8000;
+    bc.clients  = 8;
+    bc.groups   = 1;
+    bc.rate     = 1000;
+    bc.duration = 5;
+    bc.size     = 64;
+    bc.drain_ms = 500;
+    bc.seed     = 1;
+
+    int a = 1;
+    if(a < argc && strncmp(argv[a], "--", 2) != 0) conf = argv[a++];
+    for(; a < argc; a += 2){
+        if(a + 1 >= argc) usage(argv[0]);
+        const char *k = argv[a], *v = argv[a + 1];
+
+        if(!strcmp(k, "--clients"))       bc.clients  = (unsigned)strtoul(v, NULL, 10);
+        else if(!strcmp(k, "--groups"))   bc.groups   = (unsigned)strtoul(v, NULL, 10);
+        else if(!strcmp(k, "--rate"))     bc.rate     = strtod(v, NULL);
+        else if(!strcmp(k, "--duration")) bc.duration = strtod(v, NULL);
+        else if(!strcmp(k, "--size"))     bc.size     = (unsigned)strtoul(v, NULL, 10);
+        else if(!strcmp(k, "--drain"))    bc.drain_ms = (unsigned)strtoul(v, NULL, 10);
+        else if(!strcmp(k, "--proto"))    bc.bin      = !strcmp(v, "bin");
+        else if(!strcmp(k, "--loss"))     bc.loss     = strtod(v, NULL);
+        else if(!strcmp(k, "--seed"))     bc.seed     = strtoull(v, NULL, 10);
+        else usage(argv[0]);
+    }
+    if(load_conf(conf, &bc) < 0){
+        fprintf(stderr, "[Bench] %s illisible, serveur %s:%u\n", conf, bc.srv_ip, (unsigned)bc.srv_port);
+    }
+    if(!bc.clients) bc.clients = 1;
+    if(!bc.groups) bc.groups = 1;
+    if(bc.groups > bc.clients) bc.groups = bc.clients;
+    if(bc.size > TXT_LEN - 64) bc.size = TXT_LEN - 64;
+    if(!(bc.loss > 0)) bc.loss = 0;
+    if(bc.loss > 0.99) bc.loss = 0.99;
+    rng = bc.seed ? bc.seed : 1;
+
+    bgroups  = (BGroup*)calloc(bc.groups, sizeof *bgroups);
+    bclients = (BClient*)calloc(bc.clients, sizeof *bclients);
+    if(!bgroups || !bclients) die_msg("calloc");
+
+    signal(SIGINT, on_sigint);
+    signal(SIGPIPE, SIG_IGN);
+
+    bench_setup();
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if(ep < 0) die_perror("epoll_create1");
+    for(unsigned i=0;i<bc.clients;i++){
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+        if(epoll_ctl(ep, EPOLL_CTL_ADD, bclients[i].fd, &ev) < 0) die_perror("epoll_ctl");
+    }
+
+    unsigned joined = bench_join(ep);
+    if(!joined){
+        fprintf(stderr, "[Bench] aucun écho \"(joined)\" en %d ms : groupe injoignable ?\n", BENCH_JOIN_MS);
+        return 1;
+    }
+    if(joined < bc.clients)
+        fprintf(stderr, "[Bench] %u client(s) sans écho \"(joined)\" : ignorés\n", bc.clients - joined);
+
+    senders = (unsigned*)calloc(joined, sizeof *senders);
+    if(!senders) die_msg("calloc");
+    for(unsigned i=0;i<bc.clients;i++){
+        if(bclients[i].joined) senders[nsenders++] = i;
+    }
+
+    double secs = bench_run(ep);
+
+    // Départ propre : les groupes retirent les membres (et s'arrêtent ensuite par inactivité)
+    for(unsigned i=0;i<bc.clients;i++){
+        if(bclients[i].joined) (void)client_send(&bclients[i], "(left)", 6);
+        close(bclients[i].fd);
+        free(bclients[i].win);
+    }
+    close(ep);
+
+    bench_report(secs, joined);
+    free(senders);
+    free(bgroups);
+    free(bclients);
+    return 0;
+}
+
+#else /* !__linux__ */
+
+int main(void){
+    fprintf(stderr, "BenchISY : Linux uniquement (epoll, timerfd)\n");
+    return 1;
+}
+
+#endif
@@ -6,9 +6,14 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <stdarg.h>     // va_list / va_start / vsnprintf
+#include <poll.h>
 #include <sys/select.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
 
 /*
     ─────────────────────────────────────────────────────────────────────────
@@ -16,21 +21,106 @@
     ─────────────────────────────────────────────────────────────────────────
     Rôle :
       - Gère le réseau côté client :
-          * dialogue UDP avec ServeurISY (LIST / CREATE / JOIN / MERGE)
+          * dialogue UDP avec ServeurISY (LIST / CREATE / JOIN / MERGE / LOOKUP)
           * dialogue UDP avec un GroupeISY (MSG / CMD BAN2 / CMD UNBAN2, bannières, redirect…)
       - Ne gère pas l’affichage directement : l’UI est déportée dans AffichageISY.
         ClientISY communique avec AffichageISY via deux FIFOs :
           * fifo_in  : ClientISY -> AffichageISY (événements à afficher)
           * fifo_out : AffichageISY -> ClientISY (entrées clavier utilisateur)
+        Sous Linux, les événements passent de préférence par un ring SHM
+        (ISYRing, SHM_PREFIX) réveillé par eventfd ; fifo_in reste le repli.
 
     Points importants :
-      - UDP peut perdre des paquets : on évite de “reset” l’état client quand LIST ne répond pas.
+      - UDP peut perdre des paquets : on évite de “reset” l’état client quand LOOKUP ne répond pas.
       - Les messages reçus du groupe ne doivent être affichés que dans le mode "dialogue".
       - Les bannières sont envoyées au client via messages CTRL, puis AffichageISY les “pinnent” en haut.
+      - Protocole binaire v1 (Commun.h) tenté d'abord avec le serveur : une réponse texte
+        ou une absence de réponse fait repasser la session en texte (srv_request).
+        Les réponses binaires du serveur sont remises sous leur forme texte pour
+        l'affichage ; côté RX, les trames du groupe sont aiguillées sur l'opcode.
+      - Les diffusions binaires du groupe sont numérotées : le thread RX les remet
+        dans l'ordre et redemande les trous (NACK), voir "Réception fiable".
 */
 
 #define MAX_TOKENS 64
 
+/* Ring SHM vers l'UI : attente max (ms) d'une case libre avant repli FIFO */
+#define UI_RING_WAIT_MS 2000
+
+/*
+    File UI : ui_send (thread principal, thread RX) ne fait que déposer la
+    ligne dans une file bornée ; un thread dédié (ui_writer) la transmet à
+    AffichageISY par lots (ring SHM, ou writev sur fifo_in non bloquante).
+    File pleine => politique UI_OVERFLOW :
+      - coalesce : on jette les plus anciennes lignes "UI LOG", remplacées
+                   par un résumé "N message(s) non affiché(s)" (défaut)
+      - drop     : idem, sans résumé
+      - block    : l'appelant attend de la place (sauf le thread RX, qui ne
+                   doit jamais attendre le terminal : il applique coalesce)
+    Les autres événements (HEADER, BANNER..., CLRLOG, QUIT) ne sont jamais
+    sacrifiés au profit d'une ligne de log.
+*/
+#define UI_QUEUE_DEFAULT 1024   // lignes en attente max (UI_QUEUE)
+#define UI_SLOT          1024   // taille max d'une ligne (= MAX_LINE de l'UI)
+#define UI_BATCH         64     // lignes transmises par lot
+#define UI_STOP_WAIT_MS  1000   // à l'arrêt, attente max d'une UI qui ne lit plus
+
+#define UI_OVF_COALESCE 0
+#define UI_OVF_DROP     1
+#define UI_OVF_BLOCK    2
+
+/* Format réseau négocié avec le serveur (puis utilisé avec les groupes) */
+#define WIRE_TEXT 0     // lignes texte (repli, ou WIRE_PROTOCOL=text)
+#define WIRE_TRY  1     // trames binaires tentées, pas encore de réponse binaire
+#define WIRE_BIN  2     // le serveur a répondu en binaire : trames partout
+
+/*
+    Réception fiable des diffusions du groupe (trames binaires numérotées) :
+    fenêtre de réordonnancement commune (ISYRx, Commun.h) ; le contenu des
+    trames arrivées en avance est gardé ici, une case par seq % ISY_RX_WINDOW.
+*/
+typedef struct {
+    uint16_t len;
+    uint8_t  data[ISY_BIN_MAX];
+} RxSlot;
+
+/*
+    Etat du flux numéroté du groupe courant (thread RX uniquement) :
+      - rx     : fenêtre et compteurs (affichés sur stderr à la sortie du client)
+      - win    : contenu des cases de la fenêtre
+      - to/gid : destination des NACK (groupe courant, figé au join)
+*/
+typedef struct {
+    ISYRx     rx;
+    RxSlot   *win;
+    struct sockaddr_in to;
+    uint32_t  gid;
+} RxSeq;
+
+/* 1 dans le thread RX : il ne doit jamais attendre la file UI */
+static _Thread_local int t_rx_thread = 0;
+
+/* File UI bornée (voir UI_QUEUE_DEFAULT) : cap cases de UI_SLOT octets, ordre FIFO */
+typedef struct {
+    char   (*slot)[UI_SLOT];
+    uint16_t *len;
+    uint8_t  *log;          // 1 => ligne "UI LOG" (jetable si la file déborde)
+    unsigned  cap, head, count;
+    int       policy;       // UI_OVF_*
+    volatile int stop;
+
+    unsigned long skipped;  // jetées depuis le dernier résumé (coalesce)
+    unsigned long dropped;  // total jeté
+    unsigned long sent;     // lignes transmises à l'UI
+    unsigned long batches;  // writev sur fifo_in
+
+    pthread_mutex_t mtx;
+    pthread_cond_t  more;   // file non vide / arrêt
+    pthread_cond_t  room;   // place libérée (politique block)
+    pthread_t       th;
+    int             running;
+} UiQueue;
+
 /* Association (groupe -> token admin) stockée côté client */
 typedef struct {
     char group[32];
@@ -55,6 +145,8 @@ typedef struct {
     // group socket (same rx socket)
     int sock_rx;
     struct sockaddr_in grp_addr;
+    int grp_gid;            // mode mono-port : gid du groupe (-1 = un port par groupe)
+    int wire;               // WIRE_TEXT / WIRE_TRY / WIRE_BIN
 
     // session
     int joined;
@@ -71,15 +163,33 @@ typedef struct {
     char fifo_in[256];
     char fifo_out[256];
 
+    // transport SHM vers l'UI (NULL => FIFO seule)
+    char shm_prefix[64];
+    char ui_shm[96];
+    ISYRing *ui_ring;
+    int ui_fifo_only;       // 1 => ring abandonné (UI bloquée), tout repasse par fifo_in
+    int ui_efd;             // sonnette eventfd partagée avec AffichageISY
+    unsigned ui_history;    // UI_HISTORY (0 => défaut de l'UI)
+    int ui_fps;             // UI_FPS (-1 => défaut de l'UI)
+    unsigned long ui_lines, ui_kicks;
+
+    // file UI : ui_send -> ui_writer, seul thread à écrire vers l'UI
+    UiQueue uiq;
+
     // flags from rx thread
     volatile int redirect_pending;
     char redirect_group[32];
     uint16_t redirect_port;
+    int redirect_gid;
     char redirect_reason[128];
 
     volatile int group_deleted;
     volatile int stop_rx;
 
+    // posé (sous mtx) à chaque join : le thread RX repart sur un nouveau flux numéroté
+    int rx_resync;
+    RxSeq rxs;
+
     // n'afficher les messages RX que si on est dans "dialoguer"
     volatile int in_dialogue;
 
@@ -92,12 +202,315 @@ static volatile sig_atomic_t g_running = 1;
 
 /* ───────────────────────── UI helpers (FIFO protocol) ───────────────────────── */
 
+#ifdef __linux__
+/* Réveille l'UI seulement si elle dort (waiting=1), voir ISYRing dans Commun.h */
+static void ui_ring_kick(ClientCtx *c){
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&c->ui_ring->waiting, __ATOMIC_RELAXED) &&
+       __atomic_exchange_n(&c->ui_ring->waiting, 0, __ATOMIC_SEQ_CST)){
+        uint64_t one = 1;
+        if(write(c->ui_efd, &one, sizeof one) < 0){ /* UI partie : rien à faire */ }
+        c->ui_kicks++;
+    }
+}
+
+/*
+    Dépose une ligne (sans '\n') dans le ring, découpée en cases CONT/LINE.
+    Appelé par ui_writer (seul producteur). Retour 0 si OK, -1 si l'UI ne
+    libère pas de place (bloquée ou morte) : on repasse alors sur la FIFO.
+*/
+static int ui_ring_put(ClientCtx *c, const char *s, size_t L){
+    ISYRing *r = c->ui_ring;
+    uint32_t need = (uint32_t)(L ? (L + TXT_LEN - 2) / (TXT_LEN - 1) : 1);
+    uint32_t w = __atomic_load_n(&r->widx, __ATOMIC_RELAXED);
+
+    for(int waited = 0;
+        SHM_RING_CAP - (w - __atomic_load_n(&r->ridx, __ATOMIC_ACQUIRE)) < need;
+        waited++){
+        if(waited >= UI_RING_WAIT_MS) return -1;
+        ui_ring_kick(c);
+        struct timespec ts = {0, 1000000};
+        nanosleep(&ts, NULL);
+    }
+
+    size_t off = 0;
+    for(uint32_t i = 0; i < need; i++){
+        ISYMsg *m = &r->ring[(w + i) % SHM_RING_CAP];
+        size_t n = L - off;
+        if(n > TXT_LEN - 1) n = TXT_LEN - 1;
+        memcpy(m->Texte, s + off, n);
+        m->Texte[n] = '\0';
+        off += n;
+        isy_strcpy(m->Ordre, sizeof m->Ordre, (i + 1 < need) ? ISY_RING_CONT : ISY_RING_LINE);
+    }
+    __atomic_store_n(&r->widx, w + need, __ATOMIC_RELEASE);
+    c->ui_lines++;
+
+    ui_ring_kick(c);
+    return 0;
+}
+
+/*
+    Crée le ring SHM (<SHM_PREFIX>_ui_<pid>) et la sonnette eventfd.
+    En cas d'échec, on reste simplement sur la FIFO.
+*/
+static void ui_ring_open(ClientCtx *c){
+    if(!c->shm_prefix[0] || !strcmp(c->shm_prefix, "none")) return;
+
+    snprintf(c->ui_shm, sizeof c->ui_shm, "%s_ui_%d", c->shm_prefix, (int)getpid());
+    shm_unlink(c->ui_shm);
+
+    int fd = shm_open(c->ui_shm, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if(fd < 0){ c->ui_shm[0] = '\0'; return; }
+
+    void *p = MAP_FAILED;
+    if(ftruncate(fd, sizeof(ISYRing)) == 0)
+        p = mmap(NULL, sizeof(ISYRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    // pas de EFD_CLOEXEC : AffichageISY hérite de la sonnette à l'exec
+    int efd = (p != MAP_FAILED) ? eventfd(0, EFD_NONBLOCK) : -1;
+    if(efd < 0){
+        if(p != MAP_FAILED) munmap(p, sizeof(ISYRing));
+        shm_unlink(c->ui_shm);
+        c->ui_shm[0] = '\0';
+        return;
+    }
+
+    c->ui_ring = (ISYRing*)p;   // ftruncate => zéros : widx = ridx = 0
+    c->ui_efd = efd;
+}
+
+static void ui_ring_close(ClientCtx *c){
+    if(c->ui_ring){
+        __atomic_store_n(&c->ui_ring->closed, 1, __ATOMIC_RELEASE);
+        __atomic_store_n(&c->ui_ring->waiting, 1, __ATOMIC_RELAXED);
+        ui_ring_kick(c);
+        munmap(c->ui_ring, sizeof(ISYRing));
+        c->ui_ring = NULL;
+    }
+    if(c->ui_efd >= 0){
+        close(c->ui_efd);
+        c->ui_efd = -1;
+    }
+    if(c->ui_shm[0]) shm_unlink(c->ui_shm);  // déjà fait par l'UI en temps normal
+}
+#endif
+
+/*
+    Ecrit n lignes sur fifo_in (non bloquante) en un minimum de writev.
+    Si la FIFO est pleine, on attend qu'elle redevienne inscriptible ; à
+    l'arrêt, on abandonne (-1) une UI qui ne lit plus depuis UI_STOP_WAIT_MS.
+*/
+static int ui_fifo_writev(ClientCtx *c, char (*line)[UI_SLOT], const uint16_t *len, unsigned n){
+    static char nl[] = "\n";
+    struct iovec iov[2 * UI_BATCH];
+    unsigned k = 0, at = 0;
+    int waited = 0;
+
+    for(unsigned i = 0; i < n; i++){
+        iov[k].iov_base = line[i];
+        iov[k++].iov_len = len[i];
+        iov[k].iov_base = nl;
+        iov[k++].iov_len = 1;
+    }
+
+    while(at < k){
+        ssize_t w = writev(c->ui_in_fd, iov + at, (int)(k - at));
+        if(w < 0){
+            if(errno == EINTR) continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+
+            struct pollfd pfd = { c->ui_in_fd, POLLOUT, 0 };
+            if(poll(&pfd, 1, 100) == 0 && c->uiq.stop && (waited += 100) >= UI_STOP_WAIT_MS) return -1;
+            continue;
+        }
+        c->uiq.batches++;
+
+        // écriture partielle : on avance dans les iovec
+        while(at < k && (size_t)w >= iov[at].iov_len){
+            w -= (ssize_t)iov[at].iov_len;
+            at++;
+        }
+        if(at < k){
+            iov[at].iov_base = (char*)iov[at].iov_base + w;
+            iov[at].iov_len -= (size_t)w;
+        }
+    }
+    return 0;
+}
+
+/* Transmet un lot à l'UI : ring SHM si disponible, sinon fifo_in */
+static int ui_emit(ClientCtx *c, char (*line)[UI_SLOT], const uint16_t *len, unsigned n){
+    unsigned i = 0;
+
+#ifdef __linux__
+    if(c->ui_ring && !c->ui_fifo_only){
+        for(; i < n; i++){
+            if(ui_ring_put(c, line[i], len[i]) < 0){
+                /*
+                    UI bloquée : on abandonne le ring pour de bon. L'UI vide le ring
+                    avant fifo_in à chaque tour, l'ordre des lignes est conservé.
+                */
+                fprintf(stderr, "[ClientISY] ring UI plein, repli sur la FIFO\n");
+                c->ui_fifo_only = 1;
+                break;
+            }
+        }
+    }
+#endif
+
+    return (i < n) ? ui_fifo_writev(c, line + i, len + i, n - i) : 0;
+}
+
+/*
+    Thread writer UI : vide la file par lots de UI_BATCH lignes, copiées hors
+    du verrou pour que ui_send n'attende jamais une écriture vers le terminal.
+*/
+static void *ui_writer(void *arg){
+    ClientCtx *c = (ClientCtx*)arg;
+    UiQueue *q = &c->uiq;
+    static char line[UI_BATCH][UI_SLOT];
+    uint16_t len[UI_BATCH];
+
+    pthread_mutex_lock(&q->mtx);
+    for(;;){
+        while(!q->count && !q->skipped && !q->stop) pthread_cond_wait(&q->more, &q->mtx);
+        if(!q->count && !q->skipped) break;     // arrêt demandé, file vide
+
+        unsigned n = 0;
+        if(q->skipped){
+            int L = snprintf(line[0], UI_SLOT, "UI LOG SYS: %lu message(s) non affiche(s) (affichage en retard).",
+                             q->skipped);
+            len[n++] = (uint16_t)((L > 0 && L < UI_SLOT) ? L : 0);
+            q->skipped = 0;
+        }
+        while(n < UI_BATCH && q->count){
+            memcpy(line[n], q->slot[q->head], q->len[q->head]);
+            len[n++] = q->len[q->head];
+            q->head = (q->head + 1) % q->cap;
+            q->count--;
+        }
+        pthread_cond_broadcast(&q->room);
+        pthread_mutex_unlock(&q->mtx);
+
+        int rc = ui_emit(c, line, len, n);
+
+        pthread_mutex_lock(&q->mtx);
+        q->sent += n;
+        if(rc < 0){
+            // UI morte ou figée à l'arrêt : le reste ne sera jamais lu
+            q->dropped += q->count;
+            q->count = 0;
+            q->skipped = 0;
+            if(q->stop) break;
+        }
+    }
+    pthread_mutex_unlock(&q->mtx);
+    return NULL;
+}
+
+/*
+    File pleine : retire la plus ancienne ligne "UI LOG". Les événements de
+    contrôle qui la précèdent glissent d'une case (il y en a rarement plus
+    d'un ou deux). Retour -1 si la file ne contient aucune ligne de log.
+*/
+static int ui_drop_oldest_log(UiQueue *q){
+    unsigned j = 0;
+    while(j < q->count && !q->log[(q->head + j) % q->cap]) j++;
+    if(j == q->count) return -1;
+
+    for(; j > 0; j--){
+        unsigned d = (q->head + j) % q->cap, s = (q->head + j - 1) % q->cap;
+        memcpy(q->slot[d], q->slot[s], q->len[s]);
+        q->len[d] = q->len[s];
+        q->log[d] = q->log[s];
+    }
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    q->dropped++;
+    if(q->policy != UI_OVF_DROP) q->skipped++;   // block : le thread RX se rabat sur coalesce
+    return 0;
+}
+
+/* Dépose une ligne (sans '\n') dans la file UI, selon la politique de débordement */
+static void ui_push(ClientCtx *c, const char *s, size_t L){
+    UiQueue *q = &c->uiq;
+    int is_log = !strncmp(s, "UI LOG ", 7);
+
+    if(L > UI_SLOT) L = UI_SLOT;
+
+    pthread_mutex_lock(&q->mtx);
+    while(q->count == q->cap){
+        if(q->policy == UI_OVF_BLOCK && !q->stop && !t_rx_thread){
+            pthread_cond_wait(&q->room, &q->mtx);
+            continue;
+        }
+        if(ui_drop_oldest_log(q) < 0){
+            // que des événements de contrôle en attente : la nouvelle ligne est perdue
+            q->dropped++;
+            pthread_mutex_unlock(&q->mtx);
+            return;
+        }
+    }
+
+    unsigned t = (q->head + q->count) % q->cap;
+    memcpy(q->slot[t], s, L);
+    q->len[t] = (uint16_t)L;
+    q->log[t] = (uint8_t)is_log;
+    q->count++;
+
+    pthread_cond_signal(&q->more);
+    pthread_mutex_unlock(&q->mtx);
+}
+
+/* Alloue la file UI et lance ui_writer (fifo_in déjà ouverte) */
+static int ui_queue_start(ClientCtx *c){
+    UiQueue *q = &c->uiq;
+
+    if(!q->cap) q->cap = UI_QUEUE_DEFAULT;
+    q->slot = malloc((size_t)q->cap * UI_SLOT);
+    q->len  = calloc(q->cap, sizeof *q->len);
+    q->log  = calloc(q->cap, sizeof *q->log);
+    if(!q->slot || !q->len || !q->log) return -1;
+
+    pthread_mutex_init(&q->mtx, NULL);
+    pthread_cond_init(&q->more, NULL);
+    pthread_cond_init(&q->room, NULL);
+
+    // le writer ne doit jamais rester coincé dans write() : il attend via poll()
+    int fl = fcntl(c->ui_in_fd, F_GETFL);
+    if(fl >= 0) fcntl(c->ui_in_fd, F_SETFL, fl | O_NONBLOCK);
+
+    if(pthread_create(&q->th, NULL, ui_writer, c) != 0) return -1;
+    q->running = 1;
+    return 0;
+}
+
+/* Arrêt du writer : il transmet ce qui reste (UI QUIT compris) puis se termine */
+static void ui_queue_stop(ClientCtx *c){
+    UiQueue *q = &c->uiq;
+    if(!q->running) return;
+
+    pthread_mutex_lock(&q->mtx);
+    q->stop = 1;
+    pthread_cond_broadcast(&q->more);
+    pthread_cond_broadcast(&q->room);
+    pthread_mutex_unlock(&q->mtx);
+
+    pthread_join(q->th, NULL);
+    q->running = 0;
+}
+
 /*
     Envoie une commande UI à AffichageISY.
-    Toutes les commandes UI sont des lignes de texte terminées par '\n'.
+    Toutes les commandes UI sont des lignes de texte terminées par '\n'
+    (dans le ring SHM, une ligne = une ou plusieurs cases, sans '\n').
+    La ligne passe par la file UI : l'appelant n'attend jamais le terminal
+    (sauf UI_OVERFLOW=block, hors thread RX).
 */
 static void ui_send(ClientCtx *c, const char *fmt, ...){
-    if(c->ui_in_fd < 0) return;
+    if(c->ui_in_fd < 0 || !c->uiq.running) return;
 
     char buf[2048];
     va_list ap;
@@ -108,9 +521,8 @@ static void ui_send(ClientCtx *c, const char *fmt, ...){
     size_t L = strlen(buf);
     if(L == 0) return;
 
-    // On force un '\n' final si absent.
-    if(buf[L-1] != '\n') dprintf(c->ui_in_fd, "%s\n", buf);
-    else dprintf(c->ui_in_fd, "%s", buf);
+    // le '\n' final est ajouté à l'écriture
+    ui_push(c, buf, buf[L-1] == '\n' ? L - 1 : L);
 }
 
 /*
@@ -288,20 +700,93 @@ static void token_print(ClientCtx *c){
 
 /* ───────────────────────── Group join/leave ───────────────────────── */
 
+/*
+    Envoie un datagramme au groupe courant.
+    En mode mono-port (grp_gid >= 0), il est préfixé par "@<gid> ".
+*/
+static void group_send(ClientCtx *c, const char *payload){
+    char out[TXT_LEN + 64];
+    const char *p = payload;
+
+    if(c->grp_gid >= 0){
+        snprintf(out, sizeof out, "%c%d %s", ISY_MUX_TAG, c->grp_gid, payload);
+        p = out;
+    }
+
+    (void)sendto(c->sock_rx, p, strlen(p), 0,
+                 (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+}
+
+/* Envoie une trame binaire au groupe courant (le gid voyage dans l'en-tête) */
+static void group_send_frame(ClientCtx *c, ISYWr *w){
+    size_t n = isy_bin_end(w);
+    if(n) (void)sendto(c->sock_rx, w->p, n, 0, (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+}
+
+static uint32_t group_gid_hdr(const ClientCtx *c){
+    return c->grp_gid >= 0 ? (uint32_t)c->grp_gid : ISY_BIN_NOGID;
+}
+
+/* MSG <user> <texte> au groupe courant, dans le format de la session */
+static void group_send_msg(ClientCtx *c, const char *text){
+    char user[EME_LEN];
+    pthread_mutex_lock(&c->mtx);
+    isy_strcpy(user, sizeof user, c->user);
+    pthread_mutex_unlock(&c->mtx);
+
+    if(c->wire == WIRE_BIN){
+        uint8_t fr[ISY_BIN_MAX];
+        ISYWr w;
+        isy_bin_begin(&w, fr, sizeof fr, ISY_OP_MSG, 0, group_gid_hdr(c), 0);
+        isy_bin_cstr(&w, user);
+        isy_bin_cstr(&w, text);
+        group_send_frame(c, &w);
+        return;
+    }
+
+    char out[TXT_LEN];
+    snprintf(out, sizeof out, "MSG %s %s", user, text);
+    group_send(c, out);
+}
+
+/* BAN / UNBAN (CMD BAN2 / CMD UNBAN2 en texte) au groupe courant */
+static void group_send_ban(ClientCtx *c, int ban, const char *tok, const char *victim){
+    if(c->wire == WIRE_BIN){
+        uint8_t fr[ISY_BIN_MAX];
+        ISYWr w;
+        isy_bin_begin(&w, fr, sizeof fr, ban ? ISY_OP_BAN : ISY_OP_UNBAN, 0, group_gid_hdr(c), 0);
+        isy_bin_cstr(&w, tok);
+        isy_bin_cstr(&w, c->user);
+        isy_bin_cstr(&w, victim);
+        group_send_frame(c, &w);
+        return;
+    }
+
+    char out[256];
+    snprintf(out, sizeof out, "CMD %s %s %s %s", ban ? "BAN2" : "UNBAN2", tok, c->user, victim);
+    group_send(c, out);
+}
+
+/* Extrait le gid " @<gid>" d'une réponse serveur (-1 si absent : un port par groupe) */
+static int parse_gid(const char *resp){
+    const char *at = strrchr(resp, ISY_MUX_TAG);
+    if(!at || (at != resp && at[-1] != ' ')) return -1;
+    return atoi(at + 1);
+}
+
 /*
     Envoie un "MSG <user> (joined)" au groupe.
     Le groupe utilise ce message pour :
       - enregistrer (user -> addr)
       - renvoyer les bannières actives au nouvel arrivant
+    Le thread RX repart alors de zéro sur le flux numéroté (nouveau groupe).
 */
 static void group_send_join_hello(ClientCtx *c){
-    char hello[128];
     pthread_mutex_lock(&c->mtx);
-    snprintf(hello, sizeof hello, "MSG %s %s", c->user, "(joined)");
+    c->rx_resync = 1;
     pthread_mutex_unlock(&c->mtx);
 
-    (void)sendto(c->sock_rx, hello, strlen(hello), 0,
-                (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+    group_send_msg(c, "(joined)");
 }
 
 /*
@@ -309,13 +794,7 @@ static void group_send_join_hello(ClientCtx *c){
     Permet d’annoncer et/ou retirer le membre côté GroupeISY.
 */
 static void group_send_left(ClientCtx *c){
-    char bye[128];
-    pthread_mutex_lock(&c->mtx);
-    snprintf(bye, sizeof bye, "MSG %s %s", c->user, "(left)");
-    pthread_mutex_unlock(&c->mtx);
-
-    (void)sendto(c->sock_rx, bye, strlen(bye), 0,
-                (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+    group_send_msg(c, "(left)");
 }
 
 /*
@@ -339,79 +818,472 @@ static void cleanup_joined_state(ClientCtx *c){
 /* ───────────────────────── Server helpers ───────────────────────── */
 
 /*
-    LIST puis recherche d’un groupe.
+    Requêtes serveur et leur trame binaire : opcode + nombre de mots repris en
+    champs (les mots suivants, ex. cip/cport de JOIN, ne sont pas transmis).
+*/
+static const struct { const char *verb; uint8_t op; int nfields; } srv_ops[] = {
+    { ISY_CMD_LIST,   ISY_OP_LIST,   0 },
+    { ISY_CMD_CREATE, ISY_OP_CREATE, 2 },
+    { ISY_CMD_JOIN,   ISY_OP_JOIN,   2 },
+    { ISY_CMD_MERGE,  ISY_OP_MERGE,  5 },
+    { ISY_CMD_LOOKUP, ISY_OP_LOOKUP, 1 },
+};
+
+/* Encode une requête texte "<VERBE> <mots...>" en trame ; 0 si verbe inconnu */
+static size_t srv_encode(const char *req, uint8_t *fr, size_t cap){
+    char tmp[512];
+    isy_strcpy(tmp, sizeof tmp, req);
+
+    char *save = NULL;
+    char *verb = strtok_r(tmp, " ", &save);
+    if(!verb) return 0;
+
+    for(size_t i=0;i<sizeof srv_ops/sizeof srv_ops[0];i++){
+        if(strcmp(verb, srv_ops[i].verb)) continue;
+
+        // LIST [cursor] [+members] : cursor dans seq, +members en flag
+        uint8_t flags = 0;
+        uint32_t seq = 0;
+        if(srv_ops[i].op == ISY_OP_LIST){
+            for(char *t = strtok_r(NULL, " ", &save); t; t = strtok_r(NULL, " ", &save)){
+                if(!strcmp(t, ISY_LIST_MEMBERS)) flags |= ISY_LF_MEMBERS;
+                else seq = (uint32_t)strtoul(t, NULL, 10);
+            }
+        }
+
+        ISYWr w;
+        isy_bin_begin(&w, fr, cap, srv_ops[i].op, flags, ISY_BIN_NOGID, seq);
+        for(int f=0; f<srv_ops[i].nfields; f++){
+            char *t = strtok_r(NULL, " ", &save);
+            isy_bin_cstr(&w, t ? t : "");
+        }
+        return isy_bin_end(&w);
+    }
+    return 0;
+}
+
+/*
+    Remet une réponse binaire du serveur sous sa forme texte (celle que le reste
+    du client sait afficher et analyser). Retour : longueur, -1 si trame invalide.
+*/
+static int srv_decode(const ISYHdr *h, ISYRd *r, char *out, size_t osz){
+    char g[32], tok[ADMIN_TOKEN_LEN];
+    int len = 0;
+
+    switch(h->op){
+    case ISY_OP_OK: {
+        if(isy_rd_cstr(r, g, sizeof g) < 0) return -1;
+        unsigned port = isy_rd_u16(r);
+        if(isy_rd_cstr(r, tok, sizeof tok) < 0) return -1;
+
+        // "OK <group> <port> [token|-] [@gid]" (voir fmt_ok_reply côté serveur)
+        len = snprintf(out, osz, "OK %s %u", g, port);
+        if(tok[0] || h->gid != ISY_BIN_NOGID)
+            len += snprintf(out + len, osz - (size_t)len, " %s", tok[0] ? tok : "-");
+        if(h->gid != ISY_BIN_NOGID)
+            len += snprintf(out + len, osz - (size_t)len, " %c%u", ISY_MUX_TAG, (unsigned)h->gid);
+        return len;
+    }
+
+    case ISY_OP_ERR:
+        if(isy_rd_cstr(r, tok, sizeof tok) < 0) return -1;
+        return snprintf(out, osz, "ERR %s", tok);
+
+    case ISY_OP_LISTR:
+        out[0] = '\0';
+        while(r->off < r->end && (size_t)len + 64 < osz){
+            if(isy_rd_cstr(r, g, sizeof g) < 0) return -1;
+            unsigned port = isy_rd_u16(r);
+            if(h->flags & ISY_LF_MEMBERS){
+                unsigned m = isy_rd_u16(r);
+                if(r->err) return -1;
+                len += snprintf(out + len, osz - (size_t)len, "%s %u %u\n", g, port, m);
+                continue;
+            }
+            if(r->err) return -1;
+            len += snprintf(out + len, osz - (size_t)len, "%s %u\n", g, port);
+        }
+        if(len == 0) len = snprintf(out, osz, "(aucun)\n");
+        if(h->flags & ISY_LF_MORE)
+            len += snprintf(out + len, osz - (size_t)len, ISY_LIST_MORE "%u\n", (unsigned)h->seq);
+        return len;
+
+    case ISY_OP_TEXT:
+        if(isy_rd_cstr(r, out, osz) < 0) return -1;
+        return (int)strlen(out);
+
+    default:
+        return -1;
+    }
+}
+
+/*
+    Envoie une requête au serveur et attend sa réponse (timeout de sock_srv),
+    remise en texte dans resp (terminée par '\0').
+    Négociation : tant que c->wire != WIRE_TEXT, la requête part en trame binaire.
+      - réponse binaire    => WIRE_BIN (groupes compris)
+      - réponse texte      => ancien serveur : WIRE_TEXT, requête renvoyée en texte
+      - pas de réponse     => en WIRE_TRY seulement : WIRE_TEXT et nouvel essai texte
+    Retour : longueur de la réponse, <= 0 si pas de réponse.
+*/
+static ssize_t srv_request(ClientCtx *c, const char *req, char *resp, size_t rsz){
+    struct sockaddr_in from;
+    socklen_t fl;
+    ssize_t n;
+
+    if(c->wire != WIRE_TEXT){
+        uint8_t fr[ISY_BIN_MAX];
+        size_t flen = srv_encode(req, fr, sizeof fr);
+
+        if(flen){
+            if(sendto(c->sock_srv, fr, flen, 0, (struct sockaddr*)&c->srv_addr, sizeof c->srv_addr) < 0)
+                return -1;
+
+            uint8_t in[4096];
+            fl = sizeof from;
+            n = recvfrom(c->sock_srv, in, sizeof in, 0, (struct sockaddr*)&from, &fl);
+
+            ISYHdr h;
+            ISYRd r;
+            if(n > 0 && isy_bin_parse(in, (size_t)n, &h, &r) > 0){
+                c->wire = WIRE_BIN;
+                int len = srv_decode(&h, &r, resp, rsz);
+                return len < 0 ? -1 : len;
+            }
+            if(n <= 0 && c->wire == WIRE_BIN) return n;
+
+            // Réponse texte ou silence au premier essai : repli texte pour la session
+            c->wire = WIRE_TEXT;
+        }
+    }
+
+    if(sendto(c->sock_srv, req, strlen(req), 0, (struct sockaddr*)&c->srv_addr, sizeof c->srv_addr) < 0)
+        return -1;
+
+    fl = sizeof from;
+    n = recvfrom(c->sock_srv, resp, rsz - 1, 0, (struct sockaddr*)&from, &fl);
+    if(n > 0) resp[n] = '\0';
+    return n;
+}
+
+/*
+    LIST complet, page par page : chaque réponse se termine par "#more=<cursor>"
+    tant qu'il reste des groupes. fn est appelée pour chaque ligne de groupe.
+    Retour : 0 si toutes les pages sont arrivées, -1 sinon (liste partielle).
+*/
+static int server_list_all(ClientCtx *c, int members, void (*fn)(void *arg, const char *line), void *arg){
+    unsigned cursor = 0;
+
+    for(;;){
+        char req[64], buf[4096];
+        snprintf(req, sizeof req, ISY_CMD_LIST " %u%s", cursor, members ? " " ISY_LIST_MEMBERS : "");
+
+        ssize_t n = srv_request(c, req, buf, sizeof buf);
+        if(n <= 0) return -1;
+
+        unsigned next = 0;
+        char *save = NULL;
+        for(char *line = strtok_r(buf, "\n", &save); line; line = strtok_r(NULL, "\n", &save)){
+            if(!strncmp(line, ISY_LIST_MORE, strlen(ISY_LIST_MORE)))
+                next = (unsigned)strtoul(line + strlen(ISY_LIST_MORE), NULL, 10);
+            else
+                fn(arg, line);
+        }
+
+        // Le cursor ne fait qu'avancer : une réponse incohérente ne boucle pas
+        if(next <= cursor) return 0;
+        cursor = next;
+    }
+}
+
+/* Menu "Lister" : "<nom> <port> <membres>" affiché avec le nombre de membres */
+static void list_log_line(void *arg, const char *line){
+    ClientCtx *c = (ClientCtx*)arg;
+    char name[32]; unsigned port, m;
+    if(sscanf(line, "%31s %u %u", name, &port, &m) == 3)
+        ui_log(c, "%s %u (%u membre%s)", name, port, m, m > 1 ? "s" : "");
+    else
+        ui_log(c, "%s", line);
+}
+
+/*
+    Résolution d'un groupe par LOOKUP (un aller-retour, réponse de taille fixe).
+    Un serveur sans LOOKUP ("ERR unknown_cmd") est interrogé par JOIN, équivalent.
     Retour:
-      1  => groupe trouvé (out_port rempli)
-      0  => LIST reçu mais groupe absent
+      1  => groupe trouvé (out_port / out_gid remplis)
+      0  => réponse reçue mais groupe absent
      -1  => pas de réponse / erreur réseau (NE PAS reset l’état sur ce cas)
 
     Ce design évite un bug classique :
-      - si UDP drop le LIST, le client croyait que le groupe n'existait plus et se “reset” tout seul.
+      - si UDP drop la requête, le client croyait que le groupe n'existait plus et se “reset” tout seul.
 */
-static int server_list_and_find(ClientCtx *c, const char *gname, uint16_t *out_port){
-    const char *cmd = "LIST";
-
-    // retries UDP (pertes possibles)
-    for(int attempt=0; attempt<3; attempt++){
-        if(sendto(c->sock_srv, cmd, strlen(cmd), 0,
-                  (struct sockaddr*)&c->srv_addr, sizeof c->srv_addr) < 0){
-            return -1;
+static int server_lookup(ClientCtx *c, const char *gname, uint16_t *out_port, int *out_gid){
+    char req[96], resp[256];
+    snprintf(req, sizeof req, ISY_CMD_LOOKUP " %s", gname);
+
+    // un nouvel essai (pertes UDP possibles)
+    for(int attempt=0; attempt<2; attempt++){
+        ssize_t n = srv_request(c, req, resp, sizeof resp);
+        if(n <= 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            break;
         }
 
-        char buf[2048];
-        struct sockaddr_in from; socklen_t fl = sizeof from;
+        if(!strncmp(resp, "ERR unknown_cmd", 15)){
+            snprintf(req, sizeof req, ISY_CMD_JOIN " %s %s 0.0.0.0 0", gname, c->user);
+            continue;
+        }
 
-        ssize_t n = recvfrom(c->sock_srv, buf, sizeof buf - 1, 0,
-                             (struct sockaddr*)&from, &fl);
+        char okg[32];
+        unsigned port;
+        if(sscanf(resp, "OK %31s %u", okg, &port) != 2) return 0;
 
-        if(n <= 0){
-            if(errno == EAGAIN || errno == EWOULDBLOCK) continue; // retry
-            if(errno == EINTR) continue;                           // retry
-            return -1;
+        if(out_port) *out_port = (uint16_t)port;
+        if(out_gid) *out_gid = parse_gid(resp);
+        return 1;
+    }
+    return -1;
+}
+
+/* ───────────────────────── RX thread ───────────────────────── */
+
+/* Enregistre une demande de bascule (fusion), traitée par dialog_loop() */
+static void rx_set_redirect(ClientCtx *c, const char *ng, unsigned port, int gid, const char *reason){
+    pthread_mutex_lock(&c->mtx);
+    c->redirect_pending = 1;
+    isy_strcpy(c->redirect_group, sizeof c->redirect_group, ng);
+    c->redirect_port = (uint16_t)port;
+    c->redirect_gid = gid;
+    isy_strcpy(c->redirect_reason, sizeof c->redirect_reason,
+               reason[0] ? reason : "redirect");
+    pthread_mutex_unlock(&c->mtx);
+
+    if(c->in_dialogue){
+        ui_log(c, "SYS: redirect demande par le serveur… bascule automatique.");
+    }
+}
+
+/* Datagramme texte du groupe (buf terminé par '\0') */
+static void rx_text(ClientCtx *c, const char *buf){
+    /* ───────── CTRL (bannières / redirect / etc.) ───────── */
+    if(!strncmp(buf, "CTRL ", 5)){
+        if(!strncmp(buf, "CTRL BANNER_SET ", 16)){
+            ui_send(c, "UI BANNER_ADMIN_SET %s", buf + 16);
+            return;
+        }
+        if(!strcmp(buf, "CTRL BANNER_CLR")){
+            ui_send(c, "UI BANNER_ADMIN_CLR");
+            return;
+        }
+        if(!strncmp(buf, "CTRL IBANNER_SET ", 18)){
+            ui_send(c, "UI BANNER_IDLE_SET %s", buf + 18);
+            return;
+        }
+        if(!strcmp(buf, "CTRL IBANNER_CLR")){
+            ui_send(c, "UI BANNER_IDLE_CLR");
+            return;
         }
 
-        buf[n] = '\0';
+        // Demande de bascule vers un autre groupe (fusion)
+        if(!strncmp(buf, "CTRL REDIRECT ", 14)){
+            char ng[32]={0}, reason[128]={0};
+            unsigned p = 0;
+            int gid = -1;
+            const char *payload = buf + 14;
 
-        char *save = NULL;
-        char *line = strtok_r(buf, "\n", &save);
-        while(line){
-            char name[32]; unsigned port;
-            if(sscanf(line, "%31s %u", name, &port) == 2){
-                if(!strcmp(name, gname)){
-                    if(out_port) *out_port = (uint16_t)port;
-                    return 1;
+            // parse "newGroup newPort [@gid] reason..."
+            char *tmp = strdup(payload);
+            if(tmp){
+                char *save=NULL;
+                char *t1=strtok_r(tmp, " ", &save);
+                char *t2=strtok_r(NULL," ", &save);
+                char *t3=save; // reste de la ligne
+                if(t1) isy_strcpy(ng, sizeof ng, t1);
+                if(t2) p=(unsigned)atoi(t2);
+                if(t3 && *t3 == ISY_MUX_TAG){
+                    gid = atoi(t3 + 1);
+                    t3 = strchr(t3, ' ');
+                    if(t3) t3++;
                 }
+                if(t3 && *t3) isy_strcpy(reason, sizeof reason, t3);
+                free(tmp);
             }
-            line = strtok_r(NULL, "\n", &save);
+
+            rx_set_redirect(c, ng, p, gid, reason);
+            return;
         }
 
-        // LIST reçu mais pas trouvé
-        return 0;
+        // CTRL inconnu => log uniquement si en dialogue
+        if(c->in_dialogue){
+            ui_log(c, "%s", buf);
+        }
+        return;
     }
 
-    // aucun LIST reçu après retries
-    return -1;
+    /* ───────── suppression du groupe (inactivité) ───────── */
+    if(!strncmp(buf, "SYS Le groupe est supprime", 26) ||
+       strstr(buf, "Le groupe est supprime")){
+
+        pthread_mutex_lock(&c->mtx);
+        c->group_deleted = 1;
+        pthread_mutex_unlock(&c->mtx);
+
+        if(c->in_dialogue){
+            ui_log(c, "%s", buf);
+        }
+        return;
+    }
+
+    /* ───────── message normal ───────── */
+    if(c->in_dialogue){
+        ui_log(c, "%s", buf);
+    }
 }
 
-/* ───────────────────────── RX thread ───────────────────────── */
+/* Trame binaire du groupe : saut direct sur l'opcode */
+static void rx_bin(ClientCtx *c, const ISYHdr *h, ISYRd *r){
+    char g[32], u[EME_LEN], t[TXT_LEN];
+    char line[TXT_LEN + 96];
+
+    switch(h->op){
+    case ISY_OP_CHAT:
+        if(isy_rd_cstr(r, g, sizeof g) < 0 || isy_rd_cstr(r, u, sizeof u) < 0 ||
+           isy_rd_cstr(r, t, sizeof t) < 0) return;
+        if(c->in_dialogue) ui_log(c, "GROUPE[%s]: Message de %s : %s", g, u, t);
+        return;
+
+    case ISY_OP_LINE:
+        // Mêmes règles qu'une ligne texte (ex : annonce de suppression)
+        if(isy_rd_cstr(r, g, sizeof g) < 0 || isy_rd_cstr(r, t, sizeof t) < 0) return;
+        snprintf(line, sizeof line, "GROUPE[%s]: %s", g, t);
+        rx_text(c, line);
+        return;
+
+    case ISY_OP_BANNER:
+        if(isy_rd_cstr(r, t, sizeof t) < 0) return;
+        if(h->flags & ISY_BF_SET)
+            ui_send(c, "UI %s_SET %s", (h->flags & ISY_BF_IDLE) ? "BANNER_IDLE" : "BANNER_ADMIN", t);
+        else
+            ui_send(c, "UI %s_CLR", (h->flags & ISY_BF_IDLE) ? "BANNER_IDLE" : "BANNER_ADMIN");
+        return;
+
+    case ISY_OP_REDIRECT: {
+        if(isy_rd_cstr(r, g, sizeof g) < 0) return;
+        unsigned port = isy_rd_u16(r);
+        char reason[128];
+        if(isy_rd_cstr(r, reason, sizeof reason) < 0) return;
+        rx_set_redirect(c, g, port, h->gid == ISY_BIN_NOGID ? -1 : (int)h->gid, reason);
+        return;
+    }
+
+    case ISY_OP_TEXT:
+        if(isy_rd_cstr(r, line, sizeof line) < 0) return;
+        rx_text(c, line);
+        return;
+
+    default:
+        return;
+    }
+}
+
+/* ───────────────────────── Réception fiable ───────────────────────── */
+
+static long long now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Remet une trame binaire complète à rx_bin() */
+static void rx_deliver(ClientCtx *c, const void *fr, size_t n){
+    ISYHdr h;
+    ISYRd r;
+    if(isy_bin_parse(fr, n, &h, &r) > 0) rx_bin(c, &h, &r);
+}
+
+/* Rappels de la fenêtre (ISYRx) : arg = ClientCtx */
+static void rx_on_store(void *arg, const void *fr, size_t n, unsigned slot){
+    RxSlot *sl = &((ClientCtx*)arg)->rxs.win[slot];
+    sl->len = (uint16_t)n;
+    memcpy(sl->data, fr, n);
+}
+
+static void rx_on_deliver(void *arg, const void *fr, size_t n, unsigned slot){
+    ClientCtx *c = (ClientCtx*)arg;
+    if(fr) rx_deliver(c, fr, n);
+    else   rx_deliver(c, c->rxs.win[slot].data, c->rxs.win[slot].len);
+}
+
+/* NACK d'une plage manquante [from, from + n) */
+static void rx_on_nack(void *arg, uint32_t from, uint32_t n){
+    ClientCtx *c = (ClientCtx*)arg;
+    RxSeq *q = &c->rxs;
+    uint8_t fr[ISY_BIN_HDR + 2];
+    ISYWr w;
+    isy_bin_begin(&w, fr, sizeof fr, ISY_OP_NACK, 0, q->gid, from);
+    isy_bin_u16(&w, (uint16_t)n);
+    size_t len = isy_bin_end(&w);
+    if(len) (void)sendto(c->sock_rx, fr, len, 0, (struct sockaddr*)&q->to, sizeof q->to);
+}
+
+static void rx_on_lost(void *arg, unsigned long n){
+    ClientCtx *c = (ClientCtx*)arg;
+    if(c->in_dialogue) ui_log(c, "SYS: %lu message(s) perdu(s).", n);
+}
+
+static const ISYRxOps rx_ops = { rx_on_store, rx_on_deliver, rx_on_nack, rx_on_lost };
+
+/* Repart sur un nouveau flux (join / redirect) : fenêtre vidée, destination des NACK figée */
+static void rx_seq_reset(ClientCtx *c, RxSeq *q){
+    pthread_mutex_lock(&c->mtx);
+    c->rx_resync = 0;
+    q->to  = c->grp_addr;
+    q->gid = c->grp_gid >= 0 ? (uint32_t)c->grp_gid : ISY_BIN_NOGID;
+    pthread_mutex_unlock(&c->mtx);
+
+    isy_rx_reset(&q->rx);
+}
 
 /*
     Thread dédié à la réception UDP sur sock_rx (messages du groupe).
     - Les CTRL sont traités même hors dialogue (bannières doivent être maintenues).
     - Les autres messages (chat/logs) ne sont envoyés à l’UI que si in_dialogue==1,
       afin de ne pas polluer l’affichage du menu.
+    - Trame binaire (1er octet ISY_BIN_MAGIC) -> rx_bin(), sinon ligne texte -> rx_text().
+    - Diffusions numérotées du groupe courant : remises dans l'ordre (isy_rx_frame),
+      le select() se réveille aussi à l'échéance de relance d'un NACK.
 */
 static void *rx_thread(void *arg){
     ClientCtx *c = (ClientCtx*)arg;
-    char buf[TXT_LEN + 256];
+    RxSeq *q = &c->rxs;
+    char buf[ISY_BIN_MAX];
 
-    // petit timeout pour ne pas bloquer indéfiniment
-    struct timeval tv; tv.tv_sec = 0; tv.tv_usec = 300000;
-    setsockopt(c->sock_rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    t_rx_thread = 1;
+    isy_rx_init(&q->rx, &rx_ops, c);
+    q->win = (RxSlot*)calloc(ISY_RX_WINDOW, sizeof *q->win);
+    if(!q->win) die_perror("calloc rx");
 
     while(!c->stop_rx){
+        if(c->rx_resync) rx_seq_reset(c, q);
+        isy_rx_tick(&q->rx, now_ms());
+
+        // petit timeout pour ne pas bloquer indéfiniment (plus court si un NACK attend)
+        long long wait = 300;
+        if(q->rx.held){
+            wait = q->rx.nack_at - now_ms();
+            if(wait < 0) wait = 0;
+        }
+        struct timeval tv;
+        tv.tv_sec  = (time_t)(wait / 1000);
+        tv.tv_usec = (suseconds_t)(wait % 1000) * 1000;
+
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(c->sock_rx, &rfds);
+        if(select(c->sock_rx + 1, &rfds, NULL, NULL, &tv) <= 0) continue;
+
         struct sockaddr_in from; socklen_t fl = sizeof from;
-        ssize_t n = recvfrom(c->sock_rx, buf, sizeof buf - 1, 0,
+        ssize_t n = recvfrom(c->sock_rx, buf, sizeof buf - 1, MSG_DONTWAIT,
                              (struct sockaddr*)&from, &fl);
 
         if(n < 0){
@@ -420,86 +1292,29 @@ static void *rx_thread(void *arg){
             continue;
         }
 
-        buf[n] = '\0';
-
-        /* ───────── CTRL (bannières / redirect / etc.) ───────── */
-        if(!strncmp(buf, "CTRL ", 5)){
-            if(!strncmp(buf, "CTRL BANNER_SET ", 16)){
-                ui_send(c, "UI BANNER_ADMIN_SET %s", buf + 16);
-                continue;
-            }
-            if(!strcmp(buf, "CTRL BANNER_CLR")){
-                ui_send(c, "UI BANNER_ADMIN_CLR");
-                continue;
-            }
-            if(!strncmp(buf, "CTRL IBANNER_SET ", 18)){
-                ui_send(c, "UI BANNER_IDLE_SET %s", buf + 18);
-                continue;
-            }
-            if(!strcmp(buf, "CTRL IBANNER_CLR")){
-                ui_send(c, "UI BANNER_IDLE_CLR");
-                continue;
-            }
-
-            // Demande de bascule vers un autre groupe (fusion)
-            if(!strncmp(buf, "CTRL REDIRECT ", 14)){
-                char ng[32]={0}, reason[128]={0};
-                unsigned p = 0;
-                const char *payload = buf + 14;
-
-                // parse "newGroup newPort reason..."
-                char *tmp = strdup(payload);
-                if(tmp){
-                    char *save=NULL;
-                    char *t1=strtok_r(tmp, " ", &save);
-                    char *t2=strtok_r(NULL," ", &save);
-                    char *t3=save; // reste de la ligne
-                    if(t1) isy_strcpy(ng, sizeof ng, t1);
-                    if(t2) p=(unsigned)atoi(t2);
-                    if(t3 && *t3) isy_strcpy(reason, sizeof reason, t3);
-                    free(tmp);
-                }
-
-                pthread_mutex_lock(&c->mtx);
-                c->redirect_pending = 1;
-                isy_strcpy(c->redirect_group, sizeof c->redirect_group, ng);
-                c->redirect_port = (uint16_t)p;
-                isy_strcpy(c->redirect_reason, sizeof c->redirect_reason,
-                           reason[0] ? reason : "redirect");
-                pthread_mutex_unlock(&c->mtx);
-
-                if(c->in_dialogue){
-                    ui_log(c, "SYS: redirect demande par le serveur… bascule automatique.");
-                }
-                continue;
-            }
-
-            // CTRL inconnu => log uniquement si en dialogue
-            if(c->in_dialogue){
-                ui_log(c, "%s", buf);
-            }
-            continue;
-        }
-
-        /* ───────── suppression du groupe (inactivité) ───────── */
-        if(!strncmp(buf, "SYS Le groupe est supprime", 26) ||
-           strstr(buf, "Le groupe est supprime")){
-
-            pthread_mutex_lock(&c->mtx);
-            c->group_deleted = 1;
-            pthread_mutex_unlock(&c->mtx);
-
-            if(c->in_dialogue){
-                ui_log(c, "%s", buf);
+        ISYHdr h;
+        ISYRd r;
+        int k = isy_bin_parse(buf, (size_t)n, &h, &r);
+        if(k > 0){
+            // flux courant : adresse du groupe et, en mono-port (port partagé), son gid
+            int cur = (from.sin_port == q->to.sin_port && from.sin_addr.s_addr == q->to.sin_addr.s_addr &&
+                       h.gid == q->gid);
+            if(cur && h.op == ISY_OP_GAP){
+                unsigned cnt = isy_rd_u16(&r);
+                if(!r.err) isy_rx_gap(&q->rx, h.seq, cnt, now_ms());
             }
+            else if(cur && h.seq)         isy_rx_frame(&q->rx, h.seq, buf, (size_t)n, now_ms());
+            else                          rx_bin(c, &h, &r);
             continue;
         }
+        if(k < 0) continue;
 
-        /* ───────── message normal ───────── */
-        if(c->in_dialogue){
-            ui_log(c, "%s", buf);
-        }
+        buf[n] = '\0';
+        rx_text(c, buf);
     }
+
+    free(q->win);
+    q->win = NULL;
     return NULL;
 }
 
@@ -521,10 +1336,23 @@ static int start_ui(ClientCtx *c){
     if(mkfifo(c->fifo_in, 0600) < 0) return -1;
     if(mkfifo(c->fifo_out, 0600) < 0) return -1;
 
+#ifdef __linux__
+    ui_ring_open(c);
+#endif
+
     pid_t p = fork();
     if(p < 0) return -1;
 
     if(p == 0){
+#ifdef __linux__
+        if(c->ui_ring){
+            char efd[16];
+            snprintf(efd, sizeof efd, "%d", c->ui_efd);
+            execl("./AffichageISY", "AffichageISY", c->fifo_in, c->fifo_out,
+                  c->ui_shm, efd, (char*)NULL);
+            _exit(127);
+        }
+#endif
         execl("./AffichageISY", "AffichageISY", c->fifo_in, c->fifo_out, (char*)NULL);
         _exit(127);
     }
@@ -538,16 +1366,24 @@ static int start_ui(ClientCtx *c){
     c->ui_out_fd = open(c->fifo_out, O_RDWR);
     if(c->ui_out_fd < 0) return -1;
 
+    if(ui_queue_start(c) < 0) return -1;
+
     ui_set_header(c);
+    if(c->ui_history) ui_send(c, "UI HISTORY %u", c->ui_history);
+    if(c->ui_fps >= 0) ui_send(c, "UI FPS %d", c->ui_fps);
     ui_send(c, "UI CLRLOG");
     ui_help(c);
     return 0;
 }
 
-/* Arrêt UI : envoie UI QUIT puis ferme / supprime les FIFOs */
+/* Arrêt UI : envoie UI QUIT puis ferme / supprime les FIFOs (et le ring SHM) */
 static void stop_ui(ClientCtx *c){
     if(c->ui_in_fd >= 0){
         ui_send(c, "UI QUIT");
+        ui_queue_stop(c);
+#ifdef __linux__
+        ui_ring_close(c);
+#endif
         close(c->ui_in_fd);
         c->ui_in_fd = -1;
     }
@@ -597,11 +1433,12 @@ static void dialog_loop(ClientCtx *c){
               - envoyer (joined) pour recevoir bannières actives du nouveau groupe
         */
         if(redir){
-            char ng[32]; uint16_t np; char rs[128];
+            char ng[32]; uint16_t np; int ngid; char rs[128];
 
             pthread_mutex_lock(&c->mtx);
             isy_strcpy(ng, sizeof ng, c->redirect_group);
             np = c->redirect_port;
+            ngid = c->redirect_gid;
             isy_strcpy(rs, sizeof rs, c->redirect_reason);
             c->redirect_pending = 0;
             pthread_mutex_unlock(&c->mtx);
@@ -612,6 +1449,7 @@ static void dialog_loop(ClientCtx *c){
             c->grp_addr.sin_family = AF_INET;
             c->grp_addr.sin_port   = htons(np);
             c->grp_addr.sin_addr   = c->srv_addr.sin_addr;
+            c->grp_gid             = ngid;
 
             pthread_mutex_lock(&c->mtx);
             isy_strcpy(c->current_group, sizeof c->current_group, ng);
@@ -662,7 +1500,7 @@ static void dialog_loop(ClientCtx *c){
                 continue;
             }
 
-            // ban <pseudo> : envoie CMD BAN2 <token> <adminUser> <victim>
+            // ban <pseudo> : envoie CMD BAN2 <token> <adminUser> <victim> (ou trame BAN)
             if(!strncmp(line, "ban ", 4)){
                 const char *victim = line + 4;
                 const char *tok = token_get(c, c->current_group);
@@ -670,9 +1508,7 @@ static void dialog_loop(ClientCtx *c){
                     ui_log(c, "SYS: pas admin (token manquant).");
                     continue;
                 }
-                char out2[256];
-                snprintf(out2, sizeof out2, "CMD BAN2 %s %s %s", tok, c->user, victim);
-                sendto(c->sock_rx, out2, strlen(out2), 0, (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+                group_send_ban(c, 1, tok, victim);
                 ui_log(c, "SYS: commande BAN envoyee.");
                 continue;
             }
@@ -685,9 +1521,7 @@ static void dialog_loop(ClientCtx *c){
                     ui_log(c, "SYS: pas admin (token manquant).");
                     continue;
                 }
-                char out2[256];
-                snprintf(out2, sizeof out2, "CMD UNBAN2 %s %s %s", tok, c->user, victim);
-                sendto(c->sock_rx, out2, strlen(out2), 0, (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+                group_send_ban(c, 0, tok, victim);
                 ui_log(c, "SYS: commande UNBAN envoyee.");
                 continue;
             }
@@ -713,14 +1547,11 @@ static void dialog_loop(ClientCtx *c){
 
                 char req[256];
                 snprintf(req, sizeof req, "MERGE %s %s %s %s %s", c->user, tA, A, tB, B);
-                sendto(c->sock_srv, req, strlen(req), 0, (struct sockaddr*)&c->srv_addr, sizeof c->srv_addr);
 
                 // réponse serveur (avec timeout configuré sur sock_srv)
                 char resp[256];
-                struct sockaddr_in from; socklen_t fl = sizeof from;
-                ssize_t n = recvfrom(c->sock_srv, resp, sizeof resp - 1, 0, (struct sockaddr*)&from, &fl);
+                ssize_t n = srv_request(c, req, resp, sizeof resp);
                 if(n > 0){
-                    resp[n] = '\0';
                     ui_log(c, "%s", resp);
                 }else{
                     ui_log(c, "SYS: merge envoye (pas de reponse immediate).");
@@ -733,9 +1564,7 @@ static void dialog_loop(ClientCtx *c){
         }
 
         /* ───────── mode messages ───────── */
-        char out[512];
-        snprintf(out, sizeof out, "MSG %s %s", c->user, line);
-        sendto(c->sock_rx, out, strlen(out), 0, (struct sockaddr*)&c->grp_addr, sizeof c->grp_addr);
+        group_send_msg(c, line);
     }
 
     c->in_dialogue = 0;
@@ -759,7 +1588,11 @@ static void on_sig(int s){
         pthread_mutex_unlock(&g_ctx->mtx);
 
         if(joined) group_send_left(g_ctx);
-        ui_send(g_ctx, "UI QUIT");
+
+        // directement sur fifo_in (pas ui_send : le verrou de la file UI peut être tenu par le thread interrompu) ;
+        // l'UI vide le ring avant fifo_in, donc QUIT reste bien le dernier événement.
+        static const char quit[] = "UI QUIT\n";
+        if(g_ctx->ui_in_fd >= 0 && write(g_ctx->ui_in_fd, quit, sizeof quit - 1) < 0){ /* UI déjà partie */ }
     }
 }
 
@@ -777,6 +1610,12 @@ int main(int argc, char **argv){
         char srv_ip[64];
         uint16_t srv_port;
         uint16_t local_port;
+        int wire_text;          // WIRE_PROTOCOL=text : jamais de trame binaire
+        char shm_prefix[64];    // ring SHM vers l'UI ("none" => FIFO seule)
+        unsigned ui_history;    // lignes gardées par AffichageISY (0 => défaut UI)
+        int ui_fps;             // rendus max/s de AffichageISY (-1 => défaut UI)
+        unsigned ui_queue;      // lignes en attente max vers l'UI
+        int ui_overflow;        // UI_OVF_* (file UI pleine)
     } ClientConf;
 
     /* valeurs par défaut */
@@ -786,6 +1625,8 @@ int main(int argc, char **argv){
     isy_strcpy(conf.srv_ip, sizeof conf.srv_ip, "127.0.0.1");
     conf.srv_port = 8000;
     conf.local_port = 9001;
+    isy_strcpy(conf.shm_prefix, sizeof conf.shm_prefix, "/isy");
+    conf.ui_fps = -1;
 
     /* lecture du fichier de config */
     FILE *f = fopen(argv[1], "r");
@@ -799,6 +1640,13 @@ int main(int argc, char **argv){
             else if(!strcmp(k,"SERVER_IP")) isy_strcpy(conf.srv_ip, sizeof conf.srv_ip, v);
             else if(!strcmp(k,"SERVER_PORT")) conf.srv_port = (uint16_t)atoi(v);
             else if(!strcmp(k,"LOCAL_RECV_PORT")) conf.local_port = (uint16_t)atoi(v);
+            else if(!strcmp(k,"WIRE_PROTOCOL")) conf.wire_text = !strcmp(v, "text");
+            else if(!strcmp(k,"SHM_PREFIX")) isy_strcpy(conf.shm_prefix, sizeof conf.shm_prefix, v);
+            else if(!strcmp(k,"UI_HISTORY")) conf.ui_history = (unsigned)strtoul(v, NULL, 10);
+            else if(!strcmp(k,"UI_FPS")) conf.ui_fps = atoi(v);
+            else if(!strcmp(k,"UI_QUEUE")) conf.ui_queue = (unsigned)strtoul(v, NULL, 10);
+            else if(!strcmp(k,"UI_OVERFLOW"))
+                conf.ui_overflow = !strcmp(v, "block") ? UI_OVF_BLOCK : !strcmp(v, "drop") ? UI_OVF_DROP : UI_OVF_COALESCE;
         }
     }
     fclose(f);
@@ -810,6 +1658,14 @@ int main(int argc, char **argv){
 
     c.ui_in_fd = -1;
     c.ui_out_fd = -1;
+    c.ui_efd = -1;
+    isy_strcpy(c.shm_prefix, sizeof c.shm_prefix, conf.shm_prefix);
+    c.ui_history = conf.ui_history;
+    c.ui_fps = conf.ui_fps;
+    c.uiq.cap = conf.ui_queue;
+    c.uiq.policy = conf.ui_overflow;
+    c.grp_gid = -1;
+    c.wire = conf.wire_text ? WIRE_TEXT : WIRE_TRY;
     c.in_dialogue = 0;
 
     isy_strcpy(c.user, sizeof c.user, conf.user);
@@ -872,24 +1728,8 @@ int main(int argc, char **argv){
 
         /* 2: lister les groupes */
         if(!strcmp(in, "2")){
-            const char *cmd = "LIST";
-            sendto(c.sock_srv, cmd, strlen(cmd), 0, (struct sockaddr*)&c.srv_addr, sizeof c.srv_addr);
-
-            char resp[4096];
-            struct sockaddr_in from; socklen_t fl = sizeof from;
-            ssize_t n = recvfrom(c.sock_srv, resp, sizeof resp - 1, 0, (struct sockaddr*)&from, &fl);
-
-            if(n > 0){
-                resp[n]='\0';
-                char *save=NULL;
-                char *ln = strtok_r(resp, "\n", &save);
-                while(ln){
-                    ui_log(&c, "%s", ln);
-                    ln = strtok_r(NULL, "\n", &save);
-                }
-            } else {
-                ui_log(&c, "(pas de reponse LIST)");
-            }
+            if(server_list_all(&c, 1, list_log_line, &c) < 0)
+                ui_log(&c, "(pas de reponse LIST, liste eventuellement incomplete)");
             continue;
         }
 
@@ -903,26 +1743,23 @@ int main(int argc, char **argv){
 
             char req[128];
             snprintf(req, sizeof req, "CREATE %s %s", in, c.user);
-            sendto(c.sock_srv, req, strlen(req), 0, (struct sockaddr*)&c.srv_addr, sizeof c.srv_addr);
 
             char resp[256];
-            struct sockaddr_in from; socklen_t fl = sizeof from;
-            ssize_t n = recvfrom(c.sock_srv, resp, sizeof resp - 1, 0, (struct sockaddr*)&from, &fl);
+            ssize_t n = srv_request(&c, req, resp, sizeof resp);
 
             if(n <= 0){
                 ui_log(&c, "ERR: pas de reponse");
                 continue;
             }
-            resp[n]='\0';
 
-            // format attendu: OK <group> <port> [token]
+            // format attendu: OK <group> <port> [token] (mono-port : OK <group> <port> <token|-> @<gid>)
             char okg[32]={0}, tok[ADMIN_TOKEN_LEN]={0};
             unsigned p=0;
             int nb = sscanf(resp, "OK %31s %u %63s", okg, &p, tok);
 
             ui_log(&c, "%s", resp);
 
-            if(nb == 3 && tok[0]){
+            if(nb == 3 && tok[0] && tok[0] != '-' && tok[0] != ISY_MUX_TAG){
                 token_set(&c, okg, tok);
                 ui_log(&c, "SYS: tu es ADMIN de %s. (cmd -> admin)", okg);
             } else {
@@ -949,19 +1786,16 @@ int main(int argc, char **argv){
 
             char req[256];
             snprintf(req, sizeof req, "JOIN %s %s 0.0.0.0 0", in, c.user);
-            sendto(c.sock_srv, req, strlen(req), 0, (struct sockaddr*)&c.srv_addr, sizeof c.srv_addr);
 
             char resp[256];
-            struct sockaddr_in from; socklen_t fl = sizeof from;
-            ssize_t n = recvfrom(c.sock_srv, resp, sizeof resp - 1, 0, (struct sockaddr*)&from, &fl);
+            ssize_t n = srv_request(&c, req, resp, sizeof resp);
 
             if(n <= 0){
                 ui_log(&c, "Join failed (pas de reponse)");
                 continue;
             }
-            resp[n]='\0';
 
-            // format attendu: OK <group> <port>
+            // format attendu: OK <group> <port> (mono-port : OK <group> <port> @<gid>)
             unsigned p=0; char okg[32]={0};
             if(sscanf(resp, "OK %31s %u", okg, &p) != 2){
                 ui_log(&c, "%s", resp);
@@ -975,6 +1809,7 @@ int main(int argc, char **argv){
             c.grp_addr.sin_family = AF_INET;
             c.grp_addr.sin_port = htons((uint16_t)p);
             c.grp_addr.sin_addr = c.srv_addr.sin_addr;
+            c.grp_gid = parse_gid(resp);
             c.group_deleted = 0;
             pthread_mutex_unlock(&c.mtx);
 
@@ -1005,11 +1840,11 @@ int main(int argc, char **argv){
 
             /*
                 Vérification optionnelle :
-                  - LIST reçu ET groupe absent => reset (cas suppression)
-                  - LIST non reçu => on ne reset pas (UDP peut drop)
+                  - réponse reçue ET groupe absent => reset (cas suppression)
+                  - pas de réponse => on ne reset pas (UDP peut drop)
             */
             uint16_t dummy_port;
-            int chk = server_list_and_find(&c, cg, &dummy_port);
+            int chk = server_lookup(&c, cg, &dummy_port, NULL);
 
             if(chk == 0){
                 ui_log(&c, "Le groupe n'existe plus (supprime). Etat reset.");
@@ -1017,7 +1852,7 @@ int main(int argc, char **argv){
                 continue;
             }
             if(chk < 0){
-                ui_log(&c, "SYS: serveur ne repond pas a LIST (UDP). On tente d'entrer en dialogue quand meme.");
+                ui_log(&c, "SYS: serveur ne repond pas a LOOKUP (UDP). On tente d'entrer en dialogue quand meme.");
             }
 
             ui_send(&c, "UI CLRLOG");
@@ -1072,6 +1907,18 @@ int main(int argc, char **argv){
 
     stop_ui(&c);
 
+    if(c.rxs.rx.frames)
+        fprintf(stderr, "[ClientISY] reception: %lu diffusions, %lu NACK, %lu recuperees, %lu perdues, %lu doublons\n",
+                c.rxs.rx.frames, c.rxs.rx.nacks, c.rxs.rx.recovered, c.rxs.rx.lost, c.rxs.rx.dups);
+    if(c.ui_lines)
+        fprintf(stderr, "[ClientISY] ui shm: %lu lignes, %lu reveils eventfd%s\n",
+                c.ui_lines, c.ui_kicks, c.ui_fifo_only ? " (repli FIFO)" : "");
+
+    if(c.uiq.sent)
+        fprintf(stderr, "[ClientISY] ui: %lu lignes transmises, %lu writev, %lu jetees (UI_OVERFLOW=%s, file %u)\n",
+                c.uiq.sent, c.uiq.batches, c.uiq.dropped,
+                c.uiq.policy == UI_OVF_BLOCK ? "block" : c.uiq.policy == UI_OVF_DROP ? "drop" : "coalesce",
+                c.uiq.cap);
     pthread_mutex_destroy(&c.mtx);
     return 0;
 }
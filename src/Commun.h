@@ -8,6 +8,7 @@
    - utilitaires (die_perror, trimnl, isy_strcpy)
    - structures SHM ring buffer (si utilisées)
    - constantes protocole (CREATE/JOIN/LIST + MERGE/REDIRECT + BAN)
+   - protocole binaire v1 (en-tête fixe + champs préfixés par leur longueur)
    - constantes UI (ClientISY <-> AffichageISY via FIFO)
    ─────────────────────────────────────────────────────────────────────────── */
 
@@ -37,7 +38,7 @@
 #define EME_LEN    20
 #define TXT_LEN    512
 
-/* SHM ring buffer (si utilisé) */
+/* Message ISYMsg : historique des groupes (GroupeISY) et ring SHM (si utilisé) */
 #define SHM_RING_CAP 256
 
 typedef struct {
@@ -46,26 +47,52 @@ typedef struct {
     char Texte[TXT_LEN];       // payload affiché
 } ISYMsg;
 
+/*
+    Ring SHM ClientISY -> AffichageISY (un producteur, un consommateur) :
+      - le producteur remplit ring[widx % CAP] puis publie widx (release) ;
+      - le consommateur copie ring[ridx % CAP] puis publie ridx (release) ;
+        le ring est plein quand widx - ridx == SHM_RING_CAP.
+      - Ordre = ISY_RING_LINE (fin de ligne) ou ISY_RING_CONT (morceau d'une
+        ligne plus longue que Texte, la suite est dans la case suivante).
+      - Sonnette : avant de dormir, le consommateur pose waiting=1 puis
+        relit widx ; le producteur, après publication, ne réveille (eventfd)
+        que si waiting était à 1. Une rafale ne coûte donc aucun appel système
+        par ligne côté producteur.
+*/
+#define ISY_RING_LINE "LINE"
+#define ISY_RING_CONT "CONT"
+
 typedef struct {
     volatile uint32_t widx;    // index écriture (monotone)
     volatile int closed;       // 1 => affichage doit quitter
+    volatile uint32_t ridx;    // index lecture (monotone, écrit par le consommateur)
+    volatile uint32_t waiting; // 1 => le consommateur dort, réveil attendu
     ISYMsg ring[SHM_RING_CAP];
 } ISYRing;
 
 /* ───────── Protocole client <-> serveur (ServeurISY UDP) ─────────
    Requêtes:
      "LIST"
+     "LIST [cursor] [+members]" (page suivante / nombre de membres par groupe)
      "CREATE <group>"
      "CREATE <group> <user>"    (pour recevoir token admin)
      "JOIN <group> <user> <cip> <cport>"      (cip/cport ignorés côté groupe, NAT OK)
      "MERGE <user> <tokenA> <groupA> <tokenB> <groupB>"
+     "LOOKUP <group>"           (résolution directe nom -> port, sans LIST)
    Réponses:
      "OK <group> <port> [token]"  ou "ERR <reason>"
+     LIST : "<group> <port>[ <members>]\n" par groupe, au plus ~ISY_LIST_PAGE octets ;
+            dernière ligne "#more=<cursor>" s'il reste des groupes (à repasser à LIST)
+     LOOKUP : "OK <group> <port> [@<gid>]" ou "ERR notfound" (réponse de taille fixe)
 */
 #define ISY_CMD_LIST    "LIST"
+#define ISY_LIST_MEMBERS "+members"
+#define ISY_LIST_MORE   "#more="
+#define ISY_LIST_PAGE   1200        // octets d'entrées par page (tient dans un datagramme)
 #define ISY_CMD_CREATE  "CREATE"
 #define ISY_CMD_JOIN    "JOIN"
 #define ISY_CMD_MERGE   "MERGE"
+#define ISY_CMD_LOOKUP  "LOOKUP"
 
 /* ───────── Protocole admin serveur -> groupes (vers GroupeISY UDP local) ─────
    Contrôles existants:
@@ -75,6 +102,7 @@ typedef struct {
      "CTRL IBANNER_CLR"
    Nouveaux contrôles:
      "CTRL REDIRECT <newGroup> <newPort> <reason...>"
+     "CTRL HISTORY <n>"   (messages gardés par le groupe et rejoués à chaque join)
 */
 #define ISY_CTRL_PREFIX       "CTRL"
 #define ISY_CTRL_BANNER_SET   "CTRL BANNER_SET"
@@ -82,6 +110,46 @@ typedef struct {
 #define ISY_CTRL_IBANNER_SET  "CTRL IBANNER_SET"
 #define ISY_CTRL_IBANNER_CLR  "CTRL IBANNER_CLR"
 #define ISY_CTRL_REDIRECT     "CTRL REDIRECT"
+#define ISY_CTRL_HISTORY      "CTRL HISTORY"
+
+/* ───────── Protocole serveur <-> workers GroupeISY (GROUP_WORKERS > 0) ─────────
+   Un worker (GroupeISY --worker) héberge plusieurs groupes dans une boucle epoll.
+   Serveur -> worker (socket de contrôle 127.0.0.1 hérité par le worker):
+     "CTRL ADDGROUP <group> <port> <idleSec>"
+   Worker -> serveur (réponse à l'émetteur des ADDGROUP, depuis ce même socket):
+     "GONE <group>"            (groupe arrêté, ou création impossible)
+   Chaque groupe garde son port UDP et le protocole CTRL ci-dessus.
+   Groupe (ou worker) -> serveur, quand le nombre de membres change :
+     "GSTAT <group> <members>" (affiché par "LIST +members")
+   Groupe (ou worker) -> serveur, une fois le socket du groupe lié (démarrage,
+   ASSIGN, ADDGROUP) ; le serveur retient jusque-là la réponse au CREATE :
+     "READY <group>"
+*/
+#define ISY_CTRL_ADDGROUP     "CTRL ADDGROUP"
+#define ISY_WORKER_GONE       "GONE"
+#define ISY_GROUP_STAT        "GSTAT"
+#define ISY_GROUP_READY       "READY"
+
+/* ───────── Réserve de processus GroupeISY (GROUP_POOL > 0 côté serveur) ─────────
+   Un processus de réserve (GroupeISY --pool) attend sur un socket de contrôle
+   127.0.0.1 hérité du serveur ; au CREATE, le serveur lui attribue le groupe:
+     "CTRL ASSIGN <group> <port> <idleSec>"
+   Le processus devient alors un GroupeISY classique (un groupe, son port UDP).
+*/
+#define ISY_CTRL_ASSIGN       "CTRL ASSIGN"
+
+/* ───────── Mode mono-port (GROUP_MUX_PORT > 0 côté serveur) ─────────
+   Tous les groupes partagent un seul port UDP ; chaque datagramme destiné à un
+   groupe (client -> groupe, serveur -> groupe) est préfixé par son identifiant:
+     "@<gid> <datagramme habituel>"     ex: "@12 MSG bob salut"
+   Les réponses serveur portent le gid en dernier champ:
+     "OK <group> <port> <token|-> @<gid>"   (CREATE)
+     "OK <group> <port> @<gid>"             (JOIN)
+     "CTRL REDIRECT <newGroup> <newPort> @<gid> <reason...>"
+   Les datagrammes groupe -> client sont inchangés (pas de préfixe).
+   Serveur -> worker: "CTRL ADDGROUP <group> 0 <idleSec> <gid>"
+*/
+#define ISY_MUX_TAG           '@'
 
 /* ───────── Protocole client <-> groupe (GroupeISY UDP) ─────────
    Messages:
@@ -108,10 +176,408 @@ typedef struct {
 #define ISY_CMD_G_BAN2       "CMD BAN2"
 #define ISY_CMD_G_UNBAN2     "CMD UNBAN2"
 
+/* ───────── Protocole binaire v1 (négocié, repli texte) ─────────
+   Trame = en-tête fixe ISY_BIN_HDR octets (ordre réseau) + champs :
+     [0] magic ISY_BIN_MAGIC   [1] version   [2] opcode   [3] flags
+     [4..7]   gid  (mono-port ; ISY_BIN_NOGID sinon)
+     [8..11]  seq  (0 = non numéroté)
+     [12..13] len  (octets de champs qui suivent l'en-tête)   [14..15] réservé (0)
+   Champs : u16 (2 octets) ou chaîne = longueur u16 + octets (sans '\0').
+   Le premier octet (0xB5, non ASCII) distingue une trame d'une ligne texte.
+
+   Négociation :
+     - le client envoie ses requêtes serveur en binaire ; une réponse texte
+       (ancien serveur, "ERR bad_version") ou une absence de réponse le fait
+       repasser en texte pour toute la session
+     - le serveur et le groupe répondent dans le format de la requête reçue ;
+       le groupe retient par membre le format de son dernier MSG
+     - client <-> groupe en binaire seulement si le serveur a répondu en binaire
+     - en mono-port, le gid de l'en-tête remplace le préfixe "@<gid> "
+     - serveur <-> groupe (CTRL/SYS/ADDGROUP) et ClientISY <-> AffichageISY restent en texte
+
+   Opcodes (champs) :
+     client -> serveur : LIST (seq = cursor) + flags ISY_LF_MEMBERS
+                         CREATE (group, user|"") ; JOIN (group, user)
+                         MERGE (user, tokA, groupA, tokB, groupB) ; LOOKUP (group)
+     serveur -> client : OK (group, port u16, token|"") + gid en en-tête
+                         ERR (reason) ; LISTR ((group, port u16[, members u16]) répétés)
+                           + flags ISY_LF_*, seq = cursor de la page suivante
+     client -> groupe  : MSG (user, text) ; BAN / UNBAN (token, adminUser, victim)
+                         NACK (count u16) : redemande les diffusions seq .. seq+count-1
+     groupe -> client  : CHAT (group, user, text)  = "GROUPE[g]: Message de u : t"
+                         LINE (group, line)        = "GROUPE[g]: line"
+                         BANNER (text|"") + flags ISY_BF_*
+                         REDIRECT (group, port u16, reason) + gid en en-tête
+                         GAP (count u16) : diffusions seq .. seq+count-1 perdues pour de bon
+     tous sens         : TEXT (ligne) = ligne texte encapsulée, traitée comme en texte
+
+   Livraison fiable groupe -> client (membres binaires) :
+     - chaque diffusion du groupe porte un seq croissant (1, 2, ... par groupe) ;
+       les réponses individuelles (bannières au join, SYS/ERR) restent à seq 0 ;
+       en mono-port, diffusions et GAP portent le gid du groupe en en-tête : le
+       client n'applique sa fenêtre qu'au flux (adresse, gid) du groupe courant
+     - le groupe garde les dernières diffusions dans un anneau borné ; un client
+       qui voit un trou envoie NACK, reçoit les trames encore présentes (seq
+       d'origine) et GAP pour celles déjà écrasées
+     - le client remet les trames dans l'ordre (petite fenêtre de réordonnancement)
+*/
+#define ISY_BIN_MAGIC    0xB5
+#define ISY_BIN_VERSION  1
+#define ISY_BIN_HDR      16
+#define ISY_BIN_NOGID    0xFFFFFFFFu
+#define ISY_BIN_MAX      1400       // taille max d'une trame (tient dans un datagramme)
+
+#define ISY_OP_TEXT      0x00
+#define ISY_OP_LIST      0x01
+#define ISY_OP_CREATE    0x02
+#define ISY_OP_JOIN      0x03
+#define ISY_OP_MERGE     0x04
+#define ISY_OP_LOOKUP    0x05
+#define ISY_OP_OK        0x10
+#define ISY_OP_ERR       0x11
+#define ISY_OP_LISTR     0x12
+#define ISY_OP_MSG       0x20
+#define ISY_OP_BAN       0x21
+#define ISY_OP_UNBAN     0x22
+#define ISY_OP_NACK      0x23
+#define ISY_OP_CHAT      0x30
+#define ISY_OP_LINE      0x31
+#define ISY_OP_BANNER    0x32
+#define ISY_OP_REDIRECT  0x33
+#define ISY_OP_GAP       0x34
+
+#define ISY_BF_IDLE      0x01       // BANNER : bannière inactivité (sinon admin)
+#define ISY_BF_SET       0x02       // BANNER : affichage (sinon effacement)
+#define ISY_LF_MEMBERS   0x01       // LIST/LISTR : nombre de membres par groupe
+#define ISY_LF_MORE      0x02       // LISTR : page suivante à demander (cursor = seq)
+
+/* En-tête décodé */
+typedef struct {
+    uint8_t  op;
+    uint8_t  flags;
+    uint32_t gid;
+    uint32_t seq;
+    uint16_t len;
+} ISYHdr;
+
+/* Écriture séquentielle d'une trame (err = 1 si la capacité est dépassée) */
+typedef struct {
+    uint8_t *p;
+    size_t   cap;
+    size_t   off;
+    int      err;
+} ISYWr;
+
+/* Lecture séquentielle des champs d'une trame (err = 1 si trame tronquée) */
+typedef struct {
+    const uint8_t *p;
+    size_t end;
+    size_t off;
+    int    err;
+} ISYRd;
+
+static inline void isy_put16(uint8_t *p, uint16_t v){ v = htons(v); memcpy(p, &v, 2); }
+static inline void isy_put32(uint8_t *p, uint32_t v){ v = htonl(v); memcpy(p, &v, 4); }
+static inline uint16_t isy_get16(const uint8_t *p){ uint16_t v; memcpy(&v, p, 2); return ntohs(v); }
+static inline uint32_t isy_get32(const uint8_t *p){ uint32_t v; memcpy(&v, p, 4); return ntohl(v); }
+
+/* Commence une trame dans buf (en-tête écrit, len complété par isy_bin_end) */
+static inline void isy_bin_begin(ISYWr *w, void *buf, size_t cap, uint8_t op, uint8_t flags, uint32_t gid, uint32_t seq){
+    w->p = (uint8_t*)buf;
+    w->cap = cap;
+    w->off = ISY_BIN_HDR;
+    w->err = (cap < ISY_BIN_HDR);
+    if(w->err) return;
+    w->p[0] = ISY_BIN_MAGIC;
+    w->p[1] = ISY_BIN_VERSION;
+    w->p[2] = op;
+    w->p[3] = flags;
+    isy_put32(w->p + 4, gid);
+    isy_put32(w->p + 8, seq);
+    isy_put16(w->p + 12, 0);
+    isy_put16(w->p + 14, 0);
+}
+
+static inline void isy_bin_u16(ISYWr *w, uint16_t v){
+    if(w->err || w->off + 2 > w->cap){ w->err = 1; return; }
+    isy_put16(w->p + w->off, v);
+    w->off += 2;
+}
+
+static inline void isy_bin_str(ISYWr *w, const char *s, size_t n){
+    if(w->err || n > 0xFFFF || w->off + 2 + n > w->cap){ w->err = 1; return; }
+    isy_put16(w->p + w->off, (uint16_t)n);
+    memcpy(w->p + w->off + 2, s, n);
+    w->off += 2 + n;
+}
+
+static inline void isy_bin_cstr(ISYWr *w, const char *s){
+    isy_bin_str(w, s, strlen(s));
+}
+
+/* Termine la trame : renvoie sa taille totale, 0 si elle ne tient pas */
+static inline size_t isy_bin_end(ISYWr *w){
+    if(w->err || w->off - ISY_BIN_HDR > 0xFFFF) return 0;
+    isy_put16(w->p + 12, (uint16_t)(w->off - ISY_BIN_HDR));
+    return w->off;
+}
+
+/*
+    Décode l'en-tête d'un datagramme de n octets.
+    Retour : 1 trame v1 valide (h, r prêts), 0 ligne texte, -1 trame invalide
+    ou version inconnue.
+*/
+static inline int isy_bin_parse(const void *buf, size_t n, ISYHdr *h, ISYRd *r){
+    const uint8_t *p = (const uint8_t*)buf;
+    if(n == 0 || p[0] != ISY_BIN_MAGIC) return 0;
+    if(n < ISY_BIN_HDR || p[1] != ISY_BIN_VERSION) return -1;
+
+    h->op    = p[2];
+    h->flags = p[3];
+    h->gid   = isy_get32(p + 4);
+    h->seq   = isy_get32(p + 8);
+    h->len   = isy_get16(p + 12);
+    if((size_t)ISY_BIN_HDR + h->len > n) return -1;
+
+    r->p   = p;
+    r->off = ISY_BIN_HDR;
+    r->end = ISY_BIN_HDR + (size_t)h->len;
+    r->err = 0;
+    return 1;
+}
+
+static inline uint16_t isy_rd_u16(ISYRd *r){
+    if(r->err || r->off + 2 > r->end){ r->err = 1; return 0; }
+    uint16_t v = isy_get16(r->p + r->off);
+    r->off += 2;
+    return v;
+}
+
+/* Champ chaîne : pointeur dans la trame (non terminé), longueur dans *n */
+static inline const char *isy_rd_str(ISYRd *r, size_t *n){
+    size_t l = isy_rd_u16(r);
+    if(r->err || r->off + l > r->end){ r->err = 1; *n = 0; return ""; }
+    const char *s = (const char*)r->p + r->off;
+    r->off += l;
+    *n = l;
+    return s;
+}
+
+/* Champ chaîne copié dans dst (tronqué à dsz-1, terminé par '\0') ; -1 si trame tronquée */
+static inline int isy_rd_cstr(ISYRd *r, char *dst, size_t dsz){
+    size_t n;
+    const char *s = isy_rd_str(r, &n);
+    if(r->err) return -1;
+    if(n >= dsz) n = dsz - 1;
+    memcpy(dst, s, n);
+    dst[n] = '\0';
+    return 0;
+}
+
+/* Trame TEXT encapsulant une ligne : taille totale, 0 si elle ne tient pas */
+static inline size_t isy_bin_text(void *buf, size_t cap, uint32_t gid, const char *line){
+    ISYWr w;
+    isy_bin_begin(&w, buf, cap, ISY_OP_TEXT, 0, gid, 0);
+    isy_bin_cstr(&w, line);
+    return isy_bin_end(&w);
+}
+
+/* ───────── Réception fiable d'un flux numéroté (ClientISY, BenchISY) ─────────
+   Les diffusions numérotées d'un groupe sont remises dans l'ordre : celles qui
+   arrivent en avance attendent dans une fenêtre de ISY_RX_WINDOW cases pendant
+   qu'un NACK redemande le trou ; après ISY_RX_TRIES relances espacées de
+   ISY_RX_NACK_MS sans réponse (ou un GAP du groupe), le trou est déclaré perdu
+   et on avance.
+   La fenêtre ne garde que les seq : le contenu d'une case (seq % ISY_RX_WINDOW)
+   appartient à l'appelant, qui le range (store) et le remet (deliver) à la
+   demande. Horloge en ms (monotone), fournie par l'appelant.
+*/
+#define ISY_RX_WINDOW   256
+#define ISY_RX_NACK_MS  40
+#define ISY_RX_TRIES    3
+
+typedef struct {
+    void (*store)(void *arg, const void *fr, size_t n, unsigned slot);    // garder fr en case slot
+    void (*deliver)(void *arg, const void *fr, size_t n, unsigned slot);  // remettre fr, ou la case si fr == NULL
+    void (*nack)(void *arg, uint32_t from, uint32_t n);           // redemander [from, from + n)
+    void (*lost)(void *arg, unsigned long n);                     // n seq abandonnées (peut être NULL)
+} ISYRxOps;
+
+/*
+    Etat d'un flux :
+      - expect  : prochaine seq à remettre (0 = flux pas encore vu)
+      - seq[]   : seq en attente par case (0 = libre) ; held = cases occupées,
+                  top = plus haute seq en attente + 1
+      - nack_at : échéance (ms) de la prochaine relance des trous (si held)
+*/
+typedef struct {
+    uint32_t  expect, top;
+    unsigned  held, tries;
+    long long nack_at;
+    uint32_t  seq[ISY_RX_WINDOW];
+
+    const ISYRxOps *ops;
+    void *arg;
+
+    unsigned long frames, dups, nacks, recovered, lost;
+} ISYRx;
+
+/* Repart sur un nouveau flux (join, redirection) ; compteurs conservés */
+static inline void isy_rx_reset(ISYRx *q){
+    memset(q->seq, 0, sizeof q->seq);
+    q->expect  = 0;
+    q->held    = 0;
+    q->top     = 0;
+    q->nack_at = 0;
+    q->tries   = 0;
+}
+
+static inline void isy_rx_init(ISYRx *q, const ISYRxOps *ops, void *arg){
+    memset(q, 0, sizeof *q);
+    q->ops = ops;
+    q->arg = arg;
+}
+
+static inline void isy_rx_nack_range(ISYRx *q, uint32_t from, uint32_t n){
+    q->ops->nack(q->arg, from, n);
+    q->nacks++;
+}
+
+/* (Re)demande tous les trous de la fenêtre [expect, top) et arme la relance */
+static inline void isy_rx_nack(ISYRx *q, long long now){
+    uint32_t s = q->expect;
+    while((int32_t)(q->top - s) > 0){
+        uint32_t n = 0;
+        while(q->seq[(s + n) % ISY_RX_WINDOW] != s + n) n++;
+        if(n) isy_rx_nack_range(q, s, n);
+        s += n + 1;
+    }
+    q->tries++;
+    q->nack_at = now + ISY_RX_NACK_MS;
+}
+
+/* Remet les cases en attente qui suivent expect (les trous restants sont déjà demandés) */
+static inline void isy_rx_drain(ISYRx *q){
+    unsigned k;
+    while(q->held && q->seq[k = q->expect % ISY_RX_WINDOW] == q->expect){
+        q->ops->deliver(q->arg, NULL, 0, k);
+        q->seq[k] = 0;
+        q->held--;
+        q->expect++;
+    }
+    if(!q->held){
+        q->tries = 0;
+        q->nack_at = 0;
+    }
+}
+
+/* Abandonne les seq manquantes avant upto (remet celles qui sont là), puis draine */
+static inline void isy_rx_skip(ISYRx *q, uint32_t upto, long long now){
+    unsigned long lost = 0;
+
+    while((int32_t)(upto - q->expect) > 0){
+        unsigned k = q->expect % ISY_RX_WINDOW;
+        if(q->seq[k] == q->expect){
+            q->ops->deliver(q->arg, NULL, 0, k);
+            q->seq[k] = 0;
+            q->held--;
+        } else {
+            lost++;
+        }
+        q->expect++;
+    }
+
+    q->lost += lost;
+    if(lost && q->ops->lost) q->ops->lost(q->arg, lost);
+    isy_rx_drain(q);
+
+    // Les trous suivants repartent avec toutes leurs relances
+    if(q->held){
+        q->tries = 0;
+        q->nack_at = now + ISY_RX_NACK_MS;
+    }
+}
+
+/*
+    Diffusion numérotée seq (fr/n = la trame, transmise telle quelle à store/deliver) :
+    remise immédiate si c'est la suivante, sinon mise en attente et NACK du trou.
+    Doublon => ignoré. Une seq très en arrière est un nouveau flux (groupe relancé) :
+    on s'y recale.
+*/
+static inline void isy_rx_frame(ISYRx *q, uint32_t seq, const void *fr, size_t n, long long now){
+    q->frames++;
+
+    if(q->expect == 0 || (int32_t)(q->expect - seq) > 4 * ISY_RX_WINDOW){
+        memset(q->seq, 0, sizeof q->seq);
+        q->held = 0;
+        q->expect = q->top = seq;
+        q->nack_at = 0;
+    }
+
+    int32_t ahead = (int32_t)(seq - q->expect);
+    if(ahead < 0){
+        q->dups++;
+        return;
+    }
+
+    if(ahead == 0){
+        if(q->held) q->recovered++;
+        q->ops->deliver(q->arg, fr, n, 0);
+        q->expect++;
+        if(q->held) isy_rx_drain(q);
+        return;
+    }
+
+    // Trop loin devant : les plus anciens trous sont abandonnés pour faire de la place
+    if(ahead >= ISY_RX_WINDOW) isy_rx_skip(q, seq - ISY_RX_WINDOW + 1, now);
+
+    unsigned k = seq % ISY_RX_WINDOW;
+    if(q->seq[k] == seq){
+        q->dups++;
+        return;
+    }
+    q->seq[k] = seq;
+    q->ops->store(q->arg, fr, n, k);
+    q->held++;
+
+    // Nouveau trou juste avant cette trame : demandé tout de suite (sans attendre les autres)
+    if((int32_t)(seq - q->top) >= 0){
+        uint32_t from = q->top;
+        if((int32_t)(from - q->expect) < 0) from = q->expect;
+        q->top = seq + 1;
+        if(from != seq) isy_rx_nack_range(q, from, seq - from);
+        if(!q->nack_at){
+            q->tries = 1;
+            q->nack_at = now + ISY_RX_NACK_MS;
+        }
+    }
+}
+
+/* GAP du groupe : seq .. seq+count-1 ne seront jamais renvoyées */
+static inline void isy_rx_gap(ISYRx *q, uint32_t seq, unsigned count, long long now){
+    uint32_t end = seq + count;
+    if(q->expect == 0) return;
+    if((int32_t)(seq - q->expect) <= 0 && (int32_t)(end - q->expect) > 0) isy_rx_skip(q, end, now);
+}
+
+/* Echéance de relance : NACK à nouveau, ou trou déclaré perdu après ISY_RX_TRIES */
+static inline void isy_rx_tick(ISYRx *q, long long now){
+    if(!q->held || now < q->nack_at) return;
+
+    if(q->tries < ISY_RX_TRIES){
+        isy_rx_nack(q, now);
+        return;
+    }
+
+    uint32_t s = q->expect + 1;
+    while(q->seq[s % ISY_RX_WINDOW] != s) s++;
+    isy_rx_skip(q, s, now);
+}
+
 /* ───────── Token admin / gestionnaire ───────── */
 #define ADMIN_TOKEN_LEN 64
 
-/* ───────── UI (ClientISY <-> AffichageISY via FIFO) ─────────
+/* ───────── UI (ClientISY <-> AffichageISY via FIFO / ring SHM) ─────────
    Events (Client -> UI), 1 ligne par event :
      UI HEADER <joined:0|1> <user> <group>
      UI LOG <texte...>
@@ -121,6 +587,8 @@ typedef struct {
      UI BANNER_IDLE_SET <texte...>
      UI BANNER_IDLE_CLR
      UI REDRAW
+     UI HISTORY <lignes>        (profondeur de l'historique, 1..100000)
+     UI FPS <n>                 (rendus max par seconde, 0 = à chaque événement)
      UI QUIT
 */
 #define ISY_UI_PREFIX            "UI"
@@ -132,6 +600,8 @@ typedef struct {
 #define ISY_UI_BANNER_IDLE_SET   "UI BANNER_IDLE_SET"
 #define ISY_UI_BANNER_IDLE_CLR   "UI BANNER_IDLE_CLR"
 #define ISY_UI_REDRAW            "UI REDRAW"
+#define ISY_UI_HISTORY           "UI HISTORY"
+#define ISY_UI_FPS               "UI FPS"
 #define ISY_UI_QUIT              "UI QUIT"
 
 /* ───────── Utilitaires ───────── */
@@ -159,8 +629,9 @@ static inline void trimnl(char *s){
 static inline void isy_strcpy(char *dst, size_t dsz, const char *src){
     if(!dst || dsz==0) return;
     if(!src){ dst[0]='\0'; return; }
-    strncpy(dst, src, dsz-1);
-    dst[dsz-1] = '\0';
+    size_t n = strnlen(src, dsz-1);
+    memcpy(dst, src, n);
+    dst[n] = '\0';
 }
 
 #endif // COMMUN_H
@@ -1,4 +1,5 @@
 // src/GroupeISY.c
+#define _GNU_SOURCE     // sendmmsg / struct mmsghdr (Linux)
 #include "Commun.h"
 #include <arpa/inet.h>
 #include <errno.h>
@@ -7,16 +8,27 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <time.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#endif
+
 /*
     ─────────────────────────────────────────────────────────────────────────
     GroupeISY
     ─────────────────────────────────────────────────────────────────────────
     Rôle :
-      - Un processus GroupeISY gère UN SEUL groupe de discussion.
+      - Un processus GroupeISY gère UN SEUL groupe de discussion (mode classique),
+        ou plusieurs groupes à la fois en mode "worker" (voir plus bas).
       - Il reçoit des datagrammes UDP de deux sources :
           1) Les clients :     "MSG ..." ou "CMD ..."
           2) Le serveur :      "CTRL ..." ou "SYS ..." (canal admin local)
@@ -27,49 +39,352 @@
               * bannière admin (fixée par ServeurISY via CTRL BANNER_SET/CLR)
               * bannière inactivité (gérée par un timer interne)
       - Il diffuse les messages à tous les membres (broadcast).
+      - Il garde les HISTORY_LEN derniers messages et les rejoue à chaque arrivée
+        ("(joined)"), en une seule rafale sendmmsg.
+      - Il annonce au serveur son nombre de membres quand il change ("GSTAT", LIST +members).
+      - Il annonce "READY" au serveur dès son socket lié (le serveur retient le CREATE).
+      - Optionnel (GROUP_LOG_DIR) : journal append-only des messages et actions de
+        modération, écrit dans des segments mmap (voir "Journal append-only").
       - Il supprime le groupe automatiquement après un temps d’inactivité, après
         avoir averti via une bannière dédiée.
 
+    Boucle d'événements (Linux) : un seul thread, epoll sur le socket du groupe, un
+    signalfd (SIGINT/SIGTERM) et un timerfd armé à la prochaine échéance exacte
+    (avertissement, suppression, arrêt différé) : aucun réveil tant que rien ne se
+    passe, et plus de mutex sur le chemin des datagrammes. Ailleurs (macOS), le
+    mode classique garde un thread timer (tick 1 s) + SO_RCVTIMEO.
+
+    Mode réserve (GroupeISY --pool ..., lancé d'avance par ServeurISY si GROUP_POOL > 0) :
+      processus prêt qui attend "CTRL ASSIGN <nom> <port> <idle>" puis devient un
+      groupe classique (voir pool_main).
+
+    Mode worker (GroupeISY --worker ..., lancé par ServeurISY si GROUP_WORKERS > 0) :
+      - la même boucle epoll sur : le canal de contrôle du serveur, le signalfd,
+        le timerfd (échéance la plus proche de tous les groupes) et le socket UDP
+        de chaque groupe ;
+      - le serveur y crée les groupes par "CTRL ADDGROUP <nom> <port> <idle>" ;
+      - chaque groupe garde son port UDP et le même protocole qu'en mode classique ;
+      - quand un groupe s'arrête, le worker prévient le serveur par "GONE <nom>"
+        (adresse du serveur reçue en argument, comme en mode réserve ; les
+        datagrammes de contrôle venant d'une autre adresse sont ignorés).
+      - mode mono-port (GROUP_MUX_PORT côté serveur) : le worker lie en plus un port
+        UDP commun ; les datagrammes y sont préfixés "@<gid> " et routés vers le
+        groupe par une table indexée par gid (pas de socket par groupe).
+
+    Protocole binaire (Commun.h) : un client peut parler en trames v1 ; elles sont
+    aiguillées par un switch sur l'opcode (group_handle_bin), et chaque membre reçoit
+    les diffusions dans le format de son dernier MSG (texte ou trame).
+
     Remarque :
       - Le protocole étant UDP, il n’y a pas de "connexion" TCP : on associe un pseudo
-        à l’adresse UDP de son client quand on reçoit des MSG/CMD.
+        à l’adresse UDP de son client (session) au premier MSG, puis les MSG suivants
+        venant de cette adresse sont attribués directement au membre.
       - Pour que le groupe puisse "ré-afficher" les bannières à un client qui rejoint,
         le client envoie un message "MSG <user> (joined)" : cela sert de handshake.
 */
 
-#define MAX_MEMBERS 64  // nombre max d’utilisateurs simultanés dans le groupe
-#define MAX_BANS    128 // liste max de pseudos bannis (en mémoire)
+#define MAX_MEMBERS_DEFAULT 64     // membres simultanés par défaut (argv[4] pour changer)
+#define MAX_BANS_DEFAULT    128    // pseudos bannis par défaut (argv[5] pour changer)
+#define MAX_TABLE_LIMIT     100000 // borne haute acceptée pour ces deux tailles
+#define HISTORY_LEN_DEFAULT 20     // messages rejoués au join par défaut (argv[8] pour changer)
+#define HISTORY_LEN_MAX     256    // borne haute (une rafale sendmmsg)
+#define MMSG_BATCH          1024   // UIO_MAXIOV : taille max d'un vecteur sendmmsg
+#define GNAME_LEN           32     // nom de groupe (même taille que côté serveur)
+
+/* Linux : tout tourne dans une boucle epoll mono-thread, mtx devient inutile */
+#ifdef __linux__
+#define GROUP_LOCKING 0
+#else
+#define GROUP_LOCKING 1
+#endif
 
 /*
     Un membre du groupe :
       - user  : pseudo
       - addr  : adresse UDP (IP:port) du client, pour répondre/broadcaster
-      - inuse : slot utilisé ou non
+      - bin   : 1 si son dernier MSG était une trame binaire (il reçoit alors des trames)
+    Les membres sont rangés de façon dense dans members[0..nmembers).
 */
 typedef struct {
     char user[EME_LEN];
     struct sockaddr_in addr;
-    int inuse;
+    uint8_t bin;
 } Member;
 
 /*
     Entrée de ban :
       - user  : pseudo banni
-      - inuse : slot utilisé ou non
+    Rangées de façon dense dans bans[0..nbans).
 */
 typedef struct {
     char user[EME_LEN];
-    int inuse;
 } BanRec;
 
-/* Flag global d’exécution : modifié par SIGINT/SIGTERM et par le timer inactivité */
+/*
+    Index de hachage (adressage ouvert, sondage linéaire) :
+      - cellule = (hash, idx) ; idx = -1 => cellule vide
+      - taille = puissance de 2 >= 2 x capacité => facteur de charge <= 0.5
+      - suppression par décalage arrière (pas de tombstones)
+    La clé n'est pas dupliquée : on compare via l'entrée pointée (callback eq,
+    qui reçoit le groupe propriétaire des tableaux en ctx).
+*/
+typedef struct {
+    uint32_t h;
+    int idx;
+} HCell;
+
+typedef struct {
+    HCell *cells;
+    uint32_t mask;
+} HIndex;
+
+typedef int (*hidx_eq_fn)(const void *ctx, int idx, const void *key);
+
+#ifndef __linux__
+/* Repli portable (macOS) : pas de sendmmsg, on émule avec un sendmsg par message. */
+struct mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int  msg_len;
+};
+
+static int sendmmsg(int s, struct mmsghdr *vec, unsigned int vlen, int flags){
+    unsigned int i;
+    for(i=0;i<vlen;i++){
+        ssize_t r = sendmsg(s, &vec[i].msg_hdr, flags);
+        if(r < 0) return i ? (int)i : -1;
+        vec[i].msg_len = (unsigned int)r;
+    }
+    return (int)i;
+}
+#endif
+
+/*
+    Statistiques de diffusion (affichées sur stderr à l'arrêt du groupe) :
+      - broadcasts : nombre de diffusions (1 ligne de chat = 1 diffusion)
+      - syscalls   : appels sendmmsg()/sendto() effectués pour ces diffusions
+      - sent       : datagrammes effectivement remis au noyau
+      - partial    : diffusions où sendmmsg() n'a pas tout envoyé en un appel
+      - errors     : destinations en erreur (datagramme non envoyé)
+      - lock_max_ns: plus longue détention de mtx observée (ns, si GROUP_LOCKING)
+      - msg_fast   : MSG attribués via la table de sessions (adresse connue)
+      - msg_slow   : MSG traités par le parse complet (nouvelle adresse)
+      - rebinds    : changements d'adresse d'un pseudo déjà connu
+      - copied     : octets recopiés pour préparer les diffusions (formatage, trames) ;
+                     copied / broadcasts = coût de copie moyen d'une diffusion
+      - nacks      : NACK reçus de membres binaires (trous détectés côté client)
+      - rtx        : trames renvoyées depuis l'anneau de retransmission
+      - gaps       : trames demandées mais déjà sorties de l'anneau (GAP)
+      - replayed   : messages d'historique rejoués aux arrivants
+    Les compteurs d'envoi sont mis à jour hors mtx (envois sans lock) : accès atomiques.
+*/
+typedef struct {
+    unsigned long broadcasts;
+    unsigned long syscalls;
+    unsigned long sent;
+    unsigned long partial;
+    unsigned long errors;
+    unsigned long lock_max_ns;
+    unsigned long msg_fast;
+    unsigned long msg_slow;
+    unsigned long rebinds;
+    unsigned long copied;
+    unsigned long nacks;
+    unsigned long rtx;
+    unsigned long gaps;
+    unsigned long replayed;
+} BcastStats;
+
+#define STAT_ADD(g, field, v) __atomic_fetch_add(&(g)->stats.field, (unsigned long)(v), __ATOMIC_RELAXED)
+
+/*
+    Liste de destinations figée (snapshot) :
+      - copiée depuis members[] sous mtx (16 octets par membre)
+      - puis utilisée pour envoyer SANS tenir mtx
+    Ainsi un envoi lent ne bloque ni la boucle de réception ni le timer.
+    addr/bin/vec sont alloués une fois (capacité max_members) par thread utilisateur.
+    bin[i] : format de la destination i ; nbin : nombre de destinations binaires
+    (0 => la trame binaire d'une diffusion n'est même pas construite).
+*/
+typedef struct {
+    struct sockaddr_in *addr;
+    uint8_t *bin;
+    struct mmsghdr *vec;
+    unsigned n;
+    unsigned nbin;
+} DestSnap;
+
+/*
+    Anneau de retransmission des diffusions binaires (livraison fiable, voir Commun.h) :
+      - chaque diffusion vers des membres binaires reçoit seq = next++ (1, 2, ...)
+      - la trame complète est recopiée dans arena (écriture circulaire) et
+        décrite par ent[seq % RTX_SLOTS] ; [lo, next) = trames encore présentes
+      - une trame est évincée quand son descripteur ou ses octets sont réutilisés
+    Tampons alloués à la première diffusion numérotée (groupes texte : rien).
+*/
+#define RTX_SLOTS  256          // trames retransmissibles au plus
+#define RTX_ARENA  (64 * 1024)  // octets de trames gardés au plus
+#define RTX_BURST  32           // trames renvoyées au plus par NACK
+
+typedef struct {
+    uint32_t seq;
+    uint32_t off;
+    uint32_t len;
+} RtxEnt;
+
+typedef struct {
+    uint8_t *arena;
+    RtxEnt  *ent;
+    uint32_t head;   // prochaine écriture dans arena
+    uint32_t lo;     // plus ancienne seq encore présente
+    uint32_t next;   // prochaine seq attribuée
+} RtxRing;
+
+/*
+    Journal append-only d'un groupe (GROUP_LOG_DIR) : segments
+    <dir>/<groupe>.<numéro>.isylog de taille fixe, mappés en mémoire.
+    Le thread de réception y recopie les enregistrements (aucun appel système) ;
+    un thread de fond (glog_flusher) les synchronise sur disque par lots,
+    garde GLOG_AHEAD segments préparés d'avance et referme ceux qu'on a quittés.
+    La rotation n'est qu'un échange de pointeurs sous mtx, que le flusher ne
+    tient jamais pendant un appel système. Flusher en retard : attente bornée
+    (GLOG_WAIT_MS), puis le thread de réception ouvre lui-même le segment.
+    Aucun enregistrement n'est abandonné tant que le disque accepte un segment.
+*/
+#define GLOG_AHEAD   2      // segments préparés d'avance
+#define GLOG_RETIRED 8      // segments quittés en attente de finalisation
+
+typedef struct {
+    int      fd;
+    uint8_t *base;          // NULL => pas de segment
+    uint32_t size;
+    uint32_t no;            // numéro de segment (1, 2, ...)
+    uint32_t used;          // segment quitté : octets utiles (taille finale du fichier)
+} GlogSeg;
+
+typedef struct GroupLog {
+    char     path[300];             // <dir>/<groupe> (suffixe .<no>.isylog)
+    GlogSeg  cur;                   // segment en cours d'écriture
+    GlogSeg  ready[GLOG_AHEAD];     // segments préparés, numéros croissants
+    unsigned nready;
+    GlogSeg  retired[GLOG_RETIRED]; // segments quittés, à finaliser (plus ancien en tête)
+    unsigned nretired;
+    uint32_t next_no;               // prochain numéro de segment à attribuer
+    uint32_t flushing;              // numéro du segment en cours de msync (flusher), 0 = aucun
+    volatile uint32_t w;            // octets écrits dans cur (publié release)
+    uint32_t synced;                // octets de cur déjà synchronisés (flusher)
+    pthread_mutex_t mtx;            // tout ce qui précède : échanges seulement, aucun appel système tenu
+    pthread_cond_t  cv;             // flusher -> réception : segment prêt / place libérée
+    pthread_mutex_t open_mtx;       // attribution des numéros + ouverture (flusher, ou réception en secours)
+
+    unsigned long records, bytes, rotations, syncs, lost, waits, inlined;
+    struct GroupLog *link;          // liste des journaux ouverts (flusher)
+} GroupLog;
+
+/*
+    Etat d'un groupe (un par groupe hébergé par le processus) :
+      - identité : nom, port, socket UDP (propre, ou socket mono-port partagé + gid)
+      - membres + bans (tableaux denses, tailles fixées à l'ouverture) et leurs index
+      - mtx : protège members[], bans[], last_activity, bannières, token, etc.
+        Règle : aucun appel système d'envoi n'est fait en le tenant (voir DestSnap).
+      - stop_at / dead : arrêt différé (REDIRECT) ou arrêt demandé (inactivité)
+*/
+typedef struct {
+    char     name[GNAME_LEN];
+    uint16_t port;
+    int      sock;
+    int      shared_sock;   // 1 => sock est le socket mono-port du worker (ne pas le fermer)
+    int      gid;           // identifiant mono-port, -1 si le groupe a son propre port
+
+    // Préfixes précalculés des diffusions (relais sans recopie du texte reçu) :
+    //   pfx[0..pfx_line)   = "GROUPE[<nom>]: "
+    //   pfx[0..pfx_chat)   = "GROUPE[<nom>]: Message de "
+    //   gfield             = champ binaire <nom> (longueur u16 + octets)
+    char     pfx[GNAME_LEN + 32];
+    size_t   pfx_line;
+    size_t   pfx_chat;
+    uint8_t  gfield[2 + GNAME_LEN];
+    size_t   gfield_len;
+
+    Member  *members;
+    unsigned nmembers;
+    unsigned max_members;
+
+    BanRec  *bans;
+    unsigned nbans;
+    unsigned max_bans;
+
+    // Index : pseudo -> membre, adresse source -> membre, pseudo -> ban
+    HIndex idx_mname;
+    HIndex idx_maddr;
+    HIndex idx_ban;
+
+    pthread_mutex_t mtx;
+    struct timespec mtx_t0;   // instant d'acquisition (pour la mesure de détention)
+
+    // Bannière "admin" (fixée par le serveur / commandes CTRL)
+    int  admin_banner_active;
+    char admin_banner[TXT_LEN];
+
+    // Bannière "inactivité" (gérée par le timer)
+    int  idle_banner_active;
+    char idle_banner[TXT_LEN];
+
+    // Token admin local du groupe (contrôle de modération)
+    char admin_token[ADMIN_TOKEN_LEN];
+
+    // Gestion de l’inactivité
+    unsigned idle_timeout_sec;  // 0 = désactivé
+    time_t   last_activity;     // dernière activité (MSG ou CMD reçu)
+
+    time_t       stop_at;       // arrêt différé (REDIRECT), 0 = aucun
+    volatile int dead;          // 1 => le groupe doit s'arrêter
+
+    // Nombre de membres annoncé au serveur (GSTAT) ; stat_fd < 0 = pas d'annonce
+    int                stat_fd;
+    struct sockaddr_in stat_to;
+    unsigned           stat_sent;
+
+    // Diffusions binaires numérotées (sous mtx)
+    RtxRing rtx;
+
+    /*
+        Historique rejoué au join : disposition ISYMsg / ISYRing de Commun.h
+        (Ordre "MES" = chat, Emetteur = pseudo ; "LINE" = ligne [Action]),
+        hist_widx = index d'écriture monotone comme ISYRing.widx.
+        Tableaux (entrées + vecteur de rejeu) alloués à l'ouverture : l'ajout d'un
+        message n'est qu'une recopie. Lu et écrit par le seul thread de réception.
+    */
+    ISYMsg         *hist;
+    unsigned        hist_cap;
+    uint32_t        hist_widx;
+    struct mmsghdr *hist_vec;   // hist_cap datagrammes
+    struct iovec   *hist_iov;   // HIST_IOV segments par datagramme
+    uint8_t        *hist_hdr;   // HIST_HDR octets par datagramme (en-tête + longueurs)
+
+    GroupLog *log;              // journal append-only, NULL si désactivé
+
+    BcastStats stats;
+} Group;
+
+/* Flag global d’exécution : modifié par SIGINT/SIGTERM */
 static volatile sig_atomic_t running = 1;
 
+/* Tailles de tables des groupes ouverts par ce processus (argv) */
+static unsigned max_members = MAX_MEMBERS_DEFAULT;
+static unsigned max_bans    = MAX_BANS_DEFAULT;
+static unsigned history_len = HISTORY_LEN_DEFAULT;
+
+/* Journal append-only (argv) : répertoire ("" = désactivé) et taille des segments */
+static char     glog_dir[256] = "";
+static uint32_t glog_seg_size = 0;
+
+#if !defined(__linux__)
 /* Handler de signal : stoppe la boucle principale */
 static void on_sigint(int signo){
     (void)signo;
     running = 0;
 }
+#endif
 
 /*
     Envoi UDP utilitaire :
@@ -80,6 +395,18 @@ static inline void send_txt(int s, const char *txt, const struct sockaddr_in *to
     (void)sendto(s, txt, strlen(txt), 0, (const struct sockaddr*)to, sizeof *to);
 }
 
+/* Réponse à un client dans son format : ligne texte, ou trame TEXT qui l'encapsule */
+static void send_reply(int s, int bin, const char *txt, const struct sockaddr_in *to){
+    if(!bin){
+        send_txt(s, txt, to);
+        return;
+    }
+    uint8_t fr[ISY_BIN_MAX];
+    size_t n = isy_bin_text(fr, sizeof fr, ISY_BIN_NOGID, txt);
+    if(n) (void)sendto(s, fr, n, 0, (const struct sockaddr*)to, sizeof *to);
+}
+
+#if !defined(__linux__)
 /*
     Définit un timeout de réception (SO_RCVTIMEO).
     But :
@@ -92,83 +419,202 @@ static void set_rcv_timeout(int sock, int ms){
     tv.tv_usec = (ms % 1000) * 1000;
     setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
 }
+#endif
+
+/* ───────────────────────── Verrou instrumenté ───────────────────────── */
+/*
+    grp_lock()/grp_unlock() : équivalents de pthread_mutex_lock/unlock sur g->mtx,
+    qui mesurent en plus la durée de détention (max conservé dans g->stats).
+    Sans GROUP_LOCKING (boucle mono-thread), ce sont des no-op.
+*/
+static void grp_lock(Group *g){
+#if GROUP_LOCKING
+    pthread_mutex_lock(&g->mtx);
+    clock_gettime(CLOCK_MONOTONIC, &g->mtx_t0);
+#else
+    (void)g;
+#endif
+}
 
-/* ───────────────────────── Etat du groupe ───────────────────────── */
+static void grp_unlock(Group *g){
+#if GROUP_LOCKING
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    long ns = (t1.tv_sec - g->mtx_t0.tv_sec) * 1000000000L + (t1.tv_nsec - g->mtx_t0.tv_nsec);
+    if(ns > 0 && (unsigned long)ns > g->stats.lock_max_ns) g->stats.lock_max_ns = (unsigned long)ns;
+
+    pthread_mutex_unlock(&g->mtx);
+#else
+    (void)g;
+#endif
+}
+
+/* ───────────────────────── Index de hachage ───────────────────────── */
+
+/* FNV-1a sur un pseudo */
+static uint32_t hash_name(const char *s){
+    uint32_t h = 2166136261u;
+    for(; *s; s++){
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Mélange IP + port (constante de Knuth, puis repli des bits hauts) */
+static uint32_t hash_addr(const struct sockaddr_in *a){
+    uint32_t h = (uint32_t)a->sin_addr.s_addr * 2654435761u;
+    h ^= (uint32_t)a->sin_port * 40503u;
+    return h ^ (h >> 16);
+}
+
+static int same_addr(const struct sockaddr_in *a, const struct sockaddr_in *b){
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+/* Alloue un index pour cap entrées. Retourne 0 si OK, -1 si mémoire insuffisante. */
+static int hidx_init(HIndex *t, unsigned cap){
+    uint32_t sz = 16;
+    while(sz < 2u * cap) sz <<= 1;
+
+    t->cells = (HCell*)malloc(sz * sizeof *t->cells);
+    if(!t->cells) return -1;
+    t->mask = sz - 1;
+
+    for(uint32_t i=0;i<sz;i++) t->cells[i].idx = -1;
+    return 0;
+}
 
-// Membres connectés + liste des bannis
-static Member members[MAX_MEMBERS];
-static BanRec bans[MAX_BANS];
+/* Retourne la position de la cellule correspondant à key, ou -1 */
+static int hidx_find(const HIndex *t, uint32_t h, const void *ctx, const void *key, hidx_eq_fn eq){
+    for(uint32_t i = h & t->mask; ; i = (i + 1) & t->mask){
+        const HCell *c = &t->cells[i];
+        if(c->idx < 0) return -1;
+        if(c->h == h && eq(ctx, c->idx, key)) return (int)i;
+    }
+}
 
-// Mutex global : protège members[], bans[], last_activity, bannières, token, etc.
-static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+/* Insère (h, idx) : l'appelant garantit que la clé est absente */
+static void hidx_insert(HIndex *t, uint32_t h, int idx){
+    uint32_t i = h & t->mask;
+    while(t->cells[i].idx >= 0) i = (i + 1) & t->mask;
+    t->cells[i].h = h;
+    t->cells[i].idx = idx;
+}
 
-// Bannière "admin" (fixée par le serveur / commandes CTRL)
-static int  admin_banner_active = 0;
-static char admin_banner[TXT_LEN];
+/* Supprime la cellule pos, en recompactant la chaîne de sondage qui suit */
+static void hidx_erase_at(HIndex *t, uint32_t pos){
+    uint32_t i = pos, j = pos;
 
-// Bannière "inactivité" (gérée par le timer)
-static int  idle_banner_active = 0;
-static char idle_banner[TXT_LEN];
+    for(;;){
+        j = (j + 1) & t->mask;
+        if(t->cells[j].idx < 0) break;
 
-// Token admin local du groupe (contrôle de modération)
-static char g_admin_token[ADMIN_TOKEN_LEN] = {0};
+        uint32_t k = t->cells[j].h & t->mask;   // position idéale de l'entrée j
+        int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if(stays) continue;
 
-// Gestion de l’inactivité
-static unsigned idle_timeout_sec = 1800; // configuré par argv[3], sinon défaut
-static time_t   last_activity = 0;       // dernière activité (MSG ou CMD reçu)
+        t->cells[i] = t->cells[j];
+        i = j;
+    }
+    t->cells[i].idx = -1;
+}
 
-// Pour afficher le nom du groupe dans les broadcasts
-static char     gname_local[32] = {0};
-static uint16_t gport_local = 0;
+static int member_name_eq(const void *ctx, int idx, const void *key){
+    return !strcmp(((const Group*)ctx)->members[idx].user, (const char*)key);
+}
+static int member_addr_eq(const void *ctx, int idx, const void *key){
+    return same_addr(&((const Group*)ctx)->members[idx].addr, (const struct sockaddr_in*)key);
+}
+static int ban_name_eq(const void *ctx, int idx, const void *key){
+    return !strcmp(((const Group*)ctx)->bans[idx].user, (const char*)key);
+}
 
 /* ───────────────────────── Ban helpers ───────────────────────── */
 /*
-    Les fonctions suffixées _nolock supposent que mtx est déjà acquis.
+    Les fonctions suffixées _nolock supposent que g->mtx est déjà acquis.
     Cela évite de verrouiller/déverrouiller plusieurs fois pour une même action.
 */
 
 /* Retourne 1 si user est banni, 0 sinon */
-static int ban_is_banned_nolock(const char *user){
-    for(int i=0;i<MAX_BANS;i++){
-        if(bans[i].inuse && !strcmp(bans[i].user, user)) return 1;
-    }
-    return 0;
+static int ban_is_banned_nolock(Group *g, const char *user){
+    return hidx_find(&g->idx_ban, hash_name(user), g, user, ban_name_eq) >= 0;
 }
 
 /* Ajoute un pseudo à la liste des bannis. Retourne 1 si OK, 0 si liste pleine. */
-static int ban_add_nolock(const char *user){
-    if(ban_is_banned_nolock(user)) return 1;
-
-    for(int i=0;i<MAX_BANS;i++){
-        if(!bans[i].inuse){
-            bans[i].inuse = 1;
-            isy_strcpy(bans[i].user, sizeof bans[i].user, user);
-            return 1;
-        }
-    }
-    return 0;
+static int ban_add_nolock(Group *g, const char *user){
+    if(ban_is_banned_nolock(g, user)) return 1;
+    if(g->nbans >= g->max_bans) return 0;
+
+    BanRec *b = &g->bans[g->nbans];
+    isy_strcpy(b->user, sizeof b->user, user);
+    hidx_insert(&g->idx_ban, hash_name(b->user), (int)g->nbans);
+    g->nbans++;
+    return 1;
 }
 
 /* Retire un pseudo de la liste des bannis. Retourne 1 si supprimé, 0 sinon. */
-static int ban_remove_nolock(const char *user){
-    for(int i=0;i<MAX_BANS;i++){
-        if(bans[i].inuse && !strcmp(bans[i].user, user)){
-            bans[i].inuse = 0;
-            bans[i].user[0] = '\0';
-            return 1;
-        }
+static int ban_remove_nolock(Group *g, const char *user){
+    int pos = hidx_find(&g->idx_ban, hash_name(user), g, user, ban_name_eq);
+    if(pos < 0) return 0;
+
+    int idx = g->idx_ban.cells[pos].idx;
+    hidx_erase_at(&g->idx_ban, (uint32_t)pos);
+
+    // Bouche le trou avec la dernière entrée (tableau dense)
+    int last = (int)g->nbans - 1;
+    if(idx != last){
+        const char *lu = g->bans[last].user;
+        int lp = hidx_find(&g->idx_ban, hash_name(lu), g, lu, ban_name_eq);
+        g->idx_ban.cells[lp].idx = idx;
+        g->bans[idx] = g->bans[last];
     }
-    return 0;
+    g->bans[last].user[0] = '\0';
+    g->nbans--;
+    return 1;
 }
 
 /* ───────────────────────── Member helpers ───────────────────────── */
 
-/* Recherche un membre dans members[]. Retourne index ou -1 si absent. */
-static int member_find_nolock(const char *user){
-    for(int i=0;i<MAX_MEMBERS;i++){
-        if(members[i].inuse && !strcmp(members[i].user, user)) return i;
-    }
-    return -1;
+/* Recherche un membre par pseudo. Retourne index ou -1 si absent. */
+static int member_find_nolock(Group *g, const char *user){
+    int pos = hidx_find(&g->idx_mname, hash_name(user), g, user, member_name_eq);
+    return pos < 0 ? -1 : g->idx_mname.cells[pos].idx;
+}
+
+/*
+    Table de sessions = index d'adresses (idx_maddr) :
+      - une adresse source (IP:port) est associée à un membre lors de son premier
+        MSG, normalement le handshake "(joined)" ;
+      - ensuite chaque MSG venant de cette adresse est attribué directement au membre ;
+      - ré-association : si un pseudo connu arrive depuis une autre adresse (le client
+        a changé de port), l'ancienne session est retirée et la nouvelle la remplace.
+*/
+
+/* Recherche un membre par adresse source. Retourne index ou -1 si absent. */
+static int member_find_addr_nolock(Group *g, const struct sockaddr_in *addr){
+    int pos = hidx_find(&g->idx_maddr, hash_addr(addr), g, addr, member_addr_eq);
+    return pos < 0 ? -1 : g->idx_maddr.cells[pos].idx;
+}
+
+/*
+    Associe members[idx].addr -> idx dans l'index d'adresses.
+    Si l'adresse était déjà associée à un autre membre, la plus récente l'emporte.
+*/
+static void member_addr_bind_nolock(Group *g, int idx){
+    const struct sockaddr_in *a = &g->members[idx].addr;
+    uint32_t h = hash_addr(a);
+    int pos = hidx_find(&g->idx_maddr, h, g, a, member_addr_eq);
+    if(pos >= 0) g->idx_maddr.cells[pos].idx = idx;
+    else hidx_insert(&g->idx_maddr, h, idx);
+}
+
+/* Retire l'association members[idx].addr -> idx (si c'est bien la sienne) */
+static void member_addr_unbind_nolock(Group *g, int idx){
+    const struct sockaddr_in *a = &g->members[idx].addr;
+    int pos = hidx_find(&g->idx_maddr, hash_addr(a), g, a, member_addr_eq);
+    if(pos >= 0 && g->idx_maddr.cells[pos].idx == idx) hidx_erase_at(&g->idx_maddr, (uint32_t)pos);
 }
 
 /*
@@ -177,619 +623,2555 @@ static int member_find_nolock(const char *user){
       - index du membre si OK
       - -1 si le groupe est plein
 */
-static int member_add_or_update_nolock(const char *user, const struct sockaddr_in *addr){
-    int idx = member_find_nolock(user);
+static int member_add_or_update_nolock(Group *g, const char *user, const struct sockaddr_in *addr){
+    int idx = member_find_nolock(g, user);
     if(idx < 0){
-        for(int i=0;i<MAX_MEMBERS;i++){
-            if(!members[i].inuse){
-                members[i].inuse = 1;
-                isy_strcpy(members[i].user, sizeof members[i].user, user);
-                members[i].addr = *addr;
-                return i;
-            }
-        }
-        return -1;
+        if(g->nmembers >= g->max_members) return -1;
+
+        idx = (int)g->nmembers++;
+        Member *m = &g->members[idx];
+        isy_strcpy(m->user, sizeof m->user, user);
+        m->addr = *addr;
+        hidx_insert(&g->idx_mname, hash_name(m->user), idx);
+        member_addr_bind_nolock(g, idx);
+        return idx;
     }
 
     // Membre déjà présent : on met à jour l’adresse (utile si le client change de port)
-    members[idx].addr = *addr;
+    if(!same_addr(&g->members[idx].addr, addr)){
+        g->stats.rebinds++;
+        member_addr_unbind_nolock(g, idx);
+        g->members[idx].addr = *addr;
+        member_addr_bind_nolock(g, idx);
+    }
     return idx;
 }
 
 /* Supprime un membre (ex: (left) ou ban) */
-static void member_remove_nolock(const char *user){
-    int idx = member_find_nolock(user);
-    if(idx >= 0){
-        members[idx].inuse = 0;
-        members[idx].user[0] = '\0';
-        memset(&members[idx].addr, 0, sizeof members[idx].addr);
+static void member_remove_nolock(Group *g, const char *user){
+    int pos = hidx_find(&g->idx_mname, hash_name(user), g, user, member_name_eq);
+    if(pos < 0) return;
+
+    int idx = g->idx_mname.cells[pos].idx;
+    member_addr_unbind_nolock(g, idx);
+    hidx_erase_at(&g->idx_mname, (uint32_t)pos);
+
+    // Bouche le trou avec le dernier membre : on repointe ses deux entrées d'index
+    int last = (int)g->nmembers - 1;
+    if(idx != last){
+        Member *lm = &g->members[last];
+
+        int lp = hidx_find(&g->idx_mname, hash_name(lm->user), g, lm->user, member_name_eq);
+        g->idx_mname.cells[lp].idx = idx;
+
+        int ap = hidx_find(&g->idx_maddr, hash_addr(&lm->addr), g, &lm->addr, member_addr_eq);
+        if(ap >= 0 && g->idx_maddr.cells[ap].idx == last) g->idx_maddr.cells[ap].idx = idx;
+
+        g->members[idx] = *lm;
     }
+    memset(&g->members[last], 0, sizeof g->members[last]);
+    g->nmembers--;
 }
 
 /* ───────────────────────── Broadcast helpers ───────────────────────── */
 
-/* Diffuse un payload brut à tous les membres */
-static void broadcast_to_all_nolock(int s, const char *payload){
-    for(int i=0;i<MAX_MEMBERS;i++){
-        if(members[i].inuse){
-            send_txt(s, payload, &members[i].addr);
+/*
+    Envoie un vecteur de datagrammes préparé (1 entrée par destination).
+    - Un seul sendmmsg() dans le cas nominal.
+    - Envoi partiel : on relance sur le reste du vecteur.
+    - Erreur : le noyau s'arrête sur la 1ère destination fautive (vec[off]) ;
+      on la signale, on la saute et on continue avec les suivantes.
+    Appelée sans mtx.
+*/
+static void send_vec(Group *g, struct mmsghdr *vec, unsigned n){
+    unsigned off = 0;
+    int first = 1;
+
+    STAT_ADD(g, broadcasts, 1);
+
+    while(off < n){
+        unsigned chunk = n - off;
+        if(chunk > MMSG_BATCH) chunk = MMSG_BATCH;
+
+        int r = sendmmsg(g->sock, vec + off, chunk, 0);
+        STAT_ADD(g, syscalls, 1);
+
+        if(r < 0){
+            if(errno == EINTR) continue;
+
+            const struct sockaddr_in *to = (const struct sockaddr_in*)vec[off].msg_hdr.msg_name;
+            char ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &to->sin_addr, ip, sizeof ip);
+            fprintf(stderr, "[GroupeISY] '%s' envoi vers %s:%u : %s\n",
+                    g->name, ip, (unsigned)ntohs(to->sin_port), strerror(errno));
+
+            STAT_ADD(g, errors, 1);
+            off++;
+            first = 0;
+            continue;
         }
+
+        if(first && (unsigned)r < chunk) STAT_ADD(g, partial, 1);
+        first = 0;
+
+        STAT_ADD(g, sent, r);
+        off += (unsigned)r;
+    }
+}
+
+/* Alloue les tampons d'un snapshot (capacité cap destinations) */
+static void snap_init(DestSnap *d, unsigned cap){
+    d->addr = (struct sockaddr_in*)calloc(cap, sizeof *d->addr);
+    d->bin  = (uint8_t*)calloc(cap, sizeof *d->bin);
+    d->vec  = (struct mmsghdr*)calloc(cap, sizeof *d->vec);
+    d->n = 0;
+    d->nbin = 0;
+    if(!d->addr || !d->bin || !d->vec) die_perror("calloc snapshot");
+}
+
+static void snap_free(DestSnap *d){
+    free(d->addr);
+    free(d->bin);
+    free(d->vec);
+    d->addr = NULL;
+    d->bin = NULL;
+    d->vec = NULL;
+}
+
+/* Copie les adresses (et formats) des membres actifs dans d (g->mtx doit être acquis). */
+static void snap_members_nolock(Group *g, DestSnap *d){
+    unsigned nbin = 0;
+    for(unsigned i=0;i<g->nmembers;i++){
+        d->addr[i] = g->members[i].addr;
+        d->bin[i]  = g->members[i].bin;
+        nbin += g->members[i].bin;
     }
+    d->n = g->nmembers;
+    d->nbin = nbin;
 }
 
 /*
-    Diffuse une "ligne de chat" normalisée.
-    On préfixe par GROUPE[<nom>] pour que le client sache clairement de quel groupe vient le message.
+    gid d'en-tête des trames du groupe : en mono-port, tous les groupes du worker
+    partagent le port source et numérotent à partir de 1 ; le gid dit au client
+    de quel flux vient une trame (diffusions, GAP). ISY_BIN_NOGID sinon.
 */
-static void broadcast_group_line_nolock(int s, const char *line){
-    char out[TXT_LEN + 128];
-    snprintf(out, sizeof out, "GROUPE[%s]: %s", gname_local, line);
-    broadcast_to_all_nolock(s, out);
+static uint32_t bin_gid(const Group *g){
+    return g->gid >= 0 ? (uint32_t)g->gid : ISY_BIN_NOGID;
 }
 
-/* ───────────────────────── Admin token logic ───────────────────────── */
 /*
-    Vérifie / initialise le token admin.
-    - Si g_admin_token est vide, la première commande admin reçue peut l'initialiser (fallback).
-    - Sinon, on exige l’égalité exacte.
-
-    But :
-      - Permet d'utiliser le token fourni par ServeurISY
-      - Mais reste robuste même si le token n’a pas été "SETTOKEN" au démarrage.
+    Numérote une trame binaire (segments biov[0..bn), biov[0] = en-tête seul,
+    modifiable) et la recopie dans l'anneau de retransmission (g->mtx acquis).
+    Renvoie la seq attribuée, 0 si l'anneau n'a pas pu être alloué.
 */
-static int ensure_or_check_admin_token_locked(const char *tok){
-    if(!tok || !*tok) return 0;
+static uint32_t rtx_put_nolock(Group *g, const struct iovec *biov, size_t bn){
+    RtxRing *x = &g->rtx;
+    uint32_t len = 0;
+
+    for(size_t i=0;i<bn;i++) len += (uint32_t)biov[i].iov_len;
+    if(len > ISY_BIN_MAX) return 0;
+
+    if(!x->arena){
+        x->arena = (uint8_t*)malloc(RTX_ARENA);
+        x->ent   = (RtxEnt*)calloc(RTX_SLOTS, sizeof *x->ent);
+        if(!x->arena || !x->ent){
+            free(x->arena);
+            free(x->ent);
+            x->arena = NULL;
+            x->ent = NULL;
+            return 0;
+        }
+    }
 
-    // Fallback : 1ère commande admin configure le token si inconnu
-    if(g_admin_token[0] == '\0'){
-        isy_strcpy(g_admin_token, sizeof g_admin_token, tok);
-        return 1;
+    // Place : à la suite, ou au début de l'arène si la fin est trop courte
+    uint32_t at = x->head, span = len;
+    if(at + len > RTX_ARENA){
+        span += RTX_ARENA - at;
+        at = 0;
+    }
+
+    /*
+        Eviction des plus anciennes : les trames présentes suivent head dans
+        l'arène (ordre circulaire), on retire celles que [head, at + len) recouvre
+        ainsi que celle dont le descripteur va être réutilisé.
+    */
+    uint32_t seq = x->next++;
+    while(x->lo != seq){
+        const RtxEnt *e = &x->ent[x->lo % RTX_SLOTS];
+        uint32_t dist = (e->off + RTX_ARENA - x->head) % RTX_ARENA;
+        if(seq - x->lo < RTX_SLOTS && dist >= span) break;
+        x->lo++;
+    }
+
+    isy_put32((uint8_t*)biov[0].iov_base + 8, seq);
+
+    uint32_t off = at;
+    for(size_t i=0;i<bn;i++){
+        memcpy(x->arena + off, biov[i].iov_base, biov[i].iov_len);
+        off += (uint32_t)biov[i].iov_len;
     }
+    x->head = off;
 
-    return (strcmp(g_admin_token, tok) == 0);
+    RtxEnt *e = &x->ent[seq % RTX_SLOTS];
+    e->seq = seq;
+    e->off = at;
+    e->len = len;
+
+    STAT_ADD(g, copied, len);
+    return seq;
 }
 
-/* ───────────────────────── Timer Inactivité ───────────────────────── */
 /*
-    Thread dédié :
-      - surveille last_activity
-      - si le groupe devient inactif :
-          * affiche une bannière "inactivité"
-      - si aucune activité jusqu’au timeout complet :
-          * envoie un message SYS
-          * stoppe le groupe (running=0)
+    Diffuse un même événement à toutes les destinations du snapshot (sans mtx),
+    chacune dans son format : segments tiov[0..tn) (ligne texte) ou biov[0..bn)
+    (trame binaire). Le noyau assemble les segments (sendmmsg scatter/gather) :
+    ni le vecteur mmsghdr ni les datagrammes ne recopient le contenu.
+    S'il y a des membres binaires, la trame est numérotée et gardée dans
+    l'anneau de retransmission (seule recopie, une fois par diffusion).
 */
-typedef struct {
-    int sock;
-} TimerCtx;
+static void broadcast_iov(Group *g, const DestSnap *d, const struct iovec *tiov, size_t tn,
+                          const struct iovec *biov, size_t bn){
+    struct mmsghdr *vec = d->vec;
+    struct iovec sv[8];
+    uint8_t head[ISY_BIN_HDR];
+
+    if(d->n == 0) return;
+
+    // En-tête recopié à part (seq), le reste des segments est repris tel quel
+    if(d->nbin && bn > 0 && bn < 8 && biov[0].iov_len >= ISY_BIN_HDR){
+        memcpy(head, biov[0].iov_base, ISY_BIN_HDR);
+        sv[0].iov_base = head;
+        sv[0].iov_len  = ISY_BIN_HDR;
+        sv[1].iov_base = (uint8_t*)biov[0].iov_base + ISY_BIN_HDR;
+        sv[1].iov_len  = biov[0].iov_len - ISY_BIN_HDR;
+        memcpy(&sv[2], &biov[1], (bn - 1) * sizeof *biov);
+
+        grp_lock(g);
+        (void)rtx_put_nolock(g, sv, bn + 1);
+        grp_unlock(g);
+
+        biov = sv;
+        bn++;
+    }
 
-/* Formate une heure locale HH:MM:SS */
-static void fmt_hhmmss(time_t t, char *out, size_t n){
-    struct tm tmv;
-    localtime_r(&t, &tmv);
-    strftime(out, n, "%H:%M:%S", &tmv);
+    for(unsigned i=0;i<d->n;i++){
+        memset(&vec[i], 0, sizeof vec[i]);
+        vec[i].msg_hdr.msg_name    = (void*)&d->addr[i];
+        vec[i].msg_hdr.msg_namelen = sizeof d->addr[i];
+        vec[i].msg_hdr.msg_iov     = (struct iovec*)(d->bin[i] ? biov : tiov);
+        vec[i].msg_hdr.msg_iovlen  = d->bin[i] ? bn : tn;
+    }
+
+    send_vec(g, vec, d->n);
 }
 
 /*
-    Thread timer :
-      - Warn threshold : idle_timeout/2 (ou idle_timeout si trop petit)
-      - Bannière envoyée 1 seule fois (idle_banner_active sert de garde-fou)
+    Variante à un segment par format : txt (ligne texte) ou bin (trame binaire).
+    bin == NULL : les membres binaires reçoivent txt encapsulé dans une trame TEXT.
 */
-static void *idle_timer_thread(void *arg){
-    TimerCtx *ctx = (TimerCtx*)arg;
+static void broadcast_frames(Group *g, const DestSnap *d, const char *txt, size_t tlen,
+                             const void *bin, size_t blen){
+    struct iovec iov[2];
+    uint8_t fr[ISY_BIN_MAX];
 
-    for(;;){
-        if(!running) break;
-        sleep(1);
+    if(d->n == 0) return;
 
-        // Désactive le mécanisme si timeout = 0
-        if(idle_timeout_sec == 0) continue;
+    if(d->nbin && !bin){
+        blen = isy_bin_text(fr, sizeof fr, bin_gid(g), txt);
+        bin = fr;
+        STAT_ADD(g, copied, blen);
+    }
+
+    iov[0].iov_base = (void*)txt;
+    iov[0].iov_len  = tlen;
+    iov[1].iov_base = (void*)bin;
+    iov[1].iov_len  = blen;
 
-        time_t now = time(NULL);
-        time_t since;
+    broadcast_iov(g, d, &iov[0], 1, &iov[1], 1);
+}
 
-        int need_warn = 0;
-        int need_clear = 0;
-        int do_exit = 0;
+/* Diffuse une ligne texte brute (encapsulée TEXT pour les membres binaires) */
+static void broadcast_to_snap(Group *g, const DestSnap *d, const char *payload){
+    broadcast_frames(g, d, payload, strlen(payload), NULL, 0);
+}
 
-        char warn_payload[TXT_LEN + 32];
+/* Raccourci : snapshot (dans d) sous mtx puis diffusion hors lock. */
+static void broadcast_to_all(Group *g, DestSnap *d, const char *payload){
+    grp_lock(g);
+    snap_members_nolock(g, d);
+    grp_unlock(g);
+    broadcast_to_snap(g, d, payload);
+}
 
-        pthread_mutex_lock(&mtx);
+/* En-tête d'une trame groupe -> client dont les champs sont fournis en segments */
+static void bin_head(const Group *g, uint8_t head[ISY_BIN_HDR], uint8_t op, size_t len){
+    ISYWr w;
+    isy_bin_begin(&w, head, ISY_BIN_HDR, op, 0, bin_gid(g), 0);
+    isy_put16(head + 12, (uint16_t)len);
+}
 
-        since = now - last_activity;
+/*
+    Diffuse une "ligne de chat" normalisée.
+    On préfixe par GROUPE[<nom>] pour que le client sache clairement de quel groupe vient le message.
+    Segments : préfixe précalculé + ligne (texte) ; en-tête + champ nom + ligne (trame LINE).
+*/
+static void broadcast_group_line(Group *g, const DestSnap *d, const char *line){
+    size_t llen = strlen(line);
+    uint8_t head[ISY_BIN_HDR], l16[2];
+
+    struct iovec tiov[2] = {
+        { g->pfx, g->pfx_line },
+        { (void*)line, llen },
+    };
+    struct iovec biov[4] = {
+        { head, sizeof head },
+        { g->gfield, g->gfield_len },
+        { l16, sizeof l16 },
+        { (void*)line, llen },
+    };
+
+    if(d->nbin){
+        bin_head(g, head, ISY_OP_LINE, g->gfield_len + 2 + llen);
+        isy_put16(l16, (uint16_t)llen);
+        STAT_ADD(g, copied, sizeof head + sizeof l16);
+    }
+    broadcast_iov(g, d, tiov, 2, biov, 4);
+}
 
-        // On avertit à mi-parcours (ou au max si idle_timeout est très petit)
-        unsigned warn_threshold = (idle_timeout_sec >= 2 ? idle_timeout_sec / 2 : idle_timeout_sec);
+/*
+    Relais d'un message de chat : "GROUPE[<nom>]: Message de <user> : <texte>".
+    Aucune recopie du texte : les datagrammes sont assemblés par le noyau à partir
+    du préfixe précalculé du groupe, du pseudo et des octets reçus (text, non
+    terminé, longueur tlen, pointe dans le tampon de réception).
+      - texte  : pfx_chat | user | " : " | text
+      - binaire (trame CHAT) : en-tête | champ nom | len user | user | len text | text
+    Seuls l'en-tête et les deux longueurs binaires sont écrits (si membre binaire).
+*/
+static void broadcast_chat(Group *g, const DestSnap *d, const char *user, size_t ulen,
+                           const char *text, size_t tlen){
+    uint8_t head[ISY_BIN_HDR], u16[2], t16[2];
+
+    struct iovec tiov[4] = {
+        { g->pfx, g->pfx_chat },
+        { (void*)user, ulen },
+        { (void*)" : ", 3 },
+        { (void*)text, tlen },
+    };
+    struct iovec biov[6] = {
+        { head, sizeof head },
+        { g->gfield, g->gfield_len },
+        { u16, sizeof u16 },
+        { (void*)user, ulen },
+        { t16, sizeof t16 },
+        { (void*)text, tlen },
+    };
+
+    if(d->nbin){
+        bin_head(g, head, ISY_OP_CHAT, g->gfield_len + 2 + ulen + 2 + tlen);
+        isy_put16(u16, (uint16_t)ulen);
+        isy_put16(t16, (uint16_t)tlen);
+        STAT_ADD(g, copied, sizeof head + sizeof u16 + sizeof t16);
+    }
+    broadcast_iov(g, d, tiov, 4, biov, 6);
+}
 
-        if(since >= (time_t)idle_timeout_sec){
-            // Timeout atteint -> suppression du groupe
-            if(idle_banner_active) need_clear = 1;
-            do_exit = 1;
+/*
+    Construit l'ordre de bannière pour un client (text == NULL => effacement) :
+      - idle : bannière inactivité (IBANNER) ou admin (BANNER)
+      - txt  : "CTRL [I]BANNER_SET <text>" / "CTRL [I]BANNER_CLR"
+      - fr   : trame BANNER équivalente ; renvoie sa taille
+*/
+static size_t fmt_banner(int idle, const char *text, char *txt, size_t tsz, uint8_t *fr, size_t fsz){
+    if(text) snprintf(txt, tsz, "CTRL %sBANNER_SET %s", idle ? "I" : "", text);
+    else     snprintf(txt, tsz, "CTRL %sBANNER_CLR", idle ? "I" : "");
+
+    ISYWr w;
+    isy_bin_begin(&w, fr, fsz, ISY_OP_BANNER,
+                  (uint8_t)((idle ? ISY_BF_IDLE : 0) | (text ? ISY_BF_SET : 0)), ISY_BIN_NOGID, 0);
+    isy_bin_cstr(&w, text ? text : "");
+    return isy_bin_end(&w);
+}
 
-        } else if(since >= (time_t)warn_threshold){
-            // On affiche une bannière d'avertissement (une seule fois)
-            if(!idle_banner_active){
-                time_t deletion_time = last_activity + (time_t)idle_timeout_sec;
+/* Diffuse un ordre de bannière (voir fmt_banner) */
+static void broadcast_banner(Group *g, const DestSnap *d, int idle, const char *text){
+    char txt[TXT_LEN + 32];
+    uint8_t fr[ISY_BIN_MAX];
+    size_t blen = fmt_banner(idle, text, txt, sizeof txt, fr, sizeof fr);
+    STAT_ADD(g, copied, strlen(txt) + blen);
+    broadcast_frames(g, d, txt, strlen(txt), blen ? fr : NULL, blen);
+}
 
-                char hhmmss[16];
-                fmt_hhmmss(deletion_time, hhmmss, sizeof hhmmss);
+/* Envoie un ordre de bannière à un seul client, dans son format */
+static void send_banner(Group *g, int bin, int idle, const char *text, const struct sockaddr_in *to){
+    char txt[TXT_LEN + 32];
+    uint8_t fr[ISY_BIN_MAX];
+    size_t blen = fmt_banner(idle, text, txt, sizeof txt, fr, sizeof fr);
 
-                snprintf(idle_banner, sizeof idle_banner,
-                         "Inactivite detectee: le groupe '%s' sera supprime a %s sans activite.",
-                         gname_local, hhmmss);
+    if(bin && blen) (void)sendto(g->sock, fr, blen, 0, (const struct sockaddr*)to, sizeof *to);
+    else            send_txt(g->sock, txt, to);
+}
 
-                idle_banner_active = 1;
-                snprintf(warn_payload, sizeof warn_payload, "CTRL IBANNER_SET %s", idle_banner);
-                need_warn = 1;
+/*
+    Diffuse "CTRL REDIRECT <groupe> <port> [@gid] <raison...>" tel quel aux membres
+    texte, et en trame REDIRECT (groupe, port, raison ; gid en en-tête) aux membres binaires.
+*/
+static void broadcast_redirect(Group *g, const DestSnap *d, const char *line){
+    uint8_t fr[ISY_BIN_MAX];
+    size_t blen = 0;
+
+    if(d->nbin){
+        char ng[GNAME_LEN] = {0};
+        unsigned port = 0;
+        int off = 0;
+        uint32_t gid = ISY_BIN_NOGID;
+
+        const char *rest = line + strlen(ISY_CTRL_REDIRECT " ");
+        if(sscanf(rest, "%31s %u %n", ng, &port, &off) >= 2 && off > 0){
+            rest += off;
+            if(*rest == ISY_MUX_TAG){
+                char *end;
+                gid = (uint32_t)strtoul(rest + 1, &end, 10);
+                rest = end;
+                while(*rest == ' ') rest++;
             }
+
+            ISYWr w;
+            isy_bin_begin(&w, fr, sizeof fr, ISY_OP_REDIRECT, 0, gid, 0);
+            isy_bin_cstr(&w, ng);
+            isy_bin_u16(&w, (uint16_t)port);
+            isy_bin_cstr(&w, rest);
+            blen = isy_bin_end(&w);
+            STAT_ADD(g, copied, blen);
         }
+    }
+    broadcast_frames(g, d, line, strlen(line), blen ? fr : NULL, blen);
+}
 
-        pthread_mutex_unlock(&mtx);
+/* ───────────────────────── Historique (rejeu au join) ───────────────────────── */
 
-        // Les sends se font hors lock si possible, mais ici on reprend le lock
-        // pour réutiliser broadcast_to_all_nolock() (qui suppose mtx acquis).
-        if(need_warn){
-            pthread_mutex_lock(&mtx);
-            broadcast_to_all_nolock(ctx->sock, warn_payload);
-            pthread_mutex_unlock(&mtx);
-        }
+#define HIST_CHAT "MES"                 // Ordre d'un message de chat
+#define HIST_LINE "LINE"                // Ordre d'une ligne de groupe ([Action] ...)
+#define HIST_IOV  6                     // segments d'un datagramme rejoué (trame CHAT)
+#define HIST_HDR  (ISY_BIN_HDR + 4)     // en-tête + deux longueurs u16
+
+/* Nombre de messages présents dans l'historique */
+static unsigned history_count(const Group *g){
+    return g->hist_widx < g->hist_cap ? g->hist_widx : g->hist_cap;
+}
 
-        if(need_clear){
-            pthread_mutex_lock(&mtx);
-            broadcast_to_all_nolock(ctx->sock, "CTRL IBANNER_CLR");
-            pthread_mutex_unlock(&mtx);
+/*
+    (Re)dimensionne l'historique à cap messages en gardant les plus récents
+    (0 = désactivé, tout est libéré). Hors chemin chaud : ouverture, CTRL HISTORY, fermeture.
+    Retour : 0 si OK, -1 si l'allocation échoue (historique précédent conservé).
+*/
+static int history_resize(Group *g, unsigned cap){
+    ISYMsg *h = NULL;
+    struct mmsghdr *vec = NULL;
+    struct iovec *iov = NULL;
+    uint8_t *hdr = NULL;
+
+    if(cap > HISTORY_LEN_MAX) cap = HISTORY_LEN_MAX;
+    if(cap){
+        h   = (ISYMsg*)calloc(cap, sizeof *h);
+        vec = (struct mmsghdr*)calloc(cap, sizeof *vec);
+        iov = (struct iovec*)calloc((size_t)cap * HIST_IOV, sizeof *iov);
+        hdr = (uint8_t*)malloc((size_t)cap * HIST_HDR);
+        if(!h || !vec || !iov || !hdr){
+            free(h);
+            free(vec);
+            free(iov);
+            free(hdr);
+            return -1;
         }
+    }
 
-        // Suppression du groupe : message + arrêt
-        if(do_exit){
-            pthread_mutex_lock(&mtx);
-            broadcast_to_all_nolock(ctx->sock,
-                "SYS Le groupe est supprime pour cause d'inactivite. Tappez \"quit\" pour quitter.");
-            pthread_mutex_unlock(&mtx);
+    unsigned n = history_count(g);
+    if(n > cap) n = cap;
+    for(unsigned k=0;k<n;k++)
+        h[k] = g->hist[(g->hist_widx - n + k) % g->hist_cap];
+
+    free(g->hist);
+    free(g->hist_vec);
+    free(g->hist_iov);
+    free(g->hist_hdr);
+    g->hist      = h;
+    g->hist_vec  = vec;
+    g->hist_iov  = iov;
+    g->hist_hdr  = hdr;
+    g->hist_cap  = cap;
+    g->hist_widx = n;
+    return 0;
+}
+
+/* Ajoute un message (champs non terminés) : recopie dans l'entrée suivante, pas d'allocation */
+static void history_push(Group *g, const char *ordre, const char *user, size_t ulen,
+                         const char *text, size_t tlen){
+    if(!g->hist_cap) return;
+
+    ISYMsg *m = &g->hist[g->hist_widx++ % g->hist_cap];
+    isy_strcpy(m->Ordre, sizeof m->Ordre, ordre);
+    if(ulen >= sizeof m->Emetteur) ulen = sizeof m->Emetteur - 1;
+    memcpy(m->Emetteur, user, ulen);
+    m->Emetteur[ulen] = '\0';
+    if(tlen >= sizeof m->Texte) tlen = sizeof m->Texte - 1;
+    memcpy(m->Texte, text, tlen);
+    m->Texte[tlen] = '\0';
+}
 
-            running = 0;
-            break;
+/*
+    Rejoue l'historique à un membre qui arrive, dans son format, du plus ancien au
+    plus récent : un datagramme par message, de même forme qu'une diffusion
+    (broadcast_chat / broadcast_group_line) mais non numéroté. Les segments pointent
+    dans les entrées : tout part en un seul sendmmsg, sans recopie.
+*/
+static void history_replay(Group *g, int bin, const struct sockaddr_in *to){
+    unsigned n = history_count(g);
+    if(n == 0) return;
+
+    for(unsigned k=0;k<n;k++){
+        ISYMsg *m = &g->hist[(g->hist_widx - n + k) % g->hist_cap];
+        struct iovec *io = &g->hist_iov[(size_t)k * HIST_IOV];
+        uint8_t *hd = &g->hist_hdr[(size_t)k * HIST_HDR];
+        int chat = !strcmp(m->Ordre, HIST_CHAT);
+        size_t ulen = strlen(m->Emetteur), tlen = strlen(m->Texte);
+        size_t ni = 0;
+
+        if(bin){
+            io[ni].iov_base = hd;
+            io[ni].iov_len  = ISY_BIN_HDR;
+            ni++;
+            io[ni].iov_base = g->gfield;
+            io[ni].iov_len  = g->gfield_len;
+            ni++;
+            if(chat){
+                bin_head(g, hd, ISY_OP_CHAT, g->gfield_len + 2 + ulen + 2 + tlen);
+                isy_put16(hd + ISY_BIN_HDR, (uint16_t)ulen);
+                io[ni].iov_base = hd + ISY_BIN_HDR;
+                io[ni].iov_len  = 2;
+                ni++;
+                io[ni].iov_base = m->Emetteur;
+                io[ni].iov_len  = ulen;
+                ni++;
+            } else {
+                bin_head(g, hd, ISY_OP_LINE, g->gfield_len + 2 + tlen);
+            }
+            isy_put16(hd + ISY_BIN_HDR + 2, (uint16_t)tlen);
+            io[ni].iov_base = hd + ISY_BIN_HDR + 2;
+            io[ni].iov_len  = 2;
+            ni++;
+        } else {
+            io[ni].iov_base = g->pfx;
+            io[ni].iov_len  = chat ? g->pfx_chat : g->pfx_line;
+            ni++;
+            if(chat){
+                io[ni].iov_base = m->Emetteur;
+                io[ni].iov_len  = ulen;
+                ni++;
+                io[ni].iov_base = (void*)" : ";
+                io[ni].iov_len  = 3;
+                ni++;
+            }
         }
+        io[ni].iov_base = m->Texte;
+        io[ni].iov_len  = tlen;
+        ni++;
+
+        struct mmsghdr *v = &g->hist_vec[k];
+        memset(v, 0, sizeof *v);
+        v->msg_hdr.msg_name    = (void*)to;
+        v->msg_hdr.msg_namelen = sizeof *to;
+        v->msg_hdr.msg_iov     = io;
+        v->msg_hdr.msg_iovlen  = ni;
     }
 
-    return NULL;
+    send_vec(g, g->hist_vec, n);
+    STAT_ADD(g, replayed, n);
 }
 
-/* ───────────────────────── Main ───────────────────────── */
-int main(int argc, char **argv){
-    if(argc < 3){
-        fprintf(stderr, "Usage: %s <groupName> <port> [IDLE_TIMEOUT_SEC]\n", argv[0]);
-        return 1;
-    }
+/* ───────────────────────── Journal append-only ───────────────────────── */
 
-    // Arguments : nom groupe, port UDP du groupe, timeout optionnel
-    const char *gname = argv[1];
-    uint16_t gport = (uint16_t)atoi(argv[2]);
-    if(argc >= 4){
-        idle_timeout_sec = (unsigned)atoi(argv[3]);
+/*
+    Format d'un segment (entiers en ordre réseau, comme le protocole binaire) :
+      en-tête  16 octets : "ISYLOG1\n", u32 numéro de segment, u32 création (epoch)
+      enregistrements, alignés sur 4 octets :
+        0  u32 len      longueur totale (en-tête compris, sans bourrage), 0 = fin
+        4  u32 ts       horodatage (epoch, secondes)
+        8  u8  type     GLOG_MSG / GLOG_JOIN / GLOG_LEFT / GLOG_BAN / GLOG_UNBAN / GLOG_ACTION
+        9  u8  ulen     longueur du pseudo (auteur ; admin pour BAN/UNBAN)
+        10 pseudo[ulen], texte[len - 10 - ulen] (victime pour BAN/UNBAN)
+    len est écrit en dernier (store release) : un enregistrement interrompu par
+    la mort du processus se lit comme la fin du segment. Le fichier est créé à
+    sa taille finale (zéros) puis ramené aux octets utiles quand on le quitte.
+*/
+#define GLOG_SEG_DEFAULT (16u << 20)    // taille d'un segment par défaut (argv : en Mo)
+#define GLOG_SEG_MIN     (64u << 10)
+#define GLOG_HDR         16
+#define GLOG_REC_HDR     10
+#define GLOG_FLUSH_MS    100            // période de synchronisation (group commit)
+#define GLOG_WAIT_MS     200            // attente maximale du flusher à la rotation
+
+#define GLOG_MSG    1
+#define GLOG_JOIN   2
+#define GLOG_LEFT   3
+#define GLOG_BAN    4
+#define GLOG_UNBAN  5
+#define GLOG_ACTION 6
+
+static GroupLog       *glog_list = NULL;
+static pthread_mutex_t glog_list_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       glog_th;
+static volatile int    glog_th_run = 0;
+static pthread_mutex_t glog_wake_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  glog_wake = PTHREAD_COND_INITIALIZER;   // rotation : réveil anticipé du flusher
+
+/* Crée et mappe le segment no (taille glog_seg_size), en-tête écrit */
+static int glog_seg_open(GroupLog *l, GlogSeg *sg, uint32_t no){
+    char fn[320];
+    snprintf(fn, sizeof fn, "%s.%06u.isylog", l->path, no);
+
+    int fd = open(fn, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0) return -1;
+
+    void *p = MAP_FAILED;
+    if(ftruncate(fd, (off_t)glog_seg_size) == 0)
+        p = mmap(NULL, glog_seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED){
+        int e = errno;
+        close(fd);
+        unlink(fn);
+        errno = e;
+        return -1;
     }
 
-    // Sauvegarde locale (utile pour logs + préfix GROUPE[...])
-    strncpy(gname_local, gname, sizeof gname_local - 1);
-    gport_local = gport;
+    sg->fd = fd;
+    sg->base = (uint8_t*)p;
+    sg->size = glog_seg_size;
+    sg->no = no;
+    sg->used = 0;
 
-    // Gestion des signaux
-    signal(SIGINT, on_sigint);
-    signal(SIGTERM, on_sigint);
+    memcpy(sg->base, "ISYLOG1\n", 8);
+    isy_put32(sg->base + 8, no);
+    isy_put32(sg->base + 12, (uint32_t)time(NULL));
+    return 0;
+}
 
-    // Socket UDP du groupe
-    int s = socket(AF_INET, SOCK_DGRAM, 0);
-    if(s < 0) die_perror("socket");
+/* Synchronise les octets utiles, ramène le fichier à sa taille utile et le ferme */
+static void glog_seg_close(GroupLog *l, GlogSeg *sg, uint32_t used){
+    if(!sg->base) return;
+    msync(sg->base, used, MS_SYNC);
+    munmap(sg->base, sg->size);
+    if(ftruncate(sg->fd, (off_t)used) == 0) l->syncs++;
+    close(sg->fd);
+    memset(sg, 0, sizeof *sg);
+}
 
-    // Réutilisation d’adresse (pratique en dev)
-    int yes = 1;
-    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+/* Échéance absolue dans ms millisecondes (CLOCK_REALTIME, pour pthread_cond_timedwait) */
+static void glog_deadline(struct timespec *ts, long ms){
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += ms / 1000;
+    ts->tv_nsec += (ms % 1000) * 1000000L;
+    if(ts->tv_nsec >= 1000000000L){ ts->tv_sec++; ts->tv_nsec -= 1000000000L; }
+}
 
-    // Timeout pour permettre de quitter proprement
-    set_rcv_timeout(s, 300);
+/*
+    Prépare jusqu'à want segments d'avance (flusher ; réception en secours).
+    Sous open_mtx : les numéros sont attribués et les segments publiés dans
+    l'ordre, personne d'autre n'ouvre entre-temps. mtx n'est tenu que pour
+    lire/poser les compteurs, jamais pendant open/ftruncate/mmap.
+    Retour : nombre de segments publiés.
+*/
+static unsigned glog_prepare(GroupLog *l, unsigned want){
+    pthread_mutex_lock(&l->open_mtx);
+
+    pthread_mutex_lock(&l->mtx);
+    unsigned room = GLOG_AHEAD - l->nready;
+    if(want > room) want = room;
+    uint32_t no = l->next_no;
+    pthread_mutex_unlock(&l->mtx);
+
+    GlogSeg sg[GLOG_AHEAD];
+    unsigned k = 0;
+    while(k < want && glog_seg_open(l, &sg[k], no + k) == 0) k++;
+
+    pthread_mutex_lock(&l->mtx);
+    for(unsigned i=0;i<k;i++) l->ready[l->nready++] = sg[i];
+    l->next_no = no + k;            // échec d'ouverture : numéro repris au prochain essai
+    if(k) pthread_cond_broadcast(&l->cv);
+    pthread_mutex_unlock(&l->mtx);
+
+    pthread_mutex_unlock(&l->open_mtx);
+    return k;
+}
 
-    // Bind UDP sur INADDR_ANY:<port groupe>
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof addr);
-    addr.sin_family      = AF_INET;
-    addr.sin_port        = htons(gport);
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+/*
+    Passe au segment suivant (thread de réception, une fois par segment).
+    Cas normal : un segment préparé attend, simple échange de pointeurs.
+    Flusher en retard (aucun segment prêt ou trop de segments quittés en
+    attente) : on le réveille et on attend au plus GLOG_WAIT_MS, puis on fait
+    son travail soi-même (ouverture, ou finalisation d'un ancien segment).
+    Retour -1 seulement si aucun segment ne peut être ouvert (disque).
+*/
+static int glog_rotate(GroupLog *l){
+    pthread_mutex_lock(&l->mtx);
+
+    if(!l->nready || l->nretired == GLOG_RETIRED){
+        struct timespec ts;
+        glog_deadline(&ts, GLOG_WAIT_MS);
+        l->waits++;
+        pthread_cond_signal(&glog_wake);
+        while((!l->nready || l->nretired == GLOG_RETIRED) &&
+              pthread_cond_timedwait(&l->cv, &l->mtx, &ts) == 0)
+            ;
+    }
 
-    if(bind(s, (struct sockaddr*)&addr, sizeof addr) < 0)
-        die_perror("bind group");
+    if(l->nretired == GLOG_RETIRED){
+        // le plus ancien que le flusher ne synchronise pas en ce moment
+        unsigned i = (l->retired[0].no == l->flushing) ? 1 : 0;
+        GlogSeg sg = l->retired[i];
+        memmove(&l->retired[i], &l->retired[i + 1], (GLOG_RETIRED - i - 1) * sizeof sg);
+        l->nretired--;
+        pthread_mutex_unlock(&l->mtx);
+        glog_seg_close(l, &sg, sg.used);
+        pthread_mutex_lock(&l->mtx);
+    }
 
-    // Initialisation état
-    memset(members, 0, sizeof members);
-    memset(bans, 0, sizeof bans);
-    admin_banner_active = 0; admin_banner[0] = '\0';
-    idle_banner_active  = 0; idle_banner[0] = '\0';
-    g_admin_token[0]    = '\0';
-    last_activity       = time(NULL);
+    if(!l->nready){
+        pthread_mutex_unlock(&l->mtx);
+        if(glog_prepare(l, 1) == 0) return -1;
+        pthread_mutex_lock(&l->mtx);
+        l->inlined++;
+    }
 
-    fprintf(stderr, "[GroupeISY] '%s' UDP %u (idle=%us)\n",
-            gname_local, (unsigned)gport_local, idle_timeout_sec);
+    l->retired[l->nretired] = l->cur;
+    l->retired[l->nretired].used = l->w;
+    l->nretired++;
+    l->cur = l->ready[0];
+    memmove(&l->ready[0], &l->ready[1], (--l->nready) * sizeof l->ready[0]);
+    l->synced = 0;
+    __atomic_store_n(&l->w, GLOG_HDR, __ATOMIC_RELEASE);
+    l->rotations++;
+
+    pthread_mutex_unlock(&l->mtx);
+    pthread_cond_signal(&glog_wake);   // finaliser l'ancien, préparer le suivant sans attendre
+    return 0;
+}
 
-    // Démarre le thread timer d’inactivité (détaché)
-    pthread_t th_timer;
-    TimerCtx tctx = {.sock = s};
-    if(pthread_create(&th_timer, NULL, idle_timer_thread, &tctx) == 0){
-        pthread_detach(th_timer);
+/*
+    Ajoute un enregistrement (thread de réception uniquement). Chemin chaud :
+    recopie dans le segment mappé, pas d'appel système ni de verrou.
+*/
+static void glog_append(GroupLog *l, uint8_t type, const char *user, size_t ulen,
+                        const char *text, size_t tlen){
+    if(!l) return;
+    if(ulen > 255) ulen = 255;
+    if(tlen > TXT_LEN) tlen = TXT_LEN;
+
+    uint32_t len = (uint32_t)(GLOG_REC_HDR + ulen + tlen);
+    uint32_t span = (len + 3u) & ~3u;
+    uint32_t w = l->w;
+
+    // place pour l'enregistrement + un u32 nul de fin
+    if(w + span + 4 > l->cur.size){
+        if(glog_rotate(l) < 0){
+            l->lost++;
+            if(type == GLOG_BAN || type == GLOG_UNBAN || type == GLOG_ACTION)
+                fprintf(stderr, "[GroupeISY] journal %s: enregistrement de modération perdu (%s)\n",
+                        l->path, strerror(errno));
+            return;
+        }
+        w = l->w;
     }
 
-    // Buffer réception (messages + commandes)
-    char buf[TXT_LEN + 256];
+    uint8_t *p = l->cur.base + w;
+    isy_put32(p + 4, (uint32_t)time(NULL));
+    p[8] = type;
+    p[9] = (uint8_t)ulen;
+    memcpy(p + GLOG_REC_HDR, user, ulen);
+    memcpy(p + GLOG_REC_HDR + ulen, text, tlen);
+    __atomic_store_n((uint32_t*)p, htonl(len), __ATOMIC_RELEASE);
+
+    __atomic_store_n(&l->w, w + span, __ATOMIC_RELEASE);
+    l->records++;
+    l->bytes += span;
+}
 
-    /*
-        Boucle principale :
-          - reçoit un datagramme UDP
-          - met à jour l’activité
-          - route vers :
-              CTRL / CMD / MSG / SYS
+/*
+    Flusher (un thread par processus, tous les journaux ouverts) : toutes les
+    GLOG_FLUSH_MS, ou dès qu'une rotation le réveille, complète les segments
+    préparés d'avance, finalise les segments quittés et fait le msync de ce qui
+    a été écrit depuis le dernier passage (group commit). Sous mtx, il ne fait
+    que relever ou poser des pointeurs : msync/munmap/ftruncate/open se font
+    verrou relâché. Une projection relevée reste valide sans verrou : la
+    réception ne démappe jamais le segment noté dans flushing.
+*/
+static void glog_flush_one(GroupLog *l){
+    pthread_mutex_lock(&l->mtx);
+    GlogSeg old[GLOG_RETIRED];
+    unsigned nold = l->nretired;
+    memcpy(old, l->retired, nold * sizeof old[0]);
+    l->nretired = 0;
+    unsigned want = GLOG_AHEAD - l->nready;
+    uint8_t *base = l->cur.base;
+    uint32_t w = __atomic_load_n(&l->w, __ATOMIC_ACQUIRE);
+    uint32_t synced = l->synced;
+    l->synced = w;
+    l->flushing = l->cur.no;
+    if(nold) pthread_cond_broadcast(&l->cv);
+    pthread_mutex_unlock(&l->mtx);
+
+    // d'abord les segments d'avance (les prochaines rotations en dépendent), puis le disque
+    if(want) glog_prepare(l, want);
+
+    for(unsigned i=0;i<nold;i++) glog_seg_close(l, &old[i], old[i].used);
+
+    if(w > synced){
+        uint32_t from = synced & ~(uint32_t)(sysconf(_SC_PAGESIZE) - 1);
+        if(msync(base + from, w - from, MS_SYNC) == 0) l->syncs++;
+    }
+
+    pthread_mutex_lock(&l->mtx);
+    l->flushing = 0;
+    pthread_mutex_unlock(&l->mtx);
+}
+
+static void *glog_flusher(void *arg){
+    (void)arg;
+    while(glog_th_run){
+        struct timespec ts;
+        glog_deadline(&ts, GLOG_FLUSH_MS);
+        pthread_mutex_lock(&glog_wake_mtx);
+        if(glog_th_run) pthread_cond_timedwait(&glog_wake, &glog_wake_mtx, &ts);
+        pthread_mutex_unlock(&glog_wake_mtx);
+
+        pthread_mutex_lock(&glog_list_mtx);
+        for(GroupLog *l = glog_list; l; l = l->link) glog_flush_one(l);
+        pthread_mutex_unlock(&glog_list_mtx);
+    }
+    return NULL;
+}
+
+/*
+    Ouvre le journal du groupe (segment suivant le dernier existant) et
+    démarre le flusher au premier journal. Échec => groupe sans journal.
+*/
+static void group_log_open(Group *g){
+    if(!glog_dir[0]) return;
+    if(!glog_seg_size) glog_seg_size = GLOG_SEG_DEFAULT;
+
+    GroupLog *l = (GroupLog*)calloc(1, sizeof *l);
+    if(!l) return;
+
+    // nom de fichier : caractères sûrs uniquement
+    char safe[GNAME_LEN];
+    size_t i = 0;
+    for(; g->name[i] && i < sizeof safe - 1; i++)
+        safe[i] = (isalnum((unsigned char)g->name[i]) || g->name[i] == '-' || g->name[i] == '_') ? g->name[i] : '_';
+    safe[i] = '\0';
+    snprintf(l->path, sizeof l->path, "%s/%s", glog_dir, safe);
+
+    // on continue la numérotation d'un journal précédent du même groupe
+    uint32_t no = 1;
+    for(;;){
+        char fn[320];
+        struct stat st;
+        snprintf(fn, sizeof fn, "%s.%06u.isylog", l->path, no);
+        if(stat(fn, &st) < 0) break;
+        no++;
+    }
+
+    if(glog_seg_open(l, &l->cur, no) < 0){
+        fprintf(stderr, "[GroupeISY] '%s' journal %s indisponible: %s\n", g->name, l->path, strerror(errno));
+        free(l);
+        return;
+    }
+    l->w = GLOG_HDR;
+    l->next_no = no + 1;
+    pthread_mutex_init(&l->mtx, NULL);
+    pthread_cond_init(&l->cv, NULL);
+    pthread_mutex_init(&l->open_mtx, NULL);
+    glog_prepare(l, GLOG_AHEAD);    // le flusher n'a pas encore tourné : première rotation servie
+
+    pthread_mutex_lock(&glog_list_mtx);
+    l->link = glog_list;
+    glog_list = l;
+    if(!glog_th_run){
+        // Le flusher ne reçoit aucun signal : SIGINT/SIGTERM restent au thread principal
+        sigset_t all, prev;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &prev);
+        glog_th_run = 1;
+        if(pthread_create(&glog_th, NULL, glog_flusher, NULL) != 0) glog_th_run = 0;
+        pthread_sigmask(SIG_SETMASK, &prev, NULL);
+    }
+    pthread_mutex_unlock(&glog_list_mtx);
+
+    g->log = l;
+}
+
+/* Retire le journal de la liste du flusher, le synchronise et le ferme */
+static void group_log_close(Group *g){
+    GroupLog *l = g->log;
+    if(!l) return;
+
+    pthread_mutex_lock(&glog_list_mtx);
+    for(GroupLog **pp = &glog_list; *pp; pp = &(*pp)->link){
+        if(*pp == l){ *pp = l->link; break; }
+    }
+    pthread_mutex_unlock(&glog_list_mtx);
+
+    for(unsigned i=0;i<l->nretired;i++) glog_seg_close(l, &l->retired[i], l->retired[i].used);
+    glog_seg_close(l, &l->cur, l->w);
+    for(unsigned i=0;i<l->nready;i++){
+        // préparés mais jamais utilisés : supprimés
+        char fn[320];
+        snprintf(fn, sizeof fn, "%s.%06u.isylog", l->path, l->ready[i].no);
+        munmap(l->ready[i].base, l->ready[i].size);
+        close(l->ready[i].fd);
+        unlink(fn);
+    }
+
+    fprintf(stderr, "[GroupeISY] '%s' journal: %lu enregistrements, %lu octets, %lu rotations, %lu synchronisations, "
+            "%lu attentes du flusher, %lu segments ouverts en secours, %lu perdus\n",
+            g->name, l->records, l->bytes, l->rotations, l->syncs, l->waits, l->inlined, l->lost);
+
+    pthread_mutex_destroy(&l->open_mtx);
+    pthread_cond_destroy(&l->cv);
+    pthread_mutex_destroy(&l->mtx);
+    free(l);
+    g->log = NULL;
+}
+
+/* Arrête le flusher (fin du processus, après fermeture des groupes) */
+static void glog_stop(void){
+    if(!glog_th_run) return;
+    pthread_mutex_lock(&glog_wake_mtx);
+    glog_th_run = 0;
+    pthread_cond_signal(&glog_wake);
+    pthread_mutex_unlock(&glog_wake_mtx);
+    pthread_join(glog_th, NULL);
+}
+
+/* Arguments du journal : répertoire ("-" ou "" = désactivé), taille des segments en Mo */
+static void glog_args(const char *dir, const char *mb){
+    if(dir && strcmp(dir, "-"))
+        snprintf(glog_dir, sizeof glog_dir, "%s", dir);
+    if(mb){
+        unsigned long m = strtoul(mb, NULL, 10);
+        if(m > 1024) m = 1024;
+        glog_seg_size = m ? (uint32_t)(m << 20) : GLOG_SEG_DEFAULT;
+    }
+}
+
+/*
+    --bench-log [messages] [dir] : écrit N messages de chat dans un journal
+    (segments de taille par défaut) et mesure le débit du chemin d'ajout, puis
+    le temps de fermeture (synchronisation finale comprise).
+*/
+static int bench_log(unsigned long n, const char *dir){
+    static Group g;
+    snprintf(g.name, sizeof g.name, "bench%ld", (long)getpid());
+    glog_args(dir, NULL);
+
+    group_log_open(&g);
+    if(!g.log){
+        fprintf(stderr, "bench-log: journal impossible dans %s\n", glog_dir);
+        return 1;
+    }
+
+    char text[96];
+    memset(text, 'x', sizeof text);
+
+    struct timespec t0, t1, t2;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(unsigned long i=0;i<n;i++){
+        int k = snprintf(text, sizeof text, "%lu", i);
+        text[k] = ' ';
+        glog_append(g.log, GLOG_MSG, "alice", 5, text, 64);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    unsigned long bytes = g.log->bytes;
+    unsigned long lost = g.log->lost;
+    unsigned long waits = g.log->waits, inlined = g.log->inlined;
+    group_log_close(&g);
+    glog_stop();
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    double s_app = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    double s_all = (double)(t2.tv_sec - t0.tv_sec) + (double)(t2.tv_nsec - t0.tv_nsec) / 1e9;
+    if(s_app <= 0) s_app = 1e-9;
+
+    printf("bench-log: %lu messages, %lu octets, %lu perdus (%lu attentes du flusher, %lu segments ouverts en secours)\n",
+           n, bytes, lost, waits, inlined);
+    printf("  ajout      : %.3f s, %.0f msg/s, %.1f Mo/s, %.0f ns/msg\n",
+           s_app, (double)n / s_app, (double)bytes / s_app / 1e6, s_app * 1e9 / (double)(n ? n : 1));
+    printf("  avec sync  : %.3f s, %.0f msg/s, %.1f Mo/s\n",
+           s_all, (double)n / s_all, (double)bytes / s_all / 1e6);
+    return 0;
+}
+
+/* ───────────────────────── Admin token logic ───────────────────────── */
+/*
+    Vérifie / initialise le token admin.
+    - Si g->admin_token est vide, la première commande admin reçue peut l'initialiser (fallback).
+    - Sinon, on exige l’égalité exacte.
+
+    But :
+      - Permet d'utiliser le token fourni par ServeurISY
+      - Mais reste robuste même si le token n’a pas été "SETTOKEN" au démarrage.
+*/
+static int ensure_or_check_admin_token_locked(Group *g, const char *tok){
+    if(!tok || !*tok) return 0;
+
+    // Fallback : 1ère commande admin configure le token si inconnu
+    if(g->admin_token[0] == '\0'){
+        isy_strcpy(g->admin_token, sizeof g->admin_token, tok);
+        return 1;
+    }
+
+    return (strcmp(g->admin_token, tok) == 0);
+}
+
+/* ───────────────────────── Cycle de vie d'un groupe ───────────────────────── */
+
+/*
+    Ouvre un groupe : tables + index (dimensionnés une fois pour toutes),
+    socket UDP lié sur INADDR_ANY:<port>.
+    Mode mono-port (shared >= 0) : pas de socket propre, le groupe émet et reçoit
+    via le socket commun shared (port = port commun, gid = identifiant).
+    Retour : 0 si OK, -1 sinon (errno positionné, rien ne reste alloué).
+*/
+static int group_open(Group *g, const char *name, uint16_t port, unsigned idle_sec, int shared, int gid){
+    memset(g, 0, sizeof *g);
+    g->sock = -1;
+    g->gid  = -1;
+    g->stat_fd = -1;
+    g->rtx.lo = g->rtx.next = 1;
+
+    isy_strcpy(g->name, sizeof g->name, name);
+    g->pfx_line = (size_t)snprintf(g->pfx, sizeof g->pfx, "GROUPE[%s]: ", g->name);
+    g->pfx_chat = g->pfx_line + (size_t)snprintf(g->pfx + g->pfx_line, sizeof g->pfx - g->pfx_line, "Message de ");
+    g->gfield_len = 2 + strlen(g->name);
+    isy_put16(g->gfield, (uint16_t)(g->gfield_len - 2));
+    memcpy(g->gfield + 2, g->name, g->gfield_len - 2);
+    g->port             = port;
+    g->idle_timeout_sec = idle_sec;
+    g->max_members      = max_members;
+    g->max_bans         = max_bans;
+    g->last_activity    = time(NULL);
+    pthread_mutex_init(&g->mtx, NULL);
+
+    g->members = (Member*)calloc(g->max_members, sizeof *g->members);
+    g->bans    = (BanRec*)calloc(g->max_bans, sizeof *g->bans);
+    if(!g->members || !g->bans ||
+       hidx_init(&g->idx_mname, g->max_members) < 0 ||
+       hidx_init(&g->idx_maddr, g->max_members) < 0 ||
+       hidx_init(&g->idx_ban, g->max_bans) < 0 ||
+       history_resize(g, history_len) < 0)
+        goto fail;
+
+    group_log_open(g);
+
+    if(shared >= 0){
+        g->sock = shared;
+        g->shared_sock = 1;
+        g->gid = gid;
+        fprintf(stderr, "[GroupeISY] '%s' UDP %u @%d (idle=%us, membres=%u, bans=%u, historique=%u)\n",
+                g->name, (unsigned)g->port, g->gid, g->idle_timeout_sec, g->max_members, g->max_bans, g->hist_cap);
+        return 0;
+    }
+
+    // Socket UDP du groupe
+    g->sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if(g->sock < 0) goto fail;
+
+    // Réutilisation d’adresse (pratique en dev)
+    int yes = 1;
+    setsockopt(g->sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+
+    // Bind UDP sur INADDR_ANY:<port groupe>
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if(bind(g->sock, (struct sockaddr*)&addr, sizeof addr) < 0) goto fail;
+
+    fprintf(stderr, "[GroupeISY] '%s' UDP %u (idle=%us, membres=%u, bans=%u, historique=%u)\n",
+            g->name, (unsigned)g->port, g->idle_timeout_sec, g->max_members, g->max_bans, g->hist_cap);
+    return 0;
+
+fail:;
+    int e = errno;
+    if(g->sock >= 0 && !g->shared_sock) close(g->sock);
+    free(g->members);
+    free(g->bans);
+    free(g->idx_mname.cells);
+    free(g->idx_maddr.cells);
+    free(g->idx_ban.cells);
+    (void)history_resize(g, 0);
+    group_log_close(g);
+    pthread_mutex_destroy(&g->mtx);
+    errno = e;
+    return -1;
+}
+
+/* Affiche les statistiques du groupe sur stderr (à l'arrêt) */
+static void group_report(const Group *g){
+    fprintf(stderr, "[GroupeISY] '%s' stats: %lu diffusions, %lu syscalls, %lu envois, %lu partiels, %lu erreurs\n",
+            g->name, g->stats.broadcasts, g->stats.syscalls, g->stats.sent, g->stats.partial, g->stats.errors);
+#if GROUP_LOCKING
+    fprintf(stderr, "[GroupeISY] '%s' mtx max %lu ns\n", g->name, g->stats.lock_max_ns);
+#endif
+    fprintf(stderr, "[GroupeISY] '%s' sessions: %lu MSG rapides, %lu MSG complets, %lu re-associations\n",
+            g->name, g->stats.msg_fast, g->stats.msg_slow, g->stats.rebinds);
+    fprintf(stderr, "[GroupeISY] '%s' copies: %lu octets (%lu o/diffusion)\n",
+            g->name, g->stats.copied, g->stats.broadcasts ? g->stats.copied / g->stats.broadcasts : 0UL);
+    fprintf(stderr, "[GroupeISY] '%s' fiabilite: %u diffusions numerotees, %lu NACK, %lu trames renvoyees, %lu perdues (GAP)\n",
+            g->name, g->rtx.next - 1, g->stats.nacks, g->stats.rtx, g->stats.gaps);
+    fprintf(stderr, "[GroupeISY] '%s' historique: %u messages gardes au plus, %lu rejoues\n",
+            g->name, g->hist_cap, g->stats.replayed);
+    fprintf(stderr, "[GroupeISY] '%s' stopped.\n", g->name);
+}
+
+/* Ferme le socket, affiche les statistiques du groupe et libère son état */
+static void group_close(Group *g){
+    if(g->sock >= 0 && !g->shared_sock) close(g->sock);
+    g->sock = -1;
+
+    group_report(g);
+    group_log_close(g);
+
+    free(g->members);
+    free(g->bans);
+    free(g->idx_mname.cells);
+    free(g->idx_maddr.cells);
+    free(g->idx_ban.cells);
+    free(g->rtx.arena);
+    free(g->rtx.ent);
+    (void)history_resize(g, 0);
+    pthread_mutex_destroy(&g->mtx);
+}
+
+/*
+    Annonce "GSTAT <nom> <membres>" au serveur (LIST +members) si le nombre de
+    membres a changé depuis la dernière annonce. Appelée après chaque lot de
+    datagrammes : un seul envoi même si plusieurs membres arrivent d'un coup.
+*/
+static void group_stat(Group *g){
+    if(g->stat_fd < 0 || g->nmembers == g->stat_sent) return;
+
+    char out[64];
+    snprintf(out, sizeof out, ISY_GROUP_STAT " %s %u", g->name, g->nmembers);
+    send_txt(g->stat_fd, out, &g->stat_to);
+    g->stat_sent = g->nmembers;
+}
+
+/*
+    Annonce "READY <nom>" au serveur, une fois le socket du groupe lié : le serveur
+    ne donne le port au client du CREATE qu'à ce moment.
+*/
+static void group_ready(Group *g){
+    if(g->stat_fd < 0) return;
+
+    char out[64];
+    snprintf(out, sizeof out, ISY_GROUP_READY " %s", g->name);
+    send_txt(g->stat_fd, out, &g->stat_to);
+}
+
+/* ───────────────────────── Timer Inactivité ───────────────────────── */
+
+/* Formate une heure locale HH:MM:SS */
+static void fmt_hhmmss(time_t t, char *out, size_t n){
+    struct tm tmv;
+    localtime_r(&t, &tmv);
+    strftime(out, n, "%H:%M:%S", &tmv);
+}
+
+/*
+    Tick d'inactivité (appelé à chaque échéance de group_deadline(), ou ~1 fois par
+    seconde par le thread timer hors Linux) :
+      - arrêt différé (stop_at, posé par REDIRECT) : marque le groupe mort à l'échéance
+      - Warn threshold : idle_timeout/2 (ou idle_timeout si trop petit)
+      - Bannière envoyée 1 seule fois (idle_banner_active sert de garde-fou)
+      - si aucune activité jusqu’au timeout complet :
+          * envoie un message SYS
+          * marque le groupe mort (g->dead)
+      - Décision + snapshot sous mtx, envois hors mtx
+*/
+static void group_idle_tick(Group *g, DestSnap *d, time_t now){
+    if(g->stop_at && now >= g->stop_at){
+        g->dead = 1;
+        return;
+    }
+
+    // Désactive le mécanisme si timeout = 0
+    if(g->idle_timeout_sec == 0) return;
+
+    time_t since;
+
+    int need_warn = 0;
+    int need_clear = 0;
+    int do_exit = 0;
+
+    char warn_banner[TXT_LEN];
+    char hhmmss[16];
+    time_t deletion_time = 0;
+
+    grp_lock(g);
+
+    since = now - g->last_activity;
+
+    // On avertit à mi-parcours (ou au max si idle_timeout est très petit)
+    unsigned warn_threshold = (g->idle_timeout_sec >= 2 ? g->idle_timeout_sec / 2 : g->idle_timeout_sec);
+
+    if(since >= (time_t)g->idle_timeout_sec){
+        // Timeout atteint -> suppression du groupe
+        if(g->idle_banner_active) need_clear = 1;
+        do_exit = 1;
+
+    } else if(since >= (time_t)warn_threshold){
+        // On affiche une bannière d'avertissement (une seule fois)
+        if(!g->idle_banner_active){
+            deletion_time = g->last_activity + (time_t)g->idle_timeout_sec;
+            g->idle_banner_active = 1;
+            need_warn = 1;
+        }
+    }
+
+    if(need_warn || need_clear || do_exit) snap_members_nolock(g, d);
+
+    grp_unlock(g);
+
+    // Le formatage de la bannière (localtime_r) se fait aussi hors lock
+    if(need_warn){
+        fmt_hhmmss(deletion_time, hhmmss, sizeof hhmmss);
+
+        grp_lock(g);
+        snprintf(g->idle_banner, sizeof g->idle_banner,
+                 "Inactivite detectee: le groupe '%s' sera supprime a %s sans activite.",
+                 g->name, hhmmss);
+        isy_strcpy(warn_banner, sizeof warn_banner, g->idle_banner);
+        grp_unlock(g);
+
+        broadcast_banner(g, d, 1, warn_banner);
+    }
+
+    if(need_clear){
+        broadcast_banner(g, d, 1, NULL);
+    }
+
+    // Suppression du groupe : message + arrêt
+    if(do_exit){
+        broadcast_to_snap(g, d,
+            "SYS Le groupe est supprime pour cause d'inactivite. Tappez \"quit\" pour quitter.");
+        g->dead = 1;
+    }
+}
+
+/*
+    Prochaine échéance du groupe (heure absolue, 0 = aucune) : la plus proche parmi
+    l'arrêt différé, l'avertissement d'inactivité (s'il n'est pas déjà affiché) et la
+    suppression. Un réveil à cette heure-là suffit : group_touch() ne fait que
+    repousser les échéances, un réveil devenu prématuré ne fait rien et réarme.
+*/
+static time_t group_deadline(Group *g){
+    time_t at = g->stop_at;
+
+    if(g->idle_timeout_sec){
+        unsigned warn_threshold = (g->idle_timeout_sec >= 2 ? g->idle_timeout_sec / 2 : g->idle_timeout_sec);
+        time_t warn = g->last_activity + (time_t)warn_threshold;
+        time_t kill = g->last_activity + (time_t)g->idle_timeout_sec;
+
+        if(!g->idle_banner_active && (!at || warn < at)) at = warn;
+        if(!at || kill < at) at = kill;
+    }
+    return at;
+}
+
+#if !defined(__linux__)
+/*
+    Thread timer (mode classique) :
+      - appelle group_idle_tick() chaque seconde
+      - se termine quand le groupe est mort ou que le processus s'arrête
+*/
+static void *idle_timer_thread(void *arg){
+    Group *g = (Group*)arg;
+    DestSnap d;
+    snap_init(&d, g->max_members);
+
+    while(running && !g->dead){
+        sleep(1);
+        group_idle_tick(g, &d, time(NULL));
+    }
+
+    snap_free(&d);
+    return NULL;
+}
+#endif
+
+/* ───────────────────────── Traitement d'un datagramme ───────────────────────── */
+
+/*
+    Activité (MSG / commande client) : reset du timer d'inactivité et retrait
+    de la bannière inactivité si elle était affichée.
+*/
+static void group_touch(Group *g, DestSnap *d){
+    int clear_idle = 0;
+
+    grp_lock(g);
+
+    g->last_activity = time(NULL);
+
+    // Si on était en bannière d’inactivité, on la retire dès qu’il y a activité
+    if(g->idle_banner_active){
+        g->idle_banner_active = 0;
+        clear_idle = 1;
+        snap_members_nolock(g, d);
+    }
+
+    grp_unlock(g);
+
+    if(clear_idle) broadcast_banner(g, d, 1, NULL);
+}
+
+/*
+    MSG d'un client (texte "MSG <user> <texte...>" ou trame MSG) :
+      - p/ulen : pseudo annoncé (non terminé), text/tlen : texte (non terminé)
+      - bin    : format de la requête (retenu pour le membre, et pour lui répondre)
+*/
+static void group_on_msg(Group *g, DestSnap *d, const struct sockaddr_in *cli, int bin,
+                         const char *p, size_t ulen, const char *text, size_t tlen){
+    int s = g->sock;
+    char user[EME_LEN];
+
+    int is_join = (tlen == 8 && !memcmp(text, "(joined)", 8));
+    int is_left = (tlen == 6 && !memcmp(text, "(left)", 6));
+
+    // Copies des bannières pour le handshake (envoyées hors lock)
+    char ban_admin[TXT_LEN]; ban_admin[0] = '\0';
+    char ban_idle[TXT_LEN];  ban_idle[0]  = '\0';
+
+    grp_lock(g);
+
+    /*
+        Chemin rapide (session) : l'adresse source est déjà associée à un membre
+        et le pseudo annoncé est bien le sien -> pas de parse, pas de contrôle
+        de ban (un banni n'a plus de session), pas de mise à jour d'adresse.
     */
-    while(running){
-        struct sockaddr_in cli;
-        socklen_t cl = sizeof cli;
+    int idx = member_find_addr_nolock(g, cli);
+    if(idx >= 0 && (strlen(g->members[idx].user) != ulen || memcmp(g->members[idx].user, p, ulen) != 0))
+        idx = -1;
 
-        ssize_t n = recvfrom(s, buf, sizeof buf - 1, 0, (struct sockaddr*)&cli, &cl);
-        if(n < 0){
-            if(errno == EINTR) continue;
-            if(errno == EAGAIN || errno == EWOULDBLOCK) continue;
-            continue;
+    if(idx >= 0){
+        memcpy(user, g->members[idx].user, ulen + 1);
+        g->stats.msg_fast++;
+    } else {
+        /*
+            Chemin lent : adresse inconnue (handshake "(joined)", ancien client, ou
+            changement de port). member_add_or_update_nolock() crée la session,
+            ou la ré-associe si le pseudo existe déjà avec une autre adresse.
+        */
+        isy_strcpy(user, (ulen < sizeof user) ? ulen + 1 : sizeof user, p);
+        g->stats.msg_slow++;
+
+        // Si banni, on refuse et on ne l’ajoute pas à members[]
+        if(ban_is_banned_nolock(g, user)){
+            grp_unlock(g);
+            send_reply(s, bin, "SYS Vous etes banni de ce groupe.", cli);
+            return;
         }
-        buf[n] = '\0';
 
-        /* ───────── Activité : MSG/CMD -> reset timer + retire la bannière inactivité ───────── */
-        if(!strncmp(buf, "MSG ", 4) || !strncmp(buf, "CMD ", 4)){
-            pthread_mutex_lock(&mtx);
+        // Ajoute/maj le membre
+        idx = member_add_or_update_nolock(g, user, cli);
+        if(idx < 0){
+            grp_unlock(g);
+            send_reply(s, bin, "SYS Groupe plein.", cli);
+            return;
+        }
+    }
 
-            last_activity = time(NULL);
+    // Le membre reçoit désormais dans le format de son dernier MSG
+    g->members[idx].bin = (uint8_t)bin;
 
-            // Si on était en bannière d’inactivité, on la retire dès qu’il y a activité
-            if(idle_banner_active){
-                idle_banner_active = 0;
-                broadcast_to_all_nolock(s, "CTRL IBANNER_CLR");
-            }
+    /*
+        Handshake join :
+        Quand un client envoie "(joined)", on lui renvoie les bannières actives
+        pour qu’elles soient affichées immédiatement après un rejoin.
+    */
+    if(is_join){
+        if(g->admin_banner_active) isy_strcpy(ban_admin, sizeof ban_admin, g->admin_banner);
+        if(g->idle_banner_active)  isy_strcpy(ban_idle, sizeof ban_idle, g->idle_banner);
+    }
 
-            pthread_mutex_unlock(&mtx);
-        }
-
-        /* ───────────────────────── CTRL … (serveur -> groupe) ───────────────────────── */
-        if(!strncmp(buf, "CTRL ", 5)){
-            /*
-                CTRL BANNER_SET <txt> :
-                  - met à jour l’état local admin_banner
-                  - diffuse la commande aux clients (ils l’afficheront en haut)
-            */
-            if(!strncmp(buf, "CTRL BANNER_SET ", 16)){
-                const char *t = buf + 16;
-                pthread_mutex_lock(&mtx);
-                isy_strcpy(admin_banner, sizeof admin_banner, t);
-                admin_banner_active = 1;
-                broadcast_to_all_nolock(s, buf);
-                pthread_mutex_unlock(&mtx);
-                continue;
-            }
+    /*
+        Départ propre :
+        MSG user "(left)" => on retire le membre de la table
+        (avant le snapshot : il ne reçoit pas sa propre annonce de départ).
+    */
+    if(is_left) member_remove_nolock(g, user);
 
-            /* CTRL BANNER_CLR : retire la bannière admin */
-            if(!strcmp(buf, "CTRL BANNER_CLR")){
-                pthread_mutex_lock(&mtx);
-                admin_banner_active = 0;
-                admin_banner[0] = '\0';
-                broadcast_to_all_nolock(s, buf);
-                pthread_mutex_unlock(&mtx);
-                continue;
-            }
+    // Historique : messages réels seulement (pas les handshakes)
+    if(!is_join && !is_left) history_push(g, HIST_CHAT, user, strlen(user), text, tlen);
 
-            /*
-                CTRL IBANNER_SET / CLR :
-                - utilisé pour la bannière inactivité (ou imposée si besoin)
-            */
-            if(!strncmp(buf, "CTRL IBANNER_SET ", 18)){
-                const char *t = buf + 18;
-                pthread_mutex_lock(&mtx);
-                isy_strcpy(idle_banner, sizeof idle_banner, t);
-                idle_banner_active = 1;
-                broadcast_to_all_nolock(s, buf);
-                pthread_mutex_unlock(&mtx);
-                continue;
+    snap_members_nolock(g, d);
+
+    grp_unlock(g);
+
+    glog_append(g->log, is_join ? GLOG_JOIN : is_left ? GLOG_LEFT : GLOG_MSG,
+                user, strlen(user), text, tlen);
+
+    if(ban_admin[0]) send_banner(g, bin, 0, ban_admin, cli);
+    if(ban_idle[0])  send_banner(g, bin, 1, ban_idle, cli);
+
+    // Arrivée : la conversation récente, avant sa propre annonce
+    if(is_join) history_replay(g, bin, cli);
+
+    // Relaie la ligne à tous : le texte part directement du tampon de réception
+    broadcast_chat(g, d, user, strlen(user), text, tlen);
+}
+
+/*
+    BAN / UNBAN d'un admin (CMD BAN2/UNBAN2, legacy CMD BAN/UNBAN, trames BAN/UNBAN) :
+      - tok    : token admin du groupe
+      - adminu : pseudo de l'admin pour la ligne [Action] ("admin" pour le legacy)
+*/
+static void group_on_ban(Group *g, DestSnap *d, const struct sockaddr_in *cli, int bin,
+                         int ban, const char *tok, const char *adminu, const char *victim){
+    int s = g->sock;
+
+    grp_lock(g);
+
+    // Vérifie les droits admin via token
+    int ok = ensure_or_check_admin_token_locked(g, tok);
+    if(!ok){
+        grp_unlock(g);
+        send_reply(s, bin, "ERR not_admin", cli);
+        return;
+    }
+
+    int changed = 1;
+    if(ban){
+        // Ajoute au ban + supprime des membres connectés
+        ban_add_nolock(g, victim);
+        member_remove_nolock(g, victim);
+    } else {
+        changed = ban_remove_nolock(g, victim);
+    }
+    if(changed) snap_members_nolock(g, d);
+
+    grp_unlock(g);
+
+    if(!changed){
+        send_reply(s, bin, "OK not_banned", cli);
+        return;
+    }
+
+    // Message visible par tous pour tracer l’action
+    char line[256];
+    snprintf(line, sizeof line, "[Action] (%s) a %s (%s)", adminu, ban ? "banni" : "debanni", victim);
+    history_push(g, HIST_LINE, "", 0, line, strlen(line));
+    glog_append(g->log, ban ? GLOG_BAN : GLOG_UNBAN, adminu, strlen(adminu), victim, strlen(victim));
+    broadcast_group_line(g, d, line);
+
+    send_reply(s, bin, ban ? "OK banned" : "OK unbanned", cli);
+}
+
+/*
+    NACK d'un membre binaire : renvoie les diffusions from .. from+count-1
+    encore présentes dans l'anneau (trames d'origine, seq inchangée), précédées
+    d'un GAP pour celles déjà évincées. Un seul sendmmsg vers ce membre.
+    Les trames sont recopiées sous mtx (l'anneau peut bouger pendant l'envoi
+    hors Linux) ; adresse inconnue => pas de réponse (pas de réflexion).
+*/
+static void group_on_nack(Group *g, const struct sockaddr_in *cli, uint32_t from, unsigned count){
+    static uint8_t out[RTX_BURST * ISY_BIN_MAX];   // un seul thread de réception par processus
+    uint8_t gap[ISY_BIN_HDR + 2];
+    struct iovec iov[RTX_BURST + 1];
+    struct mmsghdr vec[RTX_BURST + 1];
+    RtxRing *x = &g->rtx;
+    unsigned n = 0, lost = 0;
+    size_t used = 0;
+
+    if(from == 0 || count == 0) return;
+    if(count > RTX_BURST) count = RTX_BURST;
+
+    grp_lock(g);
+
+    if(!x->arena || member_find_addr_nolock(g, cli) < 0 || (int32_t)(from - x->next) >= 0){
+        grp_unlock(g);
+        return;
+    }
+    g->stats.nacks++;
+
+    // Seq évincées en tête de plage, puis trames présentes (jamais au-delà de next)
+    if((int32_t)(x->lo - from) > 0) lost = (x->lo - from < count) ? x->lo - from : count;
+    if(x->next - from < count) count = x->next - from;
+
+    for(uint32_t s = from + lost; s - from < count; s++){
+        const RtxEnt *e = &x->ent[s % RTX_SLOTS];
+        memcpy(out + used, x->arena + e->off, e->len);
+        iov[1 + n].iov_base = out + used;
+        iov[1 + n].iov_len  = e->len;
+        used += e->len;
+        n++;
+    }
+
+    grp_unlock(g);
+
+    STAT_ADD(g, copied, used);
+    STAT_ADD(g, rtx, n);
+    STAT_ADD(g, gaps, lost);
+
+    unsigned first = 1;
+    if(lost){
+        ISYWr w;
+        isy_bin_begin(&w, gap, sizeof gap, ISY_OP_GAP, 0, bin_gid(g), from);
+        isy_bin_u16(&w, (uint16_t)lost);
+        iov[0].iov_base = gap;
+        iov[0].iov_len  = isy_bin_end(&w);
+        first = 0;
+    }
+
+    for(unsigned i=first;i<=n;i++){
+        memset(&vec[i], 0, sizeof vec[i]);
+        vec[i].msg_hdr.msg_name    = (void*)cli;
+        vec[i].msg_hdr.msg_namelen = sizeof *cli;
+        vec[i].msg_hdr.msg_iov     = &iov[i];
+        vec[i].msg_hdr.msg_iovlen  = 1;
+    }
+    (void)sendmmsg(g->sock, vec + first, n + 1 - first, 0);
+}
+
+static void group_handle(Group *g, DestSnap *d, char *buf, size_t n, const struct sockaddr_in *cli);
+
+/*
+    Trame binaire v1 d'un client : saut direct sur l'opcode, champs lus par longueur.
+    Les opcodes réservés au serveur / aux clients sont ignorés.
+*/
+static void group_handle_bin(Group *g, DestSnap *d, const ISYHdr *h, ISYRd *r, const struct sockaddr_in *cli){
+    switch(h->op){
+    case ISY_OP_MSG: {
+        size_t ulen, tlen;
+        const char *user = isy_rd_str(r, &ulen);
+        const char *text = isy_rd_str(r, &tlen);
+        if(r->err || ulen == 0 || tlen == 0) return;
+
+        group_touch(g, d);
+        group_on_msg(g, d, cli, 1, user, ulen, text, tlen);
+        return;
+    }
+
+    case ISY_OP_BAN:
+    case ISY_OP_UNBAN: {
+        char tok[ADMIN_TOKEN_LEN], adminu[EME_LEN], victim[EME_LEN];
+        if(isy_rd_cstr(r, tok, sizeof tok) < 0 || isy_rd_cstr(r, adminu, sizeof adminu) < 0 ||
+           isy_rd_cstr(r, victim, sizeof victim) < 0 || !victim[0]){
+            send_reply(g->sock, 1, "ERR bad_args", cli);
+            return;
+        }
+
+        group_touch(g, d);
+        group_on_ban(g, d, cli, 1, h->op == ISY_OP_BAN, tok, adminu[0] ? adminu : "admin", victim);
+        return;
+    }
+
+    case ISY_OP_NACK: {
+        unsigned count = isy_rd_u16(r);
+        if(!r->err) group_on_nack(g, cli, h->seq, count);
+        return;
+    }
+
+    case ISY_OP_TEXT: {
+        // Ligne texte encapsulée : même traitement qu'en texte (réponses en texte)
+        char line[TXT_LEN + 128];
+        if(isy_rd_cstr(r, line, sizeof line) < 0 || line[0] == (char)ISY_BIN_MAGIC) return;
+        group_handle(g, d, line, strlen(line), cli);
+        return;
+    }
+
+    default:
+        send_reply(g->sock, 1, "ERR unknown_cmd", cli);
+        return;
+    }
+}
+
+/*
+    Traite un datagramme de n octets reçu sur le socket du groupe g
+    (buf terminé par '\0' à buf[n]) :
+      - trame binaire (1er octet ISY_BIN_MAGIC) -> group_handle_bin()
+      - sinon ligne texte :
+          * met à jour l’activité
+          * route vers : CTRL / CMD / MSG / SYS
+    Chaque branche : mise à jour d'état + snapshot (d) sous mtx, envois après grp_unlock().
+*/
+static void group_handle(Group *g, DestSnap *d, char *buf, size_t n, const struct sockaddr_in *cli){
+    int s = g->sock;
+
+    ISYHdr h;
+    ISYRd  r;
+    int k = isy_bin_parse(buf, n, &h, &r);
+    if(k > 0){
+        group_handle_bin(g, d, &h, &r, cli);
+        return;
+    }
+    if(k < 0){
+        // Version inconnue : réponse texte, le client repasse en texte
+        send_txt(s, "ERR bad_version", cli);
+        return;
+    }
+
+    /* ───────── Activité : MSG/CMD -> reset timer + retire la bannière inactivité ───────── */
+    if(!strncmp(buf, "MSG ", 4) || !strncmp(buf, "CMD ", 4)){
+        group_touch(g, d);
+    }
+
+    /* ───────────────────────── CTRL … (serveur -> groupe) ───────────────────────── */
+    if(!strncmp(buf, "CTRL ", 5)){
+        /*
+            CTRL BANNER_SET <txt> :
+              - met à jour l’état local admin_banner
+              - diffuse la commande aux clients (ils l’afficheront en haut)
+        */
+        if(!strncmp(buf, "CTRL BANNER_SET ", 16)){
+            const char *t = buf + 16;
+            grp_lock(g);
+            isy_strcpy(g->admin_banner, sizeof g->admin_banner, t);
+            g->admin_banner_active = 1;
+            snap_members_nolock(g, d);
+            grp_unlock(g);
+            broadcast_banner(g, d, 0, t);
+            return;
+        }
+
+        /* CTRL BANNER_CLR : retire la bannière admin */
+        if(!strcmp(buf, "CTRL BANNER_CLR")){
+            grp_lock(g);
+            g->admin_banner_active = 0;
+            g->admin_banner[0] = '\0';
+            snap_members_nolock(g, d);
+            grp_unlock(g);
+            broadcast_banner(g, d, 0, NULL);
+            return;
+        }
+
+        /*
+            CTRL IBANNER_SET / CLR :
+            - utilisé pour la bannière inactivité (ou imposée si besoin)
+        */
+        if(!strncmp(buf, "CTRL IBANNER_SET ", 18)){
+            const char *t = buf + 18;
+            grp_lock(g);
+            isy_strcpy(g->idle_banner, sizeof g->idle_banner, t);
+            g->idle_banner_active = 1;
+            snap_members_nolock(g, d);
+            grp_unlock(g);
+            broadcast_banner(g, d, 1, t);
+            return;
+        }
+        if(!strcmp(buf, "CTRL IBANNER_CLR")){
+            grp_lock(g);
+            g->idle_banner_active = 0;
+            g->idle_banner[0] = '\0';
+            snap_members_nolock(g, d);
+            grp_unlock(g);
+            broadcast_banner(g, d, 1, NULL);
+            return;
+        }
+
+        /*
+            CTRL SETTOKEN <tok> :
+              - définit le token admin attendu pour BAN/UNBAN
+        */
+        if(!strncmp(buf, "CTRL SETTOKEN ", 14)){
+            const char *t = buf + 14;
+            grp_lock(g);
+            isy_strcpy(g->admin_token, sizeof g->admin_token, t);
+            grp_unlock(g);
+            return;
+        }
+
+        /*
+            CTRL HISTORY <n> :
+              - nombre de messages gardés et rejoués au join pour ce groupe (0 = aucun)
+        */
+        if(!strncmp(buf, ISY_CTRL_HISTORY " ", strlen(ISY_CTRL_HISTORY " "))){
+            unsigned cap = (unsigned)strtoul(buf + strlen(ISY_CTRL_HISTORY " "), NULL, 10);
+            if(history_resize(g, cap) == 0)
+                fprintf(stderr, "[GroupeISY] '%s' historique=%u\n", g->name, g->hist_cap);
+            return;
+        }
+
+        /*
+            CTRL REDIRECT ... :
+              - cas de fusion (MERGE)
+              - on diffuse l’ordre aux clients pour qu’ils basculent automatiquement
+              - puis on arrête le groupe après une courte pause (stop_at) :
+                pas de sleep(), un worker continue de servir ses autres groupes
+        */
+        if(!strncmp(buf, "CTRL REDIRECT ", 14)){
+            grp_lock(g);
+            snap_members_nolock(g, d);
+            grp_unlock(g);
+            glog_append(g->log, GLOG_ACTION, "", 0, buf + 5, strlen(buf + 5));
+            broadcast_redirect(g, d, buf);
+            g->stop_at = time(NULL) + 1;   // laisse le temps aux clients de recevoir le message
+            return;
+        }
+
+        // Par défaut : diffuse n'importe quel CTRL inconnu
+        broadcast_to_all(g, d, buf);
+        return;
+    }
+
+    /* ───────────────────────── CMD … (commandes client -> groupe) ───────────────────────── */
+    if(!strncmp(buf, "CMD ", 4)){
+        char tok[ADMIN_TOKEN_LEN] = {0};
+        char adminu[EME_LEN] = {0};
+        char victim[EME_LEN] = {0};
+
+        /*
+            BAN2 / UNBAN2 :
+              - format plus riche (inclut le pseudo de l'admin pour un message [Action])
+              - permet un affichage clair côté chat
+        */
+
+        // CMD BAN2 <token> <adminUser> <victim>
+        if(!strncmp(buf, "CMD BAN2 ", 9)){
+            if(sscanf(buf + 9, "%63s %19s %19s", tok, adminu, victim) != 3){
+                send_txt(s, "ERR bad_args", cli);
+                return;
             }
-            if(!strcmp(buf, "CTRL IBANNER_CLR")){
-                pthread_mutex_lock(&mtx);
-                idle_banner_active = 0;
-                idle_banner[0] = '\0';
-                broadcast_to_all_nolock(s, buf);
-                pthread_mutex_unlock(&mtx);
-                continue;
+            group_on_ban(g, d, cli, 0, 1, tok, adminu, victim);
+            return;
+        }
+
+        // CMD UNBAN2 <token> <adminUser> <victim>
+        if(!strncmp(buf, "CMD UNBAN2 ", 11)){
+            if(sscanf(buf + 11, "%63s %19s %19s", tok, adminu, victim) != 3){
+                send_txt(s, "ERR bad_args", cli);
+                return;
             }
+            group_on_ban(g, d, cli, 0, 0, tok, adminu, victim);
+            return;
+        }
 
-            /*
-                CTRL SETTOKEN <tok> :
-                  - définit le token admin attendu pour BAN/UNBAN
-            */
-            if(!strncmp(buf, "CTRL SETTOKEN ", 14)){
-                const char *t = buf + 14;
-                pthread_mutex_lock(&mtx);
-                isy_strcpy(g_admin_token, sizeof g_admin_token, t);
-                pthread_mutex_unlock(&mtx);
-                continue;
+        /*
+            Commandes legacy BAN/UNBAN (sans adminUser).
+            Gardées pour compatibilité avec d’anciens clients.
+        */
+
+        // CMD BAN <token> <victim>
+        if(!strncmp(buf, "CMD BAN ", 8)){
+            if(sscanf(buf + 8, "%63s %19s", tok, victim) != 2){
+                send_txt(s, "ERR bad_args", cli);
+                return;
             }
+            group_on_ban(g, d, cli, 0, 1, tok, "admin", victim);
+            return;
+        }
 
-            /*
-                CTRL REDIRECT ... :
-                  - cas de fusion (MERGE)
-                  - on diffuse l’ordre aux clients pour qu’ils basculent automatiquement
-                  - puis on arrête le groupe (après une courte pause)
-            */
-            if(!strncmp(buf, "CTRL REDIRECT ", 14)){
-                pthread_mutex_lock(&mtx);
-                broadcast_to_all_nolock(s, buf);
-                pthread_mutex_unlock(&mtx);
-
-                sleep(1);      // laisse le temps aux clients de recevoir le message
-                running = 0;   // stoppe le groupe
-                continue;
+        // CMD UNBAN <token> <victim>
+        if(!strncmp(buf, "CMD UNBAN ", 10)){
+            if(sscanf(buf + 10, "%63s %19s", tok, victim) != 2){
+                send_txt(s, "ERR bad_args", cli);
+                return;
             }
+            group_on_ban(g, d, cli, 0, 0, tok, "admin", victim);
+            return;
+        }
 
-            // Par défaut : diffuse n'importe quel CTRL inconnu
-            pthread_mutex_lock(&mtx);
-            broadcast_to_all_nolock(s, buf);
-            pthread_mutex_unlock(&mtx);
-            continue;
+        // Toute autre commande inconnue
+        send_txt(s, "ERR unknown_cmd", cli);
+        return;
+    }
+
+    /* ───────────────────────── MSG <user> <text...> ───────────────────────── */
+    if(!strncmp(buf, "MSG ", 4)){
+        /*
+            Format attendu : "MSG <user> <texte...>"
+            - on extrait le pseudo
+            - le reste est le texte (peut contenir des espaces)
+        */
+        char *p = buf + 4;
+
+        char *uend = strchr(p, ' ');
+        if(!uend || uend == p) return;
+
+        char *text = uend + 1;
+        if(!*text) return;
+
+        group_on_msg(g, d, cli, 0, p, (size_t)(uend - p), text, strlen(text));
+        return;
+    }
+
+    /* ───────────────────────── SYS ... (serveur -> groupe -> clients) ───────────────────────── */
+    if(!strncmp(buf, "SYS ", 4)){
+        const char *text = buf + 4;
+        if(*text){
+            grp_lock(g);
+            snap_members_nolock(g, d);
+            grp_unlock(g);
+
+            char line[TXT_LEN + 96];
+            snprintf(line, sizeof line, "Message de [SERVER] : %s", text);
+            broadcast_group_line(g, d, line);
         }
+        return;
+    }
 
-        /* ───────────────────────── CMD … (commandes client -> groupe) ───────────────────────── */
-        if(!strncmp(buf, "CMD ", 4)){
-            /*
-                BAN2 / UNBAN2 :
-                  - format plus riche (inclut le pseudo de l'admin pour un message [Action])
-                  - permet un affichage clair côté chat
-            */
+    // Sinon : paquet inconnu -> ignoré (silencieux)
+}
 
-            // CMD BAN2 <token> <adminUser> <victim>
-            if(!strncmp(buf, "CMD BAN2 ", 9)){
-                char tok[ADMIN_TOKEN_LEN] = {0};
-                char adminu[EME_LEN] = {0};
-                char victim[EME_LEN] = {0};
+/* ───────────────────────── Boucle epoll (Linux) ───────────────────────── */
+#ifdef __linux__
 
-                if(sscanf(buf + 9, "%63s %19s %19s", tok, adminu, victim) != 3){
-                    send_txt(s, "ERR bad_args", &cli);
-                    continue;
-                }
+#define WORKER_MAX_EVENTS 64
+#define WORKER_RECV_BURST 32   // datagrammes lus par groupe et par réveil (équité entre groupes)
+#define MUX_RCVBUF (4 << 20)   // tampon de réception du port commun (tous les groupes y arrivent)
 
-                pthread_mutex_lock(&mtx);
+/* Marqueurs epoll (data.ptr) des fds qui ne sont pas des groupes */
+static char worker_tag_ctrl;
+static char worker_tag_alarm;
+static char worker_tag_sig;
+static char worker_tag_mux;
 
-                // Vérifie les droits admin via token
-                int ok = ensure_or_check_admin_token_locked(tok);
-                if(!ok){
-                    pthread_mutex_unlock(&mtx);
-                    send_txt(s, "ERR not_admin", &cli);
-                    continue;
-                }
+/*
+    Réveil à heure fixe : timerfd CLOCK_REALTIME en échéance absolue (même horloge
+    que time(), donc que last_activity / stop_at). at = échéance armée (0 = aucune).
+*/
+typedef struct {
+    int    fd;
+    time_t at;
+} Alarm;
+
+static void alarm_open(Alarm *a){
+    a->fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if(a->fd < 0) die_perror("timerfd_create");
+    a->at = 0;
+}
 
-                // Ajoute au ban + supprime des membres connectés
-                ban_add_nolock(victim);
-                member_remove_nolock(victim);
+/* Arme l'échéance at (0 = désarme) ; rien à faire si elle est déjà armée */
+static void alarm_arm(Alarm *a, time_t at){
+    if(at == a->at) return;
 
-                // Message visible par tous pour tracer l’action
-                char line[256];
-                snprintf(line, sizeof line, "[Action] (%s) a banni (%s)", adminu, victim);
-                broadcast_group_line_nolock(s, line);
+    struct itimerspec its;
+    memset(&its, 0, sizeof its);
+    its.it_value.tv_sec = at;
+    if(timerfd_settime(a->fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) die_perror("timerfd_settime");
+    a->at = at;
+}
 
-                pthread_mutex_unlock(&mtx);
+/* Avance l'échéance si at est plus proche (ex. arrêt différé posé par REDIRECT) */
+static void alarm_lower(Alarm *a, time_t at){
+    if(at && (!a->at || at < a->at)) alarm_arm(a, at);
+}
 
-                send_txt(s, "OK banned", &cli);
-                continue;
-            }
+/*
+    Acquitte un réveil et retourne l'heure courante. On lit CLOCK_REALTIME plutôt que
+    time() : ce dernier peut retarder de quelques ms et voir l'échéance non atteinte.
+*/
+static time_t alarm_fired(Alarm *a){
+    uint64_t n;
+    (void)!read(a->fd, &n, sizeof n);
+    a->at = 0;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec;
+}
 
-            // CMD UNBAN2 <token> <adminUser> <victim>
-            if(!strncmp(buf, "CMD UNBAN2 ", 11)){
-                char tok[ADMIN_TOKEN_LEN] = {0};
-                char adminu[EME_LEN] = {0};
-                char victim[EME_LEN] = {0};
+/* SIGINT/SIGTERM lus sur un fd (bloqués sinon) : pas de handler ni de EINTR */
+static int sigfd_open(void){
+    sigset_t ss;
+    sigemptyset(&ss);
+    sigaddset(&ss, SIGINT);
+    sigaddset(&ss, SIGTERM);
+    if(sigprocmask(SIG_BLOCK, &ss, NULL) < 0) die_perror("sigprocmask");
+
+    int fd = signalfd(-1, &ss, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(fd < 0) die_perror("signalfd");
+    return fd;
+}
 
-                if(sscanf(buf + 11, "%63s %19s %19s", tok, adminu, victim) != 3){
-                    send_txt(s, "ERR bad_args", &cli);
-                    continue;
-                }
+/*
+    Mode classique : un groupe, un thread. epoll sur le socket du groupe, le signalfd
+    et l'alarme. Les datagrammes sont lus par rafales (MSG_DONTWAIT) ; l'alarme est
+    réarmée à l'échéance exacte après chaque réveil du timer, et avancée si un
+    datagramme vient de poser un arrêt différé.
+*/
+static void group_loop(Group *g){
+    int sfd = sigfd_open();
+    Alarm al;
+    alarm_open(&al);
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if(ep < 0) die_perror("epoll_create1");
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = g;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, g->sock, &ev) < 0) die_perror("epoll_ctl group");
+    ev.data.ptr = &worker_tag_sig;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev) < 0) die_perror("epoll_ctl signal");
+    ev.data.ptr = &worker_tag_alarm;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, al.fd, &ev) < 0) die_perror("epoll_ctl timer");
+
+    // Snapshot des destinations (réutilisé par chaque datagramme)
+    DestSnap d;
+    snap_init(&d, g->max_members);
 
-                pthread_mutex_lock(&mtx);
+    char buf[TXT_LEN + 256];
+    struct epoll_event evs[4];
 
-                int ok = ensure_or_check_admin_token_locked(tok);
-                if(!ok){
-                    pthread_mutex_unlock(&mtx);
-                    send_txt(s, "ERR not_admin", &cli);
-                    continue;
-                }
+    alarm_arm(&al, group_deadline(g));
 
-                int removed = ban_remove_nolock(victim);
+    while(running && !g->dead){
+        int ne = epoll_wait(ep, evs, 4, -1);
+        if(ne < 0){
+            if(errno == EINTR) continue;
+            die_perror("epoll_wait");
+        }
 
-                if(removed){
-                    char line[256];
-                    snprintf(line, sizeof line, "[Action] (%s) a debanni (%s)", adminu, victim);
-                    broadcast_group_line_nolock(s, line);
-                    pthread_mutex_unlock(&mtx);
+        for(int i=0;i<ne && !g->dead;i++){
+            void *tag = evs[i].data.ptr;
 
-                    send_txt(s, "OK unbanned", &cli);
-                } else {
-                    pthread_mutex_unlock(&mtx);
-                    send_txt(s, "OK not_banned", &cli);
-                }
+            if(tag == &worker_tag_sig){
+                running = 0;
+                break;
+            }
+
+            if(tag == &worker_tag_alarm){
+                group_idle_tick(g, &d, alarm_fired(&al));
+                alarm_arm(&al, group_deadline(g));
                 continue;
             }
 
-            /*
-                Commandes legacy BAN/UNBAN (sans adminUser).
-                Gardées pour compatibilité avec d’anciens clients.
-            */
+            for(int k=0;k<WORKER_RECV_BURST && !g->dead;k++){
+                struct sockaddr_in cli;
+                socklen_t cl = sizeof cli;
 
-            // CMD BAN <token> <victim>
-            if(!strncmp(buf, "CMD BAN ", 8)){
-                char tok[ADMIN_TOKEN_LEN] = {0};
-                char victim[EME_LEN] = {0};
+                ssize_t n = recvfrom(g->sock, buf, sizeof buf - 1, MSG_DONTWAIT,
+                                     (struct sockaddr*)&cli, &cl);
+                if(n < 0) break;
+                buf[n] = '\0';
 
-                if(sscanf(buf + 8, "%63s %19s", tok, victim) != 2){
-                    send_txt(s, "ERR bad_args", &cli);
-                    continue;
-                }
+                group_handle(g, &d, buf, (size_t)n, &cli);
+            }
+            group_stat(g);
+            alarm_lower(&al, g->stop_at);
+        }
+    }
 
-                pthread_mutex_lock(&mtx);
+    snap_free(&d);
+    close(al.fd);
+    close(sfd);
+    close(ep);
+}
 
-                int ok = ensure_or_check_admin_token_locked(tok);
-                if(!ok){
-                    pthread_mutex_unlock(&mtx);
-                    send_txt(s, "ERR not_admin", &cli);
-                    continue;
-                }
+/* ───────────────────────── Mode worker (multi-groupes) ───────────────────────── */
 
-                ban_add_nolock(victim);
-                member_remove_nolock(victim);
+/* Groupes hébergés par ce worker (ordre quelconque, retrait par échange avec le dernier) */
+static Group  **wgroups    = NULL;
+static unsigned nwgroups   = 0;
+static unsigned capwgroups = 0;
 
-                char line[256];
-                snprintf(line, sizeof line, "[Action] (admin) a banni (%s)", victim);
-                broadcast_group_line_nolock(s, line);
+/* Mode mono-port : socket commun + table gid -> groupe (NULL = libre) */
+static int      mux_fd    = -1;
+static uint16_t mux_port  = 0;
+static Group  **bygid     = NULL;
+static unsigned capbygid  = 0;
 
-                pthread_mutex_unlock(&mtx);
+static Group *worker_find(const char *name){
+    for(unsigned i=0;i<nwgroups;i++){
+        if(!strcmp(wgroups[i]->name, name)) return wgroups[i];
+    }
+    return NULL;
+}
 
-                send_txt(s, "OK banned", &cli);
-                continue;
-            }
+/*
+    Ouvre un groupe et l'ajoute à l'epoll (ou, en mono-port, à la table des gid).
+    Retour : 0 si OK, -1 sinon.
+*/
+static int worker_add_group(int ep, const char *name, uint16_t port, unsigned idle_sec, int gid){
+    if(worker_find(name)) return 0;
+
+    int muxed = (gid >= 0 && mux_fd >= 0);
+    if(muxed){
+        if((unsigned)gid >= capbygid){
+            unsigned ncap = capbygid ? capbygid : 64;
+            while(ncap <= (unsigned)gid) ncap *= 2;
+            Group **nb = (Group**)realloc(bygid, ncap * sizeof *nb);
+            if(!nb) return -1;
+            memset(nb + capbygid, 0, (ncap - capbygid) * sizeof *nb);
+            bygid = nb;
+            capbygid = ncap;
+        }
+        if(bygid[gid]) return -1;   // gid encore occupé (GONE pas encore traité)
+        port = mux_port;
+    }
 
-            // CMD UNBAN <token> <victim>
-            if(!strncmp(buf, "CMD UNBAN ", 10)){
-                char tok[ADMIN_TOKEN_LEN] = {0};
-                char victim[EME_LEN] = {0};
+    if(nwgroups == capwgroups){
+        unsigned ncap = capwgroups ? capwgroups * 2 : 16;
+        Group **nw = (Group**)realloc(wgroups, ncap * sizeof *nw);
+        if(!nw) return -1;
+        wgroups = nw;
+        capwgroups = ncap;
+    }
 
-                if(sscanf(buf + 10, "%63s %19s", tok, victim) != 2){
-                    send_txt(s, "ERR bad_args", &cli);
-                    continue;
-                }
+    Group *g = (Group*)malloc(sizeof *g);
+    if(!g) return -1;
 
-                pthread_mutex_lock(&mtx);
+    if(group_open(g, name, port, idle_sec, muxed ? mux_fd : -1, gid) < 0){
+        fprintf(stderr, "[GroupeISY] worker: ouverture '%s' (port %u) : %s\n",
+                name, (unsigned)port, strerror(errno));
+        free(g);
+        return -1;
+    }
 
-                int ok = ensure_or_check_admin_token_locked(tok);
-                if(!ok){
-                    pthread_mutex_unlock(&mtx);
-                    send_txt(s, "ERR not_admin", &cli);
-                    continue;
-                }
+    if(muxed){
+        bygid[gid] = g;
+        wgroups[nwgroups++] = g;
+        return 0;
+    }
 
-                int removed = ban_remove_nolock(victim);
-                if(removed){
-                    char line[256];
-                    snprintf(line, sizeof line, "[Action] (admin) a debanni (%s)", victim);
-                    broadcast_group_line_nolock(s, line);
-                    pthread_mutex_unlock(&mtx);
-
-                    send_txt(s, "OK unbanned", &cli);
-                } else {
-                    pthread_mutex_unlock(&mtx);
-                    send_txt(s, "OK not_banned", &cli);
-                }
-                continue;
-            }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = g;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, g->sock, &ev) < 0){
+        group_close(g);
+        free(g);
+        return -1;
+    }
+
+    wgroups[nwgroups++] = g;
+    return 0;
+}
 
-            // Toute autre commande inconnue
-            send_txt(s, "ERR unknown_cmd", &cli);
+/* Prévient le serveur qu'un groupe n'existe plus (arrêt, ou création impossible) */
+static void worker_send_gone(int cfd, const struct sockaddr_in *srv, const char *name){
+    char out[64];
+    if(srv->sin_port == 0) return;   // adresse du serveur inconnue
+    snprintf(out, sizeof out, ISY_WORKER_GONE " %s", name);
+    send_txt(cfd, out, srv);
+}
+
+/*
+    Libère les groupes marqués morts (epoll, socket, mémoire) puis envoie GONE.
+    Appelée après chaque lot d'événements : un événement du même lot pouvait
+    encore viser un groupe mort, on ne le libère donc jamais en cours de lot.
+*/
+static void worker_reap(int ep, int cfd, const struct sockaddr_in *srv){
+    for(unsigned i=0;i<nwgroups;){
+        Group *g = wgroups[i];
+        if(!g->dead){ i++; continue; }
+
+        char name[GNAME_LEN];
+        isy_strcpy(name, sizeof name, g->name);
+
+        if(g->gid >= 0) bygid[g->gid] = NULL;
+        else epoll_ctl(ep, EPOLL_CTL_DEL, g->sock, NULL);
+        group_close(g);
+        free(g);
+        wgroups[i] = wgroups[--nwgroups];
+
+        worker_send_gone(cfd, srv, name);
+    }
+}
+
+/*
+    Canal de contrôle : "CTRL ADDGROUP <nom> <port> <idle> [gid]" (datagrammes du serveur).
+    gid présent => groupe servi par le port commun (port ignoré).
+    Seuls les datagrammes venant de srv (adresse passée en argument) sont lus :
+    un autre processus local ne peut ni créer de groupe ni détourner les GONE.
+*/
+static void worker_ctrl(int ep, int cfd, const struct sockaddr_in *srv){
+    char buf[256];
+    const size_t plen = strlen(ISY_CTRL_ADDGROUP " ");
+
+    for(;;){
+        struct sockaddr_in from;
+        socklen_t fl = sizeof from;
+
+        ssize_t n = recvfrom(cfd, buf, sizeof buf - 1, MSG_DONTWAIT, (struct sockaddr*)&from, &fl);
+        if(n < 0) return;
+        buf[n] = '\0';
+
+        if(srv->sin_port == 0 || from.sin_port != srv->sin_port ||
+           from.sin_addr.s_addr != srv->sin_addr.s_addr) continue;
+        if(strncmp(buf, ISY_CTRL_ADDGROUP " ", plen) != 0) continue;
+
+        char name[GNAME_LEN] = {0};
+        unsigned port = 0, idle = 0;
+        int gid = -1;
+        if(sscanf(buf + plen, "%31s %u %u %d", name, &port, &idle, &gid) < 3) continue;
+
+        if(worker_add_group(ep, name, (uint16_t)port, idle, gid) < 0){
+            worker_send_gone(cfd, srv, name);
             continue;
         }
 
-        /* ───────────────────────── MSG <user> <text...> ───────────────────────── */
-        if(!strncmp(buf, "MSG ", 4)){
-            /*
-                Format attendu : "MSG <user> <texte...>"
-                - on extrait le pseudo
-                - le reste est le texte (peut contenir des espaces)
-            */
-            char user[EME_LEN] = {0};
-            char *p = buf + 4;
+        // GSTAT partent du canal de contrôle, comme les GONE
+        Group *g = worker_find(name);
+        if(g){
+            g->stat_fd = cfd;
+            g->stat_to = *srv;
+            group_ready(g);
+        }
+    }
+}
 
-            if(sscanf(p, "%19s", user) != 1) continue;
+/*
+    Démultiplexage mono-port : "@<gid> <datagramme>", ou trame binaire dont
+    l'en-tête porte le gid (la trame est alors transmise entière).
+    Retourne le groupe (et *payload / *plen = datagramme d'origine), ou NULL.
+*/
+static Group *mux_route(char *buf, size_t n, char **payload, size_t *plen){
+    unsigned long gid;
+    char *start;
+
+    if((uint8_t)buf[0] == ISY_BIN_MAGIC){
+        ISYHdr h;
+        ISYRd r;
+        if(isy_bin_parse(buf, n, &h, &r) <= 0) return NULL;
+        gid = h.gid;
+        start = buf;
+    } else {
+        if(buf[0] != ISY_MUX_TAG) return NULL;
+
+        char *end;
+        gid = strtoul(buf + 1, &end, 10);
+        if(end == buf + 1 || *end != ' ') return NULL;
+        start = end + 1;
+    }
+    if(gid >= capbygid) return NULL;
 
-            char *uend = strchr(p, ' ');
-            if(!uend) continue;
+    Group *g = bygid[gid];
+    if(!g || g->dead) return NULL;
 
-            char *text = uend + 1;
-            if(!*text) continue;
+    *payload = start;
+    *plen = n - (size_t)(start - buf);
+    return g;
+}
 
-            pthread_mutex_lock(&mtx);
+/* Ouvre le socket commun du mode mono-port (INADDR_ANY:port) */
+static int mux_open(uint16_t port){
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0) return -1;
 
-            // Si banni, on refuse et on ne l’ajoute pas à members[]
-            if(ban_is_banned_nolock(user)){
-                pthread_mutex_unlock(&mtx);
-                send_txt(s, "SYS Vous etes banni de ce groupe.", &cli);
-                continue;
+    int yes = 1, rcvbuf = MUX_RCVBUF;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if(bind(fd, (struct sockaddr*)&addr, sizeof addr) < 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+    GroupeISY --worker <ctrl_fd> [MAX_MEMBERS] [MAX_BANS] [MUX_PORT] [HISTORY_LEN]
+                       [LOG_DIR] [LOG_SEGMENT_MB] [SERVER_PORT] [SERVER_IP]
+      - ctrl_fd : socket UDP 127.0.0.1 créé par le serveur et hérité à l'exec
+      - SERVER_PORT/SERVER_IP : seule source acceptée sur ctrl_fd (ADDGROUP),
+        destination des GONE/GSTAT/READY ; absents = aucun ADDGROUP accepté
+      - MUX_PORT : port commun du mode mono-port (absent ou 0 = désactivé)
+      - une seule boucle epoll, un seul snapshot de travail (mono-thread : les
+        mutex des groupes ne sont jamais contendus)
+*/
+static int worker_main(int argc, char **argv){
+    if(argc < 3){
+        fprintf(stderr, "Usage: %s --worker <ctrl_fd> [MAX_MEMBERS] [MAX_BANS] [MUX_PORT] [HISTORY_LEN] [LOG_DIR] [LOG_SEGMENT_MB] [SERVER_PORT] [SERVER_IP]\n", argv[0]);
+        return 1;
+    }
+
+    int cfd = atoi(argv[2]);
+    if(argc >= 4){
+        max_members = (unsigned)atoi(argv[3]);
+        if(max_members == 0 || max_members > MAX_TABLE_LIMIT) max_members = MAX_MEMBERS_DEFAULT;
+    }
+    if(argc >= 5){
+        max_bans = (unsigned)atoi(argv[4]);
+        if(max_bans == 0 || max_bans > MAX_TABLE_LIMIT) max_bans = MAX_BANS_DEFAULT;
+    }
+    if(argc >= 6){
+        mux_port = (uint16_t)atoi(argv[5]);
+    }
+    if(argc >= 7){
+        history_len = (unsigned)atoi(argv[6]);
+        if(history_len > HISTORY_LEN_MAX) history_len = HISTORY_LEN_MAX;
+    }
+    if(argc >= 8) glog_args(argv[7], argc >= 9 ? argv[8] : NULL);
+
+    // Adresse du serveur : seule source de contrôle acceptée, destination des GONE
+    struct sockaddr_in srv;
+    memset(&srv, 0, sizeof srv);
+    srv.sin_family = AF_INET;
+    if(argc >= 11){
+        srv.sin_port = htons((uint16_t)atoi(argv[9]));
+        if(inet_pton(AF_INET, argv[10], &srv.sin_addr) != 1) srv.sin_port = 0;
+    }
+    if(srv.sin_port == 0)
+        fprintf(stderr, "[GroupeISY] worker : adresse du serveur absente, aucun ADDGROUP accepté\n");
+
+    int sfd = sigfd_open();
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if(ep < 0) die_perror("epoll_create1");
+
+    // Alarme : échéance la plus proche parmi tous les groupes hébergés
+    Alarm al;
+    alarm_open(&al);
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &worker_tag_ctrl;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, cfd, &ev) < 0) die_perror("epoll_ctl ctrl");
+    ev.data.ptr = &worker_tag_alarm;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, al.fd, &ev) < 0) die_perror("epoll_ctl timer");
+    ev.data.ptr = &worker_tag_sig;
+    if(epoll_ctl(ep, EPOLL_CTL_ADD, sfd, &ev) < 0) die_perror("epoll_ctl signal");
+
+    if(mux_port){
+        mux_fd = mux_open(mux_port);
+        if(mux_fd < 0) die_perror("bind mux");
+        ev.data.ptr = &worker_tag_mux;
+        if(epoll_ctl(ep, EPOLL_CTL_ADD, mux_fd, &ev) < 0) die_perror("epoll_ctl mux");
+    }
+
+    fprintf(stderr, "[GroupeISY] worker pid %d (membres=%u, bans=%u, mono-port=%u)\n",
+            (int)getpid(), max_members, max_bans, (unsigned)mux_port);
+
+    DestSnap d;
+    snap_init(&d, max_members);
+
+    char buf[TXT_LEN + 256];
+    struct epoll_event evs[WORKER_MAX_EVENTS];
+
+    while(running){
+        int ne = epoll_wait(ep, evs, WORKER_MAX_EVENTS, -1);
+        if(ne < 0){
+            if(errno == EINTR) continue;
+            die_perror("epoll_wait");
+        }
+
+        int need_reap = 0;
+        int need_rearm = 0;
+
+        for(int i=0;i<ne;i++){
+            void *tag = evs[i].data.ptr;
+
+            if(tag == &worker_tag_sig){
+                running = 0;
+                break;
             }
 
-            // Ajoute/maj le membre
-            int idx = member_add_or_update_nolock(user, &cli);
-            if(idx < 0){
-                pthread_mutex_unlock(&mtx);
-                send_txt(s, "SYS Groupe plein.", &cli);
+            if(tag == &worker_tag_ctrl){
+                worker_ctrl(ep, cfd, &srv);
+                need_rearm = 1;   // nouveaux groupes : nouvelles échéances
                 continue;
             }
 
-            /*
-                Handshake join :
-                Quand un client envoie "(joined)", on lui renvoie les bannières actives
-                pour qu’elles soient affichées immédiatement après un rejoin.
-            */
-            if(!strcmp(text, "(joined)")){
-                if(admin_banner_active){
-                    char ctrl[TXT_LEN + 32];
-                    snprintf(ctrl, sizeof ctrl, "CTRL BANNER_SET %s", admin_banner);
-                    send_txt(s, ctrl, &members[idx].addr);
-                }
-                if(idle_banner_active){
-                    char ctrl[TXT_LEN + 32];
-                    snprintf(ctrl, sizeof ctrl, "CTRL IBANNER_SET %s", idle_banner);
-                    send_txt(s, ctrl, &members[idx].addr);
+            if(tag == &worker_tag_alarm){
+                time_t now = alarm_fired(&al);
+                for(unsigned k=0;k<nwgroups;k++){
+                    group_idle_tick(wgroups[k], &d, now);
+                    if(wgroups[k]->dead) need_reap = 1;
                 }
+                need_rearm = 1;
+                continue;
             }
 
-            pthread_mutex_unlock(&mtx);
-
-            /*
-                Départ propre :
-                MSG user "(left)" => on retire le membre de la table.
-                Important : on le fait après avoir relâché/reloké pour garder une logique simple.
-            */
-            if(!strcmp(text, "(left)")){
-                pthread_mutex_lock(&mtx);
-                member_remove_nolock(user);
-                pthread_mutex_unlock(&mtx);
+            // Port commun : chaque datagramme est routé par son gid
+            if(tag == &worker_tag_mux){
+                for(int k=0;k<WORKER_RECV_BURST;k++){
+                    struct sockaddr_in cli;
+                    socklen_t cl = sizeof cli;
+
+                    ssize_t n = recvfrom(mux_fd, buf, sizeof buf - 1, MSG_DONTWAIT,
+                                         (struct sockaddr*)&cli, &cl);
+                    if(n < 0) break;
+                    buf[n] = '\0';
+
+                    char *payload;
+                    size_t plen;
+                    Group *g = mux_route(buf, (size_t)n, &payload, &plen);
+                    if(!g){
+                        send_txt(mux_fd, "ERR unknown_group", &cli);
+                        continue;
+                    }
+                    group_handle(g, &d, payload, plen, &cli);
+                    group_stat(g);
+                    alarm_lower(&al, g->stop_at);
+                }
+                continue;
             }
 
-            // Prépare la ligne à diffuser à tous
-            char line[TXT_LEN + 96];
-            snprintf(line, sizeof line, "Message de %s : %s", user, text);
+            // Datagrammes d'un groupe : lot borné, pour ne pas affamer les autres
+            Group *g = (Group*)tag;
+            if(g->dead) continue;
 
-            pthread_mutex_lock(&mtx);
-            broadcast_group_line_nolock(s, line);
-            pthread_mutex_unlock(&mtx);
+            for(int k=0;k<WORKER_RECV_BURST;k++){
+                struct sockaddr_in cli;
+                socklen_t cl = sizeof cli;
 
-            continue;
-        }
+                ssize_t n = recvfrom(g->sock, buf, sizeof buf - 1, MSG_DONTWAIT,
+                                     (struct sockaddr*)&cli, &cl);
+                if(n < 0) break;
+                buf[n] = '\0';
 
-        /* ───────────────────────── SYS ... (serveur -> groupe -> clients) ───────────────────────── */
-        if(!strncmp(buf, "SYS ", 4)){
-            const char *text = buf + 4;
-            if(*text){
-                pthread_mutex_lock(&mtx);
+                group_handle(g, &d, buf, (size_t)n, &cli);
+            }
+            group_stat(g);
+            alarm_lower(&al, g->stop_at);
+        }
 
-                char line[TXT_LEN + 96];
-                snprintf(line, sizeof line, "Message de [SERVER] : %s", text);
-                broadcast_group_line_nolock(s, line);
+        if(need_reap) worker_reap(ep, cfd, &srv);
 
-                pthread_mutex_unlock(&mtx);
+        // Réarmement exact : échéance la plus proche des groupes restants
+        if(need_rearm){
+            time_t at = 0;
+            for(unsigned k=0;k<nwgroups;k++){
+                time_t t = group_deadline(wgroups[k]);
+                if(t && (!at || t < at)) at = t;
             }
+            alarm_arm(&al, at);
+        }
+    }
+
+    // Arrêt du worker (le serveur s'arrête) : fermeture de tous les groupes
+    for(unsigned i=0;i<nwgroups;i++){
+        group_close(wgroups[i]);
+        free(wgroups[i]);
+    }
+    free(wgroups);
+    free(bygid);
+    glog_stop();
+    if(mux_fd >= 0) close(mux_fd);
+    snap_free(&d);
+    close(al.fd);
+    close(sfd);
+    close(ep);
+    close(cfd);
+    return 0;
+}
+#endif /* __linux__ */
+
+/*
+    Mode classique : un groupe, son port UDP, jusqu'à inactivité ou signal.
+    stat_port / stat_ip : serveur à qui annoncer les GSTAT (0 = aucun).
+*/
+static int group_run(const char *gname, uint16_t gport, unsigned idle_sec,
+                     int stat_port, const char *stat_ip){
+    // Etat du groupe + socket UDP lié sur son port
+    static Group grp;
+    Group *g = &grp;
+    if(group_open(g, gname, gport, idle_sec, -1, -1) < 0)
+        die_perror("bind group");
+
+    // Serveur à qui annoncer le nombre de membres (GSTAT), depuis le port du groupe
+    if(stat_port > 0){
+        g->stat_to.sin_family = AF_INET;
+        g->stat_to.sin_port   = htons((uint16_t)stat_port);
+        if(inet_pton(AF_INET, stat_ip, &g->stat_to.sin_addr) == 1)
+            g->stat_fd = g->sock;
+    }
+    group_ready(g);
+
+#ifdef __linux__
+    /*
+        Boucle epoll mono-thread : s'arrête sur signal, inactivité (dead) ou arrêt
+        différé (stop_at). Aucun autre thread : l'état peut être libéré à la sortie.
+    */
+    group_loop(g);
+    group_close(g);
+    glog_stop();
+#else
+    // Gestion des signaux
+    signal(SIGINT, on_sigint);
+    signal(SIGTERM, on_sigint);
+
+    // Timeout pour permettre de quitter proprement
+    set_rcv_timeout(g->sock, 300);
+
+    // Démarre le thread timer d’inactivité (détaché)
+    pthread_t th_timer;
+    if(pthread_create(&th_timer, NULL, idle_timer_thread, g) == 0){
+        pthread_detach(th_timer);
+    }
+
+    // Buffer réception (messages + commandes)
+    char buf[TXT_LEN + 256];
+
+    // Snapshot des destinations (réutilisé par chaque datagramme)
+    DestSnap d;
+    snap_init(&d, g->max_members);
+
+    /*
+        Boucle principale :
+          - reçoit un datagramme UDP
+          - le confie à group_handle()
+          - s'arrête sur signal, inactivité (dead) ou arrêt différé (stop_at)
+    */
+    while(running && !g->dead){
+        if(g->stop_at && time(NULL) >= g->stop_at) break;
+
+        struct sockaddr_in cli;
+        socklen_t cl = sizeof cli;
+
+        ssize_t n = recvfrom(g->sock, buf, sizeof buf - 1, 0, (struct sockaddr*)&cli, &cl);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN || errno == EWOULDBLOCK) continue;
             continue;
         }
+        buf[n] = '\0';
 
-        // Sinon : paquet inconnu -> ignoré (silencieux)
+        group_handle(g, &d, buf, (size_t)n, &cli);
+        group_stat(g);
     }
 
-    // Fermeture socket + log
-    close(s);
-    fprintf(stderr, "[GroupeISY] '%s' stopped.\n", gname_local);
+    // Fermeture socket + log. L'état n'est pas libéré : le thread timer détaché
+    // peut encore être dans son tick, la fin du processus s'en charge.
+    g->dead = 1;
+    close(g->sock);
+    snap_free(&d);
+    group_report(g);
+    group_log_close(g);
+    glog_stop();
+#endif
     return 0;
 }
+
+/*
+    Réserve (GroupeISY --pool <ctrl_fd> [MAX_MEMBERS] [MAX_BANS] [SERVER_PORT] [SERVER_IP]
+    [HISTORY_LEN] [LOG_DIR] [LOG_SEGMENT_MB] [SERVER_PID], lancé d'avance par ServeurISY si
+    GROUP_POOL > 0) : le processus est prêt (exec, bibliothèques, configuration) et attend
+    sur le socket de contrôle hérité "CTRL ASSIGN <nom> <port> <idle>" ; il devient alors
+    un groupe classique. Sous Linux, une réserve meurt avec le serveur (PR_SET_PDEATHSIG) ;
+    un groupe attribué, lui, lui survit (redémarrage à chaud). Lancée par un intermédiaire
+    qui sort aussitôt, elle attend d'être rattachée au serveur SERVER_PID avant de lier
+    son sort au sien.
+*/
+static int pool_main(int argc, char **argv){
+    if(argc < 3){
+        fprintf(stderr, "Usage: %s --pool <ctrl_fd> [MAX_MEMBERS] [MAX_BANS] [SERVER_PORT] [SERVER_IP] [HISTORY_LEN] [LOG_DIR] [LOG_SEGMENT_MB] [SERVER_PID]\n", argv[0]);
+        return 1;
+    }
+
+    int cfd = atoi(argv[2]);
+    if(argc >= 4){
+        max_members = (unsigned)atoi(argv[3]);
+        if(max_members == 0 || max_members > MAX_TABLE_LIMIT) max_members = MAX_MEMBERS_DEFAULT;
+    }
+    if(argc >= 5){
+        max_bans = (unsigned)atoi(argv[4]);
+        if(max_bans == 0 || max_bans > MAX_TABLE_LIMIT) max_bans = MAX_BANS_DEFAULT;
+    }
+    int stat_port = argc >= 6 ? atoi(argv[5]) : 0;
+    const char *stat_ip = argc >= 7 ? argv[6] : "127.0.0.1";
+    if(argc >= 8){
+        history_len = (unsigned)atoi(argv[7]);
+        if(history_len > HISTORY_LEN_MAX) history_len = HISTORY_LEN_MAX;
+    }
+    if(argc >= 9) glog_args(argv[8], argc >= 10 ? argv[9] : NULL);
+
+#ifdef __linux__
+    pid_t pp = argc >= 11 ? (pid_t)atoi(argv[10]) : getppid();
+    for(int i=0;i<1000 && getppid() != pp;i++){
+        if(kill(pp, 0) < 0) return 0;   // serveur déjà parti
+        usleep(1000);
+    }
+    (void)prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if(getppid() != pp) return 0;   // serveur parti, ou jamais rattaché
+#endif
+
+    // Seul le serveur (son port de contrôle) peut attribuer un groupe
+    struct sockaddr_in srv;
+    memset(&srv, 0, sizeof srv);
+    srv.sin_port = htons((uint16_t)stat_port);
+    (void)inet_pton(AF_INET, stat_ip, &srv.sin_addr);
+
+    char buf[256], gname[GNAME_LEN];
+    unsigned gport = 0, idle_sec = 0;
+    const size_t plen = strlen(ISY_CTRL_ASSIGN " ");
+    for(;;){
+        struct sockaddr_in from;
+        socklen_t fl = sizeof from;
+        ssize_t n = recvfrom(cfd, buf, sizeof buf - 1, 0, (struct sockaddr*)&from, &fl);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            return 1;
+        }
+        buf[n] = '\0';
+
+        if(from.sin_port != srv.sin_port || from.sin_addr.s_addr != srv.sin_addr.s_addr) continue;
+        if(strncmp(buf, ISY_CTRL_ASSIGN " ", plen) != 0) continue;
+        if(sscanf(buf + plen, "%31s %u %u", gname, &gport, &idle_sec) == 3 && gport && gport <= 65535) break;
+    }
+    close(cfd);
+
+#ifdef __linux__
+    (void)prctl(PR_SET_PDEATHSIG, 0);
+#endif
+    return group_run(gname, (uint16_t)gport, idle_sec, stat_port, stat_ip);
+}
+
+/* ───────────────────────── Main ───────────────────────── */
+int main(int argc, char **argv){
+    if(argc >= 2 && !strcmp(argv[1], "--worker")){
+#ifdef __linux__
+        return worker_main(argc, argv);
+#else
+        fprintf(stderr, "%s: mode --worker disponible uniquement sous Linux (epoll)\n", argv[0]);
+        return 1;
+#endif
+    }
+    if(argc >= 2 && !strcmp(argv[1], "--pool"))
+        return pool_main(argc, argv);
+    if(argc >= 2 && !strcmp(argv[1], "--bench-log"))
+        return bench_log(argc >= 3 ? strtoul(argv[2], NULL, 10) : 1000000ul, argc >= 4 ? argv[3] : "/tmp");
+
+    if(argc < 3){
+        fprintf(stderr, "Usage: %s <groupName> <port> [IDLE_TIMEOUT_SEC] [MAX_MEMBERS] [MAX_BANS] [SERVER_PORT] [SERVER_IP] [HISTORY_LEN] [LOG_DIR] [LOG_SEGMENT_MB]\n", argv[0]);
+        fprintf(stderr, "       %s --worker <ctrl_fd> [MAX_MEMBERS] [MAX_BANS] [MUX_PORT] [HISTORY_LEN] [LOG_DIR] [LOG_SEGMENT_MB] [SERVER_PORT] [SERVER_IP]\n", argv[0]);
+        fprintf(stderr, "       %s --pool <ctrl_fd> [MAX_MEMBERS] [MAX_BANS] [SERVER_PORT] [SERVER_IP] [HISTORY_LEN] [LOG_DIR] [LOG_SEGMENT_MB] [SERVER_PID]\n", argv[0]);
+        fprintf(stderr, "       %s --bench-log [messages] [dir]\n", argv[0]);
+        return 1;
+    }
+
+    // Arguments : nom groupe, port UDP du groupe, timeout optionnel
+    const char *gname = argv[1];
+    uint16_t gport = (uint16_t)atoi(argv[2]);
+    unsigned idle_sec = 1800; // défaut si argv[3] absent
+    if(argc >= 4){
+        idle_sec = (unsigned)atoi(argv[3]);
+    }
+    if(argc >= 5){
+        max_members = (unsigned)atoi(argv[4]);
+        if(max_members == 0 || max_members > MAX_TABLE_LIMIT) max_members = MAX_MEMBERS_DEFAULT;
+    }
+    if(argc >= 6){
+        max_bans = (unsigned)atoi(argv[5]);
+        if(max_bans == 0 || max_bans > MAX_TABLE_LIMIT) max_bans = MAX_BANS_DEFAULT;
+    }
+    if(argc >= 9){
+        history_len = (unsigned)atoi(argv[8]);
+        if(history_len > HISTORY_LEN_MAX) history_len = HISTORY_LEN_MAX;
+    }
+    if(argc >= 10) glog_args(argv[9], argc >= 11 ? argv[10] : NULL);
+
+    return group_run(gname, gport, idle_sec,
+                     argc >= 7 ? atoi(argv[6]) : 0, argc >= 8 ? argv[7] : "127.0.0.1");
+}
@@ -4,6 +4,16 @@
 #include <signal.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#endif
 
 /*
     ─────────────────────────────────────────────────────────────────────────
@@ -14,43 +24,121 @@
           * LIST   : lister les groupes existants
           * CREATE : créer un groupe (lance un processus GroupeISY)
           * JOIN   : récupérer le port d’un groupe existant
+          * LOOKUP : résoudre un nom de groupe (port + epoch de l'annuaire)
           * MERGE  : fusionner deux groupes (rediriger les clients de B vers A)
       - Peut diffuser une bannière "serveur" ou des messages SYS à tous les groupes.
 
     Architecture :
       - Un socket UDP "contrôle" (sock_ctrl) sur SERVER_IP:SERVER_PORT
-      - Un tableau de groupes en mémoire (groups[])
+      - Un tableau de groupes en mémoire (groups[]), indexé par nom (table de hachage)
       - Chaque groupe est un processus enfant (fork + execl ./GroupeISY)
+        ou, si GROUP_WORKERS > 0, un groupe hébergé par l'un des N workers
+        (GroupeISY --worker, boucle epoll multi-groupes) lancés au démarrage
+      - Réserve (GROUP_POOL > 0, mode un processus par groupe) : des GroupeISY --pool
+        sont lancés d'avance ; un CREATE attribue le groupe à l'un d'eux
+        ("CTRL ASSIGN") au lieu de fork + exec ; sous Linux, un lanceur auxiliaire
+        complète la réserve sans que la boucle du serveur forke (voir "Réserve").
+      - Mode mono-port (GROUP_MUX_PORT > 0) : un seul worker écoute un port commun
+        à tous les groupes ; un groupe y est désigné par son gid (= index de slot),
+        préfixé "@<gid> " à chaque datagramme (voir Commun.h).
+      - Requêtes clients en lignes texte ou en trames binaires v1 (Commun.h) ;
+        chaque réponse part dans le format de la requête (dispatch_text / dispatch_bin).
       - Canal admin serveur -> groupe :
           * Chaque GroupeISY écoute sur son port UDP (port du groupe)
           * Le serveur lui envoie des commandes "CTRL ..." vers 127.0.0.1:<port>
             (car groupe et serveur tournent sur la même machine).
 
-    Signaux :
+    Boucle d'événements (Linux) : un seul thread, epoll sur sock_ctrl, un signalfd
+    (SIGINT/SIGTERM/SIGCHLD), un pidfd par processus enfant (GroupeISY ou worker) et
+    stdin (console admin). La mort d'un enfant est traitée dans la boucle, au moment
+    où elle survient : plus de handler SIGCHLD qui modifie groups[] en parallèle.
+    Sans pidfd_open (noyau < 5.3), l'enfant est récupéré sur SIGCHLD (signalfd).
+
+    Redémarrage à chaud (STATE_FILE) : la table des groupes et des workers est
+    recopiée dans un fichier mappé à chaque changement. SIGTERM ou /detach arrêtent
+    le serveur sans toucher aux groupes ; au démarrage suivant, le serveur relit le
+    fichier et ré-adopte les processus encore vivants (voir "Etat persistant").
+
+    Mise à jour sans coupure (/upgrade) : le serveur exécute le nouveau binaire dans
+    son propre processus (même pid, même terminal) ; un relais forké lui repasse
+    sock_ctrl (SCM_RIGHTS) et la table sur une socket Unix. Les requêtes attendent
+    dans le tampon de sock_ctrl pendant la passation (voir "Passation").
+
+    Ailleurs (macOS) : boucle recvfrom() avec SO_RCVTIMEO, thread console et
+    handlers de signaux :
       - SIGINT/SIGTERM : stoppe la boucle principale proprement
       - SIGCHLD : récupère la mort des enfants (GroupeISY) et nettoie l’état.
 */
 
 #define MAX_GROUPS_DEFAULT 32   // taille max par défaut si non spécifié
 #define NAME_LEN 32             // longueur max du nom de groupe côté serveur
+#define MAX_WORKERS 64          // borne de GROUP_WORKERS
+#define MAX_POOL 64             // borne de GROUP_POOL
+#define MAX_GROUPS_PORTS 256    // borne de MAX_GROUPS en mode un port par groupe
+#define MAX_GROUPS_MUX 65536    // borne de MAX_GROUPS en mode mono-port
 
 /*
     Enregistrement d’un groupe côté serveur.
     - used : indique si l’entrée est occupée
     - name / port : identité du groupe
-    - pid : PID du processus GroupeISY lancé
+    - pid : PID du processus GroupeISY lancé (ou du worker qui héberge le groupe)
+    - worker : index du worker hôte, -1 en mode un processus par groupe
+    - gid : identifiant mono-port du groupe, -1 si le groupe a son propre port
     - addr : adresse admin (127.0.0.1:port) pour envoyer des CTRL au groupe
     - admin_token : token de gestionnaire (admin) attribué à la création
+    - pidfd : pidfd du processus GroupeISY dédié (Linux), -1 sinon
+    - members : nombre de membres annoncé par le groupe (GSTAT)
+    - start : date de démarrage du processus (/proc, Linux), pour reconnaître un pid ré-adopté
+    - adopted : processus repris d'un serveur précédent (pas notre enfant : pas de waitpid)
+    - ready : socket du groupe lié ("READY" reçu) ; avant, CREATE/JOIN attendent (pend[])
+    - gen : incrémenté à chaque libération du slot (réponses en attente périmées)
 */
 typedef struct {
     int used;
     char name[NAME_LEN];
     uint16_t port;
+    unsigned members;
     pid_t pid;
+    int pidfd;
+    int worker;
+    int gid;
     struct sockaddr_in addr;            // 127.0.0.1:port (canal admin vers GroupeISY local)
     char admin_token[ADMIN_TOKEN_LEN];  // token admin (gestionnaire) du groupe
+    uint64_t start;
+    int adopted;
+    int ready;
+    unsigned gen;
 } GroupRec;
 
+/*
+    Worker GroupeISY (mode GROUP_WORKERS > 0) :
+    - pid : PID du worker (-1 => mort, plus de CREATE vers lui)
+    - addr : 127.0.0.1:<port de son socket de contrôle> (ADDGROUP, source des GONE)
+    - ngroups : nombre de groupes hébergés (choix du worker le moins chargé)
+    - pidfd : pidfd du worker (Linux), -1 sinon
+    - start / adopted : comme pour GroupRec
+*/
+typedef struct {
+    pid_t pid;
+    int pidfd;
+    struct sockaddr_in addr;
+    unsigned ngroups;
+    uint64_t start;
+    int adopted;
+} WorkerRec;
+
+/*
+    Processus de réserve (GROUP_POOL > 0) : GroupeISY --pool prêt, en attente d'un
+    "CTRL ASSIGN" sur son socket de contrôle (addr). pid <= 0 => place à remplir.
+*/
+typedef struct {
+    pid_t pid;
+    int pidfd;
+    uint64_t start;
+    struct sockaddr_in addr;
+    unsigned long seq;        // ordre d'arrivée : le plus ancien (démarrage terminé) sert d'abord
+} PoolRec;
+
 /* ───────────────────────── Configuration serveur ───────────────────────── */
 /*
     Champs paramétrables via server.conf :
@@ -59,6 +147,13 @@ typedef struct {
       - BASE_PORT (premier port attribué aux groupes)
       - MAX_GROUPS
       - IDLE_TIMEOUT_SEC (timeout d’inactivité injecté à GroupeISY)
+      - MAX_MEMBERS / MAX_BANS (tailles des tables membres/bans de chaque GroupeISY)
+      - GROUP_WORKERS (0 = un processus par groupe, N = N workers multi-groupes)
+      - GROUP_MUX_PORT (0 = un port par groupe, P = tous les groupes sur le port P)
+      - GROUP_POOL (GroupeISY lancés d'avance pour les CREATE ; 0 = fork + exec à chaque CREATE)
+      - HISTORY_LEN (messages rejoués à l'arrivée dans un groupe ; /history par groupe)
+      - STATE_FILE (table des groupes persistante, redémarrage à chaud ; vide = aucun)
+      - GROUP_LOG_DIR / GROUP_LOG_SEGMENT_MB (journal append-only par groupe ; vide = aucun)
 */
 typedef struct {
     char bind_ip[64];         // "0.0.0.0" pour Internet
@@ -66,6 +161,15 @@ typedef struct {
     uint16_t base_port;       // premier port de groupe (UDP)
     unsigned max_groups;      // nombre max de groupes
     unsigned idle_timeout;    // IDLE_TIMEOUT_SEC injecté à GroupeISY
+    unsigned max_members;     // MAX_MEMBERS injecté à GroupeISY
+    unsigned max_bans;        // MAX_BANS injecté à GroupeISY
+    unsigned group_workers;   // GROUP_WORKERS : 0 = fork par groupe
+    uint16_t mux_port;        // GROUP_MUX_PORT : 0 = un port par groupe
+    unsigned pool;            // GROUP_POOL : processus GroupeISY de réserve
+    unsigned history_len;     // HISTORY_LEN injecté à GroupeISY
+    char log_dir[128];        // GROUP_LOG_DIR injecté à GroupeISY ("" = pas de journal)
+    unsigned log_segment_mb;  // GROUP_LOG_SEGMENT_MB injecté à GroupeISY (0 = défaut)
+    char state_file[128];     // STATE_FILE ("" = pas de redémarrage à chaud)
 } ServerConf;
 
 /*
@@ -84,6 +188,9 @@ static int load_server_conf(const char *path, ServerConf *c){
     c->base_port    = 8010;
     c->max_groups   = MAX_GROUPS_DEFAULT;
     c->idle_timeout = 1800; // valeur par défaut si absent du .conf
+    c->max_members  = 64;
+    c->max_bans     = 128;
+    c->history_len  = 20;
 
     FILE *f=fopen(path,"r");
     if(!f) return -1;
@@ -109,12 +216,39 @@ static int load_server_conf(const char *path, ServerConf *c){
                 c->max_groups  = (unsigned)atoi(v);
             else if(!strcmp(k,"IDLE_TIMEOUT_SEC"))
                 c->idle_timeout = (unsigned)atoi(v);
+            else if(!strcmp(k,"MAX_MEMBERS"))
+                c->max_members = (unsigned)atoi(v);
+            else if(!strcmp(k,"MAX_BANS"))
+                c->max_bans = (unsigned)atoi(v);
+            else if(!strcmp(k,"GROUP_WORKERS"))
+                c->group_workers = (unsigned)atoi(v);
+            else if(!strcmp(k,"GROUP_MUX_PORT"))
+                c->mux_port = (uint16_t)atoi(v);
+            else if(!strcmp(k,"GROUP_POOL"))
+                c->pool = (unsigned)atoi(v);
+            else if(!strcmp(k,"HISTORY_LEN"))
+                c->history_len = (unsigned)atoi(v);
+            else if(!strcmp(k,"GROUP_LOG_DIR"))
+                isy_strcpy(c->log_dir, sizeof c->log_dir, v);
+            else if(!strcmp(k,"GROUP_LOG_SEGMENT_MB"))
+                c->log_segment_mb = (unsigned)atoi(v);
+            else if(!strcmp(k,"STATE_FILE"))
+                isy_strcpy(c->state_file, sizeof c->state_file, v);
         }
     }
     fclose(f);
 
-    // Sécurisation : on borne la valeur max_groups
-    if(c->max_groups==0 || c->max_groups>256) c->max_groups = MAX_GROUPS_DEFAULT;
+    // Sécurisation : on borne la valeur max_groups (la plage de ports ne limite plus en mono-port)
+    unsigned gcap = c->mux_port ? MAX_GROUPS_MUX : MAX_GROUPS_PORTS;
+    if(c->max_groups==0 || c->max_groups>gcap) c->max_groups = MAX_GROUPS_DEFAULT;
+    if(c->group_workers>MAX_WORKERS) c->group_workers = MAX_WORKERS;
+
+    // Mono-port : un seul processus peut lier le port commun => un seul worker
+    if(c->mux_port) c->group_workers = 1;
+
+    // Réserve : uniquement en mode un processus par groupe
+    if(c->pool>MAX_POOL) c->pool = MAX_POOL;
+    if(c->group_workers) c->pool = 0;
     return 0;
 }
 
@@ -122,20 +256,403 @@ static int load_server_conf(const char *path, ServerConf *c){
 /*
     running :
       - Flag modifié par SIGINT/SIGTERM pour quitter proprement la boucle principale.
+    detach :
+      - Arrêt sans les groupes (SIGTERM ou /detach avec STATE_FILE) : ils continuent
+        de tourner et seront ré-adoptés au prochain démarrage.
     groups :
       - Table des groupes (taille GMAX), allouée dynamiquement.
     sock_ctrl :
       - Socket UDP principal du serveur.
     th_in :
-      - Thread dédié à l’input admin (/banner, /sys, /list, /quit).
+      - Thread dédié à l’input admin (/banner, /sys, /list, /quit), hors Linux.
+    workers :
+      - Workers GroupeISY (NW entrées, 0 en mode un processus par groupe).
 */
 static volatile sig_atomic_t running = 1;
+static volatile sig_atomic_t detach = 0;
+static volatile sig_atomic_t upgrade_req = 0;   // /upgrade demandé (traité par la boucle principale)
+static char upgrade_bin[256];                   // binaire à lancer pour /upgrade
+static pid_t upgraded_to = 0;                   // relais : processus passé au nouveau binaire
+static pid_t drain_pid = 0;                     // nouveau binaire : relais de l'ancien serveur, à récupérer
+static char **srv_argv = NULL;
 static GroupRec *groups = NULL;
 static unsigned GMAX = 0;
 static int sock_ctrl = -1;
 static ServerConf gconf;
+#ifndef __linux__
 static pthread_t th_in;
+#endif
+static WorkerRec workers[MAX_WORKERS];
+static unsigned NW = 0;
+static PoolRec pool[MAX_POOL];
+static unsigned NP = 0;
+static time_t pool_hold = 0;       // pas de remplissage avant (réserve morte au repos)
+static unsigned long pool_seq = 0;  // numéro d'arrivée du dernier processus de réserve
+static struct sockaddr_in local_srv;   // adresse locale du serveur pour les groupes (GSTAT)
+
+/* ───────────────────────── Annuaire (LIST) ───────────────────────── */
+/*
+    Réponses LIST pré-sérialisées : une entrée par groupe, dans l'ordre des slots,
+    en texte "<nom> <port>[ <membres>]\n" ou en champs LISTR binaires. Un blob n'est
+    reconstruit qu'après invalidation (CREATE, fin d'un groupe ; GSTAT pour les
+    variantes avec membres) : une requête LIST se réduit au memcpy d'une page.
+    Le cursor d'une page est le slot de sa première entrée : il reste valable même
+    si l'annuaire change entre deux pages.
+*/
+#define DIR_ENTRY_MAX (2 + NAME_LEN + 16)   // plus longue entrée (texte ou binaire)
+
+typedef struct {
+    char     *buf;
+    uint32_t *off;      // off[k] = début de l'entrée k ; off[n] = fin du blob
+    uint32_t *slot;     // slot de l'entrée k (croissant)
+    unsigned  n;
+    int       valid;
+} DirBlob;
+
+static DirBlob dir[2][2];   // [binaire][avec membres]
+
+static void dir_invalidate(int members_only){
+    for(int b=0;b<2;b++){
+        dir[b][1].valid = 0;
+        if(!members_only) dir[b][0].valid = 0;
+    }
+}
+
+/* Blob à jour pour ce format (reconstruit si invalidé) ; NULL si mémoire insuffisante */
+static const DirBlob *dir_get(int bin, int members){
+    DirBlob *d = &dir[bin][members];
+    if(d->valid) return d;
+
+    size_t cap = (size_t)GMAX * DIR_ENTRY_MAX;
+    if(!d->buf){
+        d->buf  = (char*)malloc(cap);
+        d->off  = (uint32_t*)malloc((GMAX + 1) * sizeof *d->off);
+        d->slot = (uint32_t*)malloc(GMAX * sizeof *d->slot);
+        if(!d->buf || !d->off || !d->slot){
+            free(d->buf); free(d->off); free(d->slot);
+            d->buf = NULL; d->off = NULL; d->slot = NULL;
+            return NULL;
+        }
+    }
+
+    size_t len = 0;
+    unsigned n = 0;
+    for(unsigned i=0;i<GMAX;i++){
+        if(!groups[i].used) continue;
+        unsigned m = groups[i].members > 0xFFFF ? 0xFFFF : groups[i].members;
+
+        d->off[n] = (uint32_t)len;
+        d->slot[n] = i;
+        if(bin){
+            ISYWr w = { (uint8_t*)d->buf, cap, len, 0 };
+            isy_bin_cstr(&w, groups[i].name);
+            isy_bin_u16(&w, groups[i].port);
+            if(members) isy_bin_u16(&w, (uint16_t)m);
+            len = w.off;
+        }else if(members){
+            len += (size_t)snprintf(d->buf + len, cap - len, "%s %u %u\n",
+                                    groups[i].name, (unsigned)groups[i].port, m);
+        }else{
+            len += (size_t)snprintf(d->buf + len, cap - len, "%s %u\n",
+                                    groups[i].name, (unsigned)groups[i].port);
+        }
+        n++;
+    }
+    d->off[n] = (uint32_t)len;
+    d->n = n;
+    d->valid = 1;
+    return d;
+}
+
+/*
+    Page de l'annuaire qui commence au premier slot >= cursor : entrées [*k0, *k1),
+    au plus ISY_LIST_PAGE octets (au moins une entrée). Retourne le cursor de la
+    page suivante, 0 s'il n'y en a pas (une page suivante commence toujours après
+    le slot 0).
+*/
+static unsigned dir_page(const DirBlob *d, unsigned cursor, unsigned *k0, unsigned *k1){
+    unsigned lo = 0, hi = d->n;
+    while(lo < hi){
+        unsigned mid = (lo + hi) / 2;
+        if(d->slot[mid] < cursor) lo = mid + 1; else hi = mid;
+    }
+
+    unsigned k = lo;
+    if(k < d->n) k++;
+    while(k < d->n && d->off[k + 1] - d->off[lo] <= ISY_LIST_PAGE) k++;
+
+    *k0 = lo;
+    *k1 = k;
+    return k < d->n ? d->slot[k] : 0;
+}
+
+/* ───────────────────────── Etat persistant (STATE_FILE) ───────────────────────── */
+/*
+    Fichier d'état : en-tête, MAX_WORKERS entrées worker puis GMAX entrées groupe,
+    indexées comme workers[] / groups[] (le slot fixe le port et le gid). Mappé
+    MAP_SHARED : chaque changement est une simple recopie dans la page, que le
+    noyau garde même si le serveur meurt (pas de msync : les groupes ne survivent
+    pas non plus à un redémarrage de la machine). Format natif, même machine.
+    used est écrit en dernier à l'ajout et en premier au retrait.
+*/
+#define STATE_MAGIC "ISYSTAT1"
+
+typedef struct {
+    char     magic[8];
+    uint32_t gmax;
+    uint32_t nw;
+    uint16_t base_port;
+    uint16_t mux_port;
+    uint32_t saved_at;          // dernier arrêt détaché (epoch), 0 si le serveur tourne
+} StateHdr;
+
+typedef struct {
+    int32_t  pid;               // <= 0 : pas de worker
+    uint32_t pad;
+    uint64_t start;
+    struct sockaddr_in addr;
+} StateWorker;
+
+typedef struct {
+    volatile uint32_t used;
+    char     name[NAME_LEN];
+    uint16_t port;
+    int16_t  worker;
+    int32_t  gid;
+    int32_t  pid;
+    uint32_t members;
+    uint64_t start;
+    char     admin_token[ADMIN_TOKEN_LEN];
+} StateGroup;
+
+static StateHdr    *st_hdr = NULL;      // NULL => STATE_FILE désactivé
+static StateWorker *st_workers = NULL;
+static StateGroup  *st_groups = NULL;
+static size_t       st_size = 0;
+
+/* Recopie l'entrée groupe i dans s (fichier d'état ou image de passation) */
+static void state_rec(StateGroup *s, unsigned i){
+    const GroupRec *g = &groups[i];
+
+    if(!g->used){
+        __atomic_store_n(&s->used, 0, __ATOMIC_RELEASE);
+        return;
+    }
+    memcpy(s->name, g->name, NAME_LEN);
+    s->port = g->port;
+    s->worker = (int16_t)g->worker;
+    s->gid = g->gid;
+    s->pid = (int32_t)g->pid;
+    s->members = g->members;
+    s->start = g->start;
+    memcpy(s->admin_token, g->admin_token, ADMIN_TOKEN_LEN);
+    __atomic_store_n(&s->used, 1, __ATOMIC_RELEASE);
+}
+
+static void state_put(unsigned i){
+    if(st_hdr) state_rec(&st_groups[i], i);
+}
+
+/* Recopie l'entrée worker w dans le fichier d'état */
+static void state_put_worker(unsigned w){
+    if(!st_hdr) return;
+    st_workers[w].start = workers[w].start;
+    st_workers[w].addr = workers[w].addr;
+    st_workers[w].pid = (int32_t)workers[w].pid;
+}
+
+/* Taille d'une image d'état (fichier ou passation) pour la configuration courante */
+static size_t state_image_size(void){
+    return sizeof(StateHdr) + MAX_WORKERS * sizeof(StateWorker) + (size_t)GMAX * sizeof(StateGroup);
+}
+
+/* Ecrit l'image complète (en-tête + toutes les entrées) dans m, de taille state_image_size() */
+static void state_image(void *m){
+    StateHdr *h = (StateHdr*)m;
+    StateWorker *sw = (StateWorker*)(h + 1);
+    StateGroup  *sg = (StateGroup*)(sw + MAX_WORKERS);
+
+    memset(m, 0, state_image_size());
+    memcpy(h->magic, STATE_MAGIC, 8);
+    h->gmax = GMAX;
+    h->nw = NW;
+    h->base_port = gconf.base_port;
+    h->mux_port = gconf.mux_port;
+
+    for(unsigned w=0;w<NW;w++){
+        sw[w].pid = (int32_t)workers[w].pid;
+        sw[w].start = workers[w].start;
+        sw[w].addr = workers[w].addr;
+    }
+    for(unsigned i=0;i<GMAX;i++) state_rec(&sg[i], i);
+}
+
+/* L'image h a-t-elle été écrite par un serveur de même configuration ? */
+static int state_same_conf(const StateHdr *h){
+    return !memcmp(h->magic, STATE_MAGIC, 8) && h->gmax == GMAX && h->nw == NW &&
+           h->base_port == gconf.base_port && h->mux_port == gconf.mux_port;
+}
+
+/*
+    Date de démarrage du processus p (champ 22 de /proc/<p>/stat, en ticks) :
+    un pid réutilisé par un autre processus n'a pas la même. 0 si inconnue ou si
+    p est un zombie (mort, pas encore récupéré par son nouveau parent).
+*/
+static uint64_t proc_start(pid_t p){
+#ifdef __linux__
+    char fn[64], buf[512];
+    snprintf(fn, sizeof fn, "/proc/%d/stat", (int)p);
+    int fd = open(fn, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return 0;
+    ssize_t n = read(fd, buf, sizeof buf - 1);
+    close(fd);
+    if(n <= 0) return 0;
+    buf[n] = '\0';
+
+    // après "(comm)" : champ 3 (état) ... champ 22 (starttime)
+    char *q = strrchr(buf, ')');
+    if(!q || q[1] != ' ' || q[2] == 'Z') return 0;
+    q++;
+    for(int f=3; f<22 && q; f++) q = strchr(q + 1, ' ');
+    return q ? strtoull(q + 1, NULL, 10) : 0;
+#else
+    (void)p;
+    return 0;
+#endif
+}
+
+/* Le processus p est-il toujours celui qu'on a lancé (même date de démarrage) ? */
+static int proc_alive(pid_t p, uint64_t start){
+    if(p <= 0 || (kill(p, 0) < 0 && errno == ESRCH)) return 0;
+    return !start || proc_start(p) == start;
+}
+
+/* ───────────────────────── Index des noms ───────────────────────── */
+/*
+    Table de hachage nom -> slot de groups[] : adressage ouvert, sondage linéaire,
+    suppression par recompactage (pas de tombes). Taille = puissance de 2 >= 2*GMAX,
+    jamais pleine : find_group_by_name() en O(1) au lieu d'un parcours de groups[].
+*/
+typedef struct {
+    uint32_t h;
+    int idx;        // slot, -1 = cellule vide
+} NameCell;
+
+static NameCell *name_idx = NULL;
+static uint32_t  name_mask = 0;
+
+static uint32_t hash_name(const char *s){
+    uint32_t h = 2166136261u;
+    for(; *s; s++){
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int name_idx_init(void){
+    uint32_t sz = 16;
+    while(sz < 2u * GMAX) sz <<= 1;
+
+    name_idx = (NameCell*)malloc(sz * sizeof *name_idx);
+    if(!name_idx) return -1;
+    name_mask = sz - 1;
+    for(uint32_t i=0;i<sz;i++) name_idx[i].idx = -1;
+    return 0;
+}
+
+/* Position de la cellule du groupe name, ou -1 */
+static int name_idx_pos(const char *name){
+    uint32_t h = hash_name(name);
+    for(uint32_t i = h & name_mask; ; i = (i + 1) & name_mask){
+        const NameCell *c = &name_idx[i];
+        if(c->idx < 0) return -1;
+        if(c->h == h && !strcmp(groups[c->idx].name, name)) return (int)i;
+    }
+}
+
+/* Indexe le slot (nom déjà rempli, absent de l'index) */
+static void name_idx_insert(unsigned slot){
+    uint32_t h = hash_name(groups[slot].name);
+    uint32_t i = h & name_mask;
+    while(name_idx[i].idx >= 0) i = (i + 1) & name_mask;
+    name_idx[i].h = h;
+    name_idx[i].idx = (int)slot;
+}
+
+/* Retire le slot de l'index, en recompactant la chaîne de sondage qui suit */
+static void name_idx_erase(unsigned slot){
+    int pos = name_idx_pos(groups[slot].name);
+    if(pos < 0) return;
+
+    uint32_t i = (uint32_t)pos, j = (uint32_t)pos;
+    for(;;){
+        j = (j + 1) & name_mask;
+        if(name_idx[j].idx < 0) break;
+
+        uint32_t k = name_idx[j].h & name_mask;   // position idéale de l'entrée j
+        int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if(stays) continue;
+
+        name_idx[i] = name_idx[j];
+        i = j;
+    }
+    name_idx[i].idx = -1;
+}
+
+/* Libère le slot i (groupe terminé) : index des noms, annuaire, état */
+static void group_release(unsigned i){
+    fprintf(stderr, "[Serveur] Groupe '%s' (port %u) termine.\n",
+            groups[i].name, (unsigned)groups[i].port);
+
+    name_idx_erase(i);
+    dir_invalidate(0);
+    if(groups[i].pidfd >= 0) close(groups[i].pidfd);
+    groups[i].pidfd = -1;
+    groups[i].used = 0;
+    groups[i].pid = -1;
+    groups[i].worker = -1;
+    groups[i].adopted = 0;
+    groups[i].admin_token[0] = '\0';
+    groups[i].gen++;
+    state_put(i);
+}
+
+/* ───────────────────────── Fin des processus enfants ───────────────────────── */
+
+/*
+    Un enfant (GroupeISY ou worker) s'est terminé et a été récupéré (waitpid) :
+      - mort d'un worker : tous ses groupes disparaissent avec lui
+      - libère les slots correspondants et ferme les pidfd associés
+*/
+static void child_exited(pid_t p){
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid == p){
+            // Réserve morte sans groupe (binaire absent, tuée...) : remplissage différé
+            if(pool[k].pidfd >= 0) close(pool[k].pidfd);
+            pool[k].pidfd = -1;
+            pool[k].pid = -1;
+            pool_hold = time(NULL) + 1;
+            return;
+        }
+    }
+
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pid == p){
+            if(workers[w].pidfd >= 0) close(workers[w].pidfd);
+            workers[w].pidfd = -1;
+            workers[w].pid = -1;
+            workers[w].ngroups = 0;
+            state_put_worker(w);
+        }
+    }
+
+    for(unsigned i=0;i<GMAX;i++){
+        if(groups[i].used && groups[i].pid == p) group_release(i);
+    }
+}
 
+#ifndef __linux__
 /* ───────────────────────── Gestion des signaux ───────────────────────── */
 
 /*
@@ -144,7 +661,7 @@ static pthread_t th_in;
       - La boucle recvfrom() se réveille grâce à un timeout (SO_RCVTIMEO).
 */
 static void on_sigint(int s){
-    (void)s;
+    if(s == SIGTERM && gconf.state_file[0]) detach = 1;
     running = 0;
 }
 
@@ -159,31 +676,540 @@ static void on_sigchld(int s){
         int status;
         pid_t p = waitpid(-1, &status, WNOHANG);
         if(p<=0) break;
+        child_exited(p);
+    }
+}
+#endif
 
-        for(unsigned i=0;i<GMAX;i++){
-            if(groups[i].used && groups[i].pid == p){
-                fprintf(stderr, "[Serveur] Groupe '%s' (port %u) termine.\n",
-                        groups[i].name, (unsigned)groups[i].port);
-
-                // Libère le slot
-                groups[i].used = 0;
-                groups[i].pid = -1;
-                groups[i].admin_token[0] = '\0';
-            }
-        }
+#ifdef __linux__
+/* ───────────────────────── Boucle d'événements (Linux) ───────────────────────── */
+
+/* Sources epoll : data.u64 = (type << 32) | valeur (pid de l'enfant pour EV_CHILD) */
+enum { EV_CTRL = 1, EV_SIGNAL, EV_STDIN, EV_CHILD, EV_SPAWN };
+#define EV_TAG(t, v) (((uint64_t)(t) << 32) | (uint32_t)(v))
+
+static int ev_fd  = -1;     // epoll
+static int sig_fd = -1;     // signalfd (SIGINT, SIGTERM, SIGCHLD)
+static sigset_t sig_saved;  // masque d'origine, rétabli dans les enfants avant exec
+
+static int ev_add(int fd, uint64_t tag){
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN;
+    ev.data.u64 = tag;
+    return epoll_ctl(ev_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/*
+    (Re)crée le signalfd de SIGINT/SIGTERM/SIGCHLD dans epoll. Un signalfd hérité
+    par fork reste lié, pour epoll, au processus qui l'a créé : le relais d'un
+    /upgrade qui reprend le service doit avoir le sien.
+*/
+static int sig_watch(void){
+    if(sig_fd>=0){
+        epoll_ctl(ev_fd, EPOLL_CTL_DEL, sig_fd, NULL);
+        close(sig_fd);
     }
+
+    sigset_t ss;
+    sigemptyset(&ss);
+    sigaddset(&ss, SIGINT);
+    sigaddset(&ss, SIGTERM);
+    sigaddset(&ss, SIGCHLD);
+    sig_fd = signalfd(-1, &ss, SFD_NONBLOCK | SFD_CLOEXEC);
+    if(sig_fd<0) return -1;
+    return ev_add(sig_fd, EV_TAG(EV_SIGNAL, 0));
 }
 
-/* ───────────────────────── Helpers groupes ───────────────────────── */
+/*
+    Crée epoll + signalfd. Les signaux sont bloqués avant tout fork : un enfant qui
+    meurt avant d'être surveillé laisse au moins un SIGCHLD en attente sur le fd.
+*/
+static void ev_init(void){
+    ev_fd = epoll_create1(EPOLL_CLOEXEC);
+    if(ev_fd<0) die_perror("epoll_create1");
+
+    sigset_t ss;
+    sigemptyset(&ss);
+    sigaddset(&ss, SIGINT);
+    sigaddset(&ss, SIGTERM);
+    sigaddset(&ss, SIGCHLD);
+    if(sigprocmask(SIG_BLOCK, &ss, &sig_saved)<0) die_perror("sigprocmask");
+    // Après /upgrade, le masque hérité de l'ancien serveur bloque déjà ces signaux :
+    // les groupes doivent quand même recevoir SIGINT/SIGTERM
+    sigdelset(&sig_saved, SIGINT);
+    sigdelset(&sig_saved, SIGTERM);
+    sigdelset(&sig_saved, SIGCHLD);
+
+    if(sig_watch()<0) die_perror("signalfd");
+}
 
-/* Recherche l’index d’un groupe par nom. Retourne -1 si absent. */
-static int find_group_by_name(const char *name){
+/* Côté enfant, juste avant exec : GroupeISY retrouve un masque de signaux normal */
+static void child_prepare(void){
+    sigprocmask(SIG_SETMASK, &sig_saved, NULL);
+}
+
+/*
+    Surveille un enfant par son pidfd (lisible à sa mort). Retourne le pidfd, ou -1
+    (noyau sans pidfd_open) : l'enfant est alors récupéré sur SIGCHLD.
+*/
+static int child_watch(pid_t p){
+#ifdef SYS_pidfd_open
+    int fd = (int)syscall(SYS_pidfd_open, p, 0);
+    if(fd<0) return -1;
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if(ev_add(fd, EV_TAG(EV_CHILD, p))<0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    (void)p;
+    return -1;
+#endif
+}
+
+/*
+    pidfd lisible : l'enfant p est mort, on le récupère tout de suite. Un processus
+    ré-adopté n'est pas notre enfant (ECHILD) : son pidfd suffit à signaler sa fin.
+*/
+static void child_reap(pid_t p){
+    int st;
+    pid_t r = waitpid(p, &st, WNOHANG);
+    if(r == p || (r < 0 && errno == ECHILD)) child_exited(p);
+}
+
+/*
+    SIGCHLD : ne récupère que les enfants sans pidfd (les autres ont leur propre
+    événement). waitpid ciblé : jamais de double traitement d'un même enfant.
+*/
+static void child_reap_unwatched(void){
+    if(drain_pid>0){
+        int st;
+        if(waitpid(drain_pid, &st, WNOHANG) == drain_pid) drain_pid = 0;
+    }
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid>0 && pool[k].pidfd<0) child_reap(pool[k].pid);
+    }
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pid>0 && workers[w].pidfd<0 && !workers[w].adopted) child_reap(workers[w].pid);
+    }
+    for(unsigned i=0;i<GMAX;i++){
+        if(groups[i].used && groups[i].worker<0 && groups[i].pidfd<0 && !groups[i].adopted)
+            child_reap(groups[i].pid);
+    }
+}
+#else
+static void child_prepare(void){ }
+static int  child_watch(pid_t p){ (void)p; return -1; }
+#endif
+
+/* ───────────────────────── Redémarrage à chaud ───────────────────────── */
+
+static unsigned adopt_unwatched = 0;    // processus ré-adoptés sans pidfd
+
+/*
+    Processus ré-adoptés sans pidfd (noyau ancien, hors Linux) : ni SIGCHLD ni
+    pidfd ne signalent leur fin, on la constate par kill(pid, 0).
+*/
+static void adopt_poll(void){
+    if(!adopt_unwatched) return;
+
+    unsigned left = 0;
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pid<=0 || !workers[w].adopted || workers[w].pidfd>=0) continue;
+        if(proc_alive(workers[w].pid, workers[w].start)) left++;
+        else child_exited(workers[w].pid);
+    }
+    for(unsigned i=0;i<GMAX;i++){
+        if(!groups[i].used || !groups[i].adopted || groups[i].worker>=0 || groups[i].pidfd>=0) continue;
+        if(proc_alive(groups[i].pid, groups[i].start)) left++;
+        else child_exited(groups[i].pid);
+    }
+    adopt_unwatched = left;
+}
+
+/*
+    Fichier d'un serveur configuré autrement (MAX_GROUPS, ports, workers) : ses
+    processus encore vivants occuperaient les ports, on les arrête (SIGINT).
+*/
+static void state_stop_old(int fd, const StateHdr *oh, size_t size){
+    void *m = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if(m == MAP_FAILED) return;
+
+    const StateWorker *sw = (const StateWorker*)((const StateHdr*)m + 1);
+    const StateGroup  *sg = (const StateGroup*)(sw + MAX_WORKERS);
+    size_t ng = (size - sizeof(StateHdr) - MAX_WORKERS * sizeof(StateWorker)) / sizeof(StateGroup);
+    if(ng > oh->gmax) ng = oh->gmax;
+
+    for(unsigned w=0;w<oh->nw && w<MAX_WORKERS;w++){
+        if(proc_alive(sw[w].pid, sw[w].start)) kill(sw[w].pid, SIGINT);
+    }
+    for(size_t i=0;i<ng;i++){
+        if(sg[i].used && sg[i].worker < 0 && proc_alive(sg[i].pid, sg[i].start)) kill(sg[i].pid, SIGINT);
+    }
+    munmap(m, size);
+}
+
+/*
+    Ré-adopte les processus décrits par une image d'état de même configuration :
+      - workers vivants (même pid, même date de démarrage) : repris tels quels
+      - groupes vivants : slot, nom, port, gid et token repris, surveillés par pidfd
+    Retourne le nombre de groupes ré-adoptés.
+*/
+static int state_adopt(const StateHdr *h){
+    const StateWorker *sw = (const StateWorker*)(h + 1);
+    const StateGroup  *sg = (const StateGroup*)(sw + MAX_WORKERS);
+
+    for(unsigned w=0;w<NW;w++){
+        if(!proc_alive(sw[w].pid, sw[w].start)) continue;
+        workers[w].pid = sw[w].pid;
+        workers[w].start = sw[w].start;
+        workers[w].addr = sw[w].addr;
+        workers[w].adopted = 1;
+        workers[w].pidfd = child_watch(workers[w].pid);
+        if(workers[w].pidfd < 0) adopt_unwatched++;
+    }
+
+    int adopted = 0;
     for(unsigned i=0;i<GMAX;i++){
-        if(groups[i].used && !strcmp(groups[i].name, name)) return (int)i;
+        const StateGroup *e = &sg[i];
+        if(!e->used) continue;
+
+        int w = e->worker;
+        int alive = (w >= 0) ? (w < (int)NW && workers[w].pid == e->pid)
+                             : proc_alive(e->pid, e->start);
+        if(!alive) continue;
+
+        GroupRec *g = &groups[i];
+        g->used = 1;
+        memcpy(g->name, e->name, NAME_LEN);
+        g->name[NAME_LEN-1] = '\0';
+        g->port = e->port;
+        g->members = e->members;
+        g->pid = e->pid;
+        g->start = e->start;
+        g->worker = w;
+        g->gid = e->gid;
+        g->adopted = 1;
+        g->ready = 1;
+        memcpy(g->admin_token, e->admin_token, ADMIN_TOKEN_LEN);
+        g->admin_token[ADMIN_TOKEN_LEN-1] = '\0';
+        memset(&g->addr, 0, sizeof g->addr);
+        g->addr.sin_family = AF_INET;
+        g->addr.sin_port   = htons(g->port);
+        inet_pton(AF_INET, "127.0.0.1", &g->addr.sin_addr);
+
+        g->pidfd = -1;
+        if(w >= 0){
+            workers[w].ngroups++;
+        }else{
+            g->pidfd = child_watch(g->pid);
+            if(g->pidfd < 0) adopt_unwatched++;
+        }
+        name_idx_insert(i);
+        adopted++;
+    }
+    if(adopted) dir_invalidate(0);
+    return adopted;
+}
+
+/*
+    Ouvre (ou crée) STATE_FILE. adopt = 1 : ré-adopte ce qu'il décrit (state_adopt),
+    ou arrête les processus d'une autre configuration (state_stop_old). adopt = 0
+    (après une passation /upgrade) : la table est déjà en mémoire, le fichier est
+    simplement réécrit. Retourne le nombre de groupes ré-adoptés, -1 si le fichier
+    est inutilisable.
+*/
+static int state_open(const char *path, int adopt){
+    st_size = state_image_size();
+
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(fd < 0) return -1;
+
+    struct stat sb;
+    StateHdr oh;
+    int known = fstat(fd, &sb) == 0 && (size_t)sb.st_size >= st_size - (size_t)GMAX * sizeof(StateGroup) &&
+                pread(fd, &oh, sizeof oh, 0) == (ssize_t)sizeof oh && !memcmp(oh.magic, STATE_MAGIC, 8);
+    int same = known && (size_t)sb.st_size == st_size && state_same_conf(&oh);
+
+    if(adopt && known && !same){
+        fprintf(stderr, "[Serveur] %s : configuration différente, anciens groupes arrêtés.\n", path);
+        state_stop_old(fd, &oh, (size_t)sb.st_size);
+    }
+    if(!same && (ftruncate(fd, 0) < 0 || ftruncate(fd, (off_t)st_size) < 0)){
+        close(fd);
+        return -1;
+    }
+
+    void *m = mmap(NULL, st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(m == MAP_FAILED) return -1;
+
+    int adopted = (adopt && same) ? state_adopt((const StateHdr*)m) : 0;
+
+    // Le fichier décrit désormais ce serveur
+    state_image(m);
+    st_hdr = (StateHdr*)m;
+    st_workers = (StateWorker*)(st_hdr + 1);
+    st_groups = (StateGroup*)(st_workers + MAX_WORKERS);
+    return adopted;
+}
+
+/*
+    Fin du serveur : arrêt détaché => le fichier garde la table (date d'arrêt) ;
+    arrêt complet => les groupes sont arrêtés, le fichier est supprimé.
+*/
+static void state_close(const char *path){
+    if(!st_hdr) return;
+    if(detach) st_hdr->saved_at = (uint32_t)time(NULL);
+    munmap(st_hdr, st_size);
+    st_hdr = NULL;
+    if(!detach) unlink(path);
+}
+
+/* ───────────────────────── Passation (/upgrade) ───────────────────────── */
+/*
+    Ancien serveur (upgrade_run) :
+      1. cesse de lire sock_ctrl : les requêtes s'accumulent dans son tampon noyau ;
+         arrête la réserve (hors image d'état)
+      2. fork d'un relais, copie de l'ancien serveur ; le processus d'origine fait
+         exec <binaire> <conf> --handoff <fd> <pid relais> : le nouveau serveur garde
+         le pid, le terminal et le job du shell (/quit, Ctrl-C), et les groupes
+         restent ses enfants
+      3. le relais envoie l'en-tête d'image d'état avec sock_ctrl en SCM_RIGHTS,
+         puis l'image
+      4. il attend l'octet 'R' : succès => il répond les CREATE/JOIN en attente et
+         s'arrête sans toucher aux groupes ; échec (exit du nouveau binaire, timeout)
+         => il reprend le service, sans console (arrêt par SIGTERM/SIGINT)
+    exec impossible : le processus d'origine arrête le relais et continue de servir.
+    Nouveau serveur (handoff_recv) : reçoit sock_ctrl et la table, vérifie qu'elle
+    correspond à sa configuration, ré-adopte workers et groupes (pidfd), puis répond
+    'R' une fois sock_ctrl dans sa boucle. Aucune requête perdue : le socket est le
+    même, seul le lecteur change.
+*/
+#define HANDOFF_WAIT_MS 5000
+
+static int write_all(int fd, const void *buf, size_t n){
+    const char *p = (const char*)buf;
+    while(n){
+        ssize_t k = write(fd, p, n);
+        if(k < 0){
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        p += k;
+        n -= (size_t)k;
     }
+    return 0;
+}
+
+static int read_all(int fd, void *buf, size_t n){
+    char *p = (char*)buf;
+    while(n){
+        ssize_t k = read(fd, p, n);
+        if(k < 0 && errno == EINTR) continue;
+        if(k <= 0) return -1;
+        p += k;
+        n -= (size_t)k;
+    }
+    return 0;
+}
+
+/* Envoie l'en-tête h avec le descripteur fd (SCM_RIGHTS) */
+static int send_with_fd(int sock, const StateHdr *h, int fd){
+    union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } u;
+    memset(&u, 0, sizeof u);
+
+    struct iovec iov = { (void*)h, sizeof *h };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof u.buf;
+
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cm), &fd, sizeof fd);
+
+    ssize_t k;
+    do k = sendmsg(sock, &msg, 0); while(k < 0 && errno == EINTR);
+    if(k < 0) return -1;
+    return write_all(sock, (const char*)h + k, sizeof *h - (size_t)k);
+}
+
+/* Reçoit l'en-tête dans h et le descripteur qui l'accompagne (-1 si absent) */
+static int recv_with_fd(int sock, StateHdr *h, int *fd){
+    union { char buf[CMSG_SPACE(sizeof(int))]; struct cmsghdr align; } u;
+    struct iovec iov = { h, sizeof *h };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = u.buf;
+    msg.msg_controllen = sizeof u.buf;
+
+    *fd = -1;
+    ssize_t k;
+    do k = recvmsg(sock, &msg, 0); while(k < 0 && errno == EINTR);
+    if(k <= 0) return -1;
+
+    for(struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)){
+        if(cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+            memcpy(fd, CMSG_DATA(cm), sizeof *fd);
+    }
+    return read_all(sock, (char*)h + k, sizeof *h - (size_t)k);
+}
+
+static void pool_stop(void);
+
+/*
+    Passation vers le binaire bin (ancien serveur). Retourne 0 dans le relais quand
+    le nouveau serveur a pris la main (le relais doit s'arrêter sans les groupes),
+    -1 si le service continue ici (exec impossible, ou relais après un échec du
+    nouveau binaire). Le processus d'origine ne revient pas en cas de succès.
+*/
+static int upgrade_run(const char *bin){
+    int sp[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sp) < 0) return -1;
+    (void)fcntl(sp[0], F_SETFD, FD_CLOEXEC);
+
+    size_t n = state_image_size();
+    StateHdr *img = (StateHdr*)malloc(n);
+    if(!img){
+        close(sp[0]);
+        close(sp[1]);
+        return -1;
+    }
+
+    // Réserve : processus hors image d'état, le nouveau serveur ne les suivrait pas
+    pool_stop();
+    state_image(img);
+
+    fflush(NULL);
+    pid_t self = getpid();
+    pid_t p = fork();
+    if(p < 0){
+        free(img);
+        close(sp[0]);
+        close(sp[1]);
+        return -1;
+    }
+
+    if(p > 0){
+        // Processus d'origine : devient le nouveau serveur (même pid, même terminal)
+        char fstr[16], pstr[16];
+        snprintf(fstr, sizeof fstr, "%d", sp[1]);
+        snprintf(pstr, sizeof pstr, "%d", (int)p);
+        free(img);
+        close(sp[0]);
+        execl(bin, bin, srv_argv[1], "--handoff", fstr, pstr, (char*)NULL);
+
+        // exec impossible : le relais n'a encore rien servi, on l'arrête
+        fprintf(stderr, "[Serveur] exec %s: %s\n", bin, strerror(errno));
+        int st;
+        kill(p, SIGKILL);
+        waitpid(p, &st, 0);
+        close(sp[1]);
+        return -1;
+    }
+
+    // Relais : envoie sock_ctrl et l'image au nouveau binaire, attend sa réponse.
+    // Il peut devoir servir sans console : la fin du terminal ne l'arrête pas.
+    signal(SIGHUP, SIG_IGN);
+    close(sp[1]);
+    int ok = send_with_fd(sp[0], img, sock_ctrl) == 0 &&
+             write_all(sp[0], img + 1, n - sizeof *img) == 0;
+    free(img);
+
+    char r = 0;
+    int k = 0;
+    if(ok){
+        struct pollfd pf = { sp[0], POLLIN, 0 };
+        do k = poll(&pf, 1, HANDOFF_WAIT_MS); while(k < 0 && errno == EINTR);
+        ok = (k == 1 && read(sp[0], &r, 1) == 1 && r == 'R');
+    }
+    close(sp[0]);
+
+    if(ok){
+        upgraded_to = self;
+        return 0;
+    }
+
+    // Nouveau binaire en échec (sorti, ou bloqué : arrêté) : le relais reprend le service
+    if(k == 0) kill(self, SIGKILL);
+#ifdef __linux__
+    if(sig_watch()<0) perror("signalfd");
+    if(NP) (void)prctl(PR_SET_CHILD_SUBREAPER, 1);
+#endif
+    fprintf(stderr, "[Serveur] le nouveau binaire a échoué : le service continue dans le processus %d, "
+                    "sans console (arrêt : kill -TERM %d).\n", (int)getpid(), (int)getpid());
     return -1;
 }
 
+/*
+    Côté successeur : reçoit sock_ctrl et la table de l'ancien serveur et ré-adopte
+    ses workers et groupes. Retourne le nombre de groupes repris, -1 en cas d'échec
+    (l'ancien serveur reprend alors le service).
+*/
+static int handoff_recv(int hfd){
+    StateHdr h;
+    int fd;
+    if(recv_with_fd(hfd, &h, &fd) < 0 || fd < 0) return -1;
+
+    if(!state_same_conf(&h)){
+        fprintf(stderr, "[Serveur] passation refusée : configuration différente (MAX_GROUPS, ports, workers).\n");
+        close(fd);
+        return -1;
+    }
+
+    size_t n = state_image_size();
+    StateHdr *img = (StateHdr*)malloc(n);
+    if(!img || read_all(hfd, img + 1, n - sizeof h) < 0){
+        free(img);
+        close(fd);
+        return -1;
+    }
+    *img = h;
+
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    sock_ctrl = fd;
+    int k = state_adopt(img);
+    free(img);
+    return k;
+}
+
+/* Traite un /upgrade en attente (boucle principale, hors de tout autre traitement) */
+static void upgrade_poll(void){
+    if(!upgrade_req) return;
+    upgrade_req = 0;
+
+    fprintf(stderr, "[Serveur] mise à jour vers %s…\n", upgrade_bin);
+    if(upgrade_run(upgrade_bin) < 0){
+        fprintf(stderr, "[Serveur] mise à jour échouée, le serveur actuel continue.\n");
+        return;
+    }
+
+    // Le successeur tient désormais le fichier d'état : on s'en détache sans y écrire
+    if(st_hdr){
+        munmap(st_hdr, st_size);
+        st_hdr = NULL;
+    }
+    detach = 1;
+    running = 0;
+}
+
+/* ───────────────────────── Helpers groupes ───────────────────────── */
+
+/* Recherche l’index d’un groupe par nom (index de hachage). Retourne -1 si absent. */
+static int find_group_by_name(const char *name){
+    int pos = name_idx_pos(name);
+    return pos < 0 ? -1 : name_idx[pos].idx;
+}
+
 /* Retourne un slot libre dans la table groups (ou -1 si plein). */
 static int find_free_slot(void){
     for(unsigned i=0;i<GMAX;i++){
@@ -199,6 +1225,8 @@ static int find_free_slot(void){
       - port : port UDP du groupe
       - idle_sec : timeout d’inactivité transmis au groupe
       - outpid : PID du processus enfant
+    Les tailles de tables (MAX_MEMBERS / MAX_BANS / HISTORY_LEN) et le journal (GROUP_LOG_*) sont
+    pris dans gconf ; l'adresse locale du serveur (local_srv) est passée pour les GSTAT.
 */
 static int spawn_group(const char *name, uint16_t port, unsigned idle_sec, pid_t *outpid){
     pid_t p = fork();
@@ -206,11 +1234,19 @@ static int spawn_group(const char *name, uint16_t port, unsigned idle_sec, pid_t
 
     if(p==0){
         // Processus enfant : exécute GroupeISY
-        char pstr[16], tstr[16];
+        char pstr[16], tstr[16], mstr[16], bstr[16], sport[16], sip[INET_ADDRSTRLEN], hstr[16], lstr[16];
         snprintf(pstr,sizeof pstr,"%u",(unsigned)port);
         snprintf(tstr,sizeof tstr,"%u",(unsigned)idle_sec);
+        snprintf(mstr,sizeof mstr,"%u",gconf.max_members);
+        snprintf(bstr,sizeof bstr,"%u",gconf.max_bans);
+        snprintf(sport,sizeof sport,"%u",(unsigned)ntohs(local_srv.sin_port));
+        inet_ntop(AF_INET, &local_srv.sin_addr, sip, sizeof sip);
+        snprintf(hstr,sizeof hstr,"%u",gconf.history_len);
+        snprintf(lstr,sizeof lstr,"%u",gconf.log_segment_mb);
 
-        execl("./GroupeISY","GroupeISY",name,pstr,tstr,(char*)NULL);
+        child_prepare();
+        execl("./GroupeISY","GroupeISY",name,pstr,tstr,mstr,bstr,sport,sip,hstr,
+              gconf.log_dir[0] ? gconf.log_dir : "-",lstr,(char*)NULL);
 
         // Si execl échoue, on sort immédiatement (127 = convention)
         _exit(127);
@@ -222,27 +1258,416 @@ static int spawn_group(const char *name, uint16_t port, unsigned idle_sec, pid_t
 }
 
 /*
-    Envoie un message (payload) à tous les groupes actifs.
-    Exemple : diffusion d’une bannière ou d’un SYS.
+    Socket de contrôle d'un enfant (worker ou réserve) : UDP 127.0.0.1:0, hérité par
+    l'enfant (pas de FD_CLOEXEC) ; son adresse est rendue dans a.
 */
-static void broadcast_to_groups(const char *payload){
-    for(unsigned i=0;i<GMAX;i++){
-        if(!groups[i].used) continue;
-
-        (void)sendto(sock_ctrl, payload, strlen(payload), 0,
-                     (struct sockaddr*)&groups[i].addr, sizeof groups[i].addr);
+static int child_ctrl_socket(struct sockaddr_in *a){
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd<0) return -1;
+
+    memset(a, 0, sizeof *a);
+    a->sin_family = AF_INET;
+    a->sin_port   = 0;
+    inet_pton(AF_INET, "127.0.0.1", &a->sin_addr);
+
+    socklen_t al = sizeof *a;
+    if(bind(fd, (struct sockaddr*)a, sizeof *a)<0 ||
+       getsockname(fd, (struct sockaddr*)a, &al)<0){
+        close(fd);
+        return -1;
     }
+    return fd;
 }
 
-/* ───────────────────────── Token generator ───────────────────────── */
 /*
-    Génère un token "admin" côté serveur.
-    - Utilise /dev/urandom si disponible (préféré)
-    - Sinon, fallback sur time + pid
-    Format choisi : hex, pratique à copier-coller.
+    Lance un worker GroupeISY (mode GROUP_WORKERS).
+    - Le socket de contrôle (UDP 127.0.0.1:0) est créé ici et hérité par le worker
+      (pas de FD_CLOEXEC) : le serveur n'en garde que l'adresse, obtenue par getsockname().
+    - L'adresse locale du serveur (local_srv) est passée en argument : le worker
+      n'accepte d'ADDGROUP que d'elle.
+    Retour : 0 si OK, -1 sinon.
 */
-static void gen_token(char out[ADMIN_TOKEN_LEN]){
-    unsigned char rnd[16];
+static int spawn_worker(WorkerRec *w){
+    struct sockaddr_in a;
+    int fd = child_ctrl_socket(&a);
+    if(fd<0) return -1;
+
+    pid_t p = fork();
+    if(p<0){
+        close(fd);
+        return -1;
+    }
+
+    if(p==0){
+        // Processus enfant : exécute GroupeISY en mode worker
+        char fstr[16], mstr[16], bstr[16], xstr[16], hstr[16], lstr[16], sport[16], sip[INET_ADDRSTRLEN];
+        snprintf(fstr,sizeof fstr,"%d",fd);
+        snprintf(mstr,sizeof mstr,"%u",gconf.max_members);
+        snprintf(bstr,sizeof bstr,"%u",gconf.max_bans);
+        snprintf(xstr,sizeof xstr,"%u",(unsigned)gconf.mux_port);
+        snprintf(hstr,sizeof hstr,"%u",gconf.history_len);
+        snprintf(lstr,sizeof lstr,"%u",gconf.log_segment_mb);
+        snprintf(sport,sizeof sport,"%u",(unsigned)ntohs(local_srv.sin_port));
+        inet_ntop(AF_INET, &local_srv.sin_addr, sip, sizeof sip);
+
+        child_prepare();
+        execl("./GroupeISY","GroupeISY","--worker",fstr,mstr,bstr,xstr,hstr,
+              gconf.log_dir[0] ? gconf.log_dir : "-",lstr,sport,sip,(char*)NULL);
+        _exit(127);
+    }
+
+    // Processus parent : le socket appartient désormais au worker
+    close(fd);
+    w->pid = p;
+    w->pidfd = child_watch(p);
+    w->start = proc_start(p);
+    w->adopted = 0;
+    w->addr = a;
+    w->ngroups = 0;
+    return 0;
+}
+
+/*
+    Réserve sous Linux : un lanceur (processus auxiliaire forké à la première
+    demande, quand le serveur est encore petit) fait seul les fork + exec des
+    GroupeISY --pool. Le serveur lui écrit un octet par processus voulu sur une
+    socketpair et reçoit un PoolMsg par processus lancé (pid <= 0 : échec) dans sa
+    boucle epoll : il ne forke plus, la réserve se complète aussi sous charge.
+    Chaque processus est lancé par un intermédiaire qui sort aussitôt : orphelin,
+    il revient au serveur (child subreaper) et reste son enfant comme avant
+    (SIGCHLD, waitpid, pidfd).
+*/
+typedef struct {
+    pid_t pid;
+    uint64_t start;
+    struct sockaddr_in addr;
+} PoolMsg;
+
+#ifdef __linux__
+#define SPAWN_DELAY_US 1000         // avant chaque lancement : le client qu'on vient de servir passe d'abord
+static int spawner_fd = -1;         // côté serveur de la socketpair (-1 : pas de lanceur)
+static pid_t spawner_pid = -1;
+static unsigned pool_asked = 0;     // processus demandés au lanceur, pas encore reçus
+#endif
+
+/*
+    Lance un processus de réserve (GroupeISY --pool) : mêmes paramètres qu'un groupe
+    classique, sauf le nom, le port et le timeout, donnés plus tard par CTRL ASSIGN.
+    owner : pid du serveur, auquel le processus sera rattaché.
+*/
+static int spawn_pool(PoolMsg *r, pid_t owner){
+    struct sockaddr_in a;
+    int fd = child_ctrl_socket(&a);
+    if(fd<0) return -1;
+
+    pid_t p = fork();
+    if(p<0){
+        close(fd);
+        return -1;
+    }
+
+    if(p==0){
+        char fstr[16], mstr[16], bstr[16], sport[16], sip[INET_ADDRSTRLEN], hstr[16], lstr[16], ostr[16];
+        snprintf(fstr,sizeof fstr,"%d",fd);
+        snprintf(mstr,sizeof mstr,"%u",gconf.max_members);
+        snprintf(bstr,sizeof bstr,"%u",gconf.max_bans);
+        snprintf(sport,sizeof sport,"%u",(unsigned)ntohs(local_srv.sin_port));
+        inet_ntop(AF_INET, &local_srv.sin_addr, sip, sizeof sip);
+        snprintf(hstr,sizeof hstr,"%u",gconf.history_len);
+        snprintf(lstr,sizeof lstr,"%u",gconf.log_segment_mb);
+        snprintf(ostr,sizeof ostr,"%d",(int)owner);
+
+        child_prepare();
+        execl("./GroupeISY","GroupeISY","--pool",fstr,mstr,bstr,sport,sip,hstr,
+              gconf.log_dir[0] ? gconf.log_dir : "-",lstr,ostr,(char*)NULL);
+        _exit(127);
+    }
+
+    close(fd);
+    r->pid = p;
+    r->start = proc_start(p);
+    r->addr = a;
+    return 0;
+}
+
+#ifdef __linux__
+/*
+    Boucle du lanceur : une demande (octet) => un intermédiaire lance le processus,
+    note son PoolMsg en mémoire partagée et sort ; le lanceur l'attend (le processus
+    est alors rattaché au serveur) puis répond. Fin du serveur (EOF) => fin.
+*/
+static void spawner_loop(int fd){
+    pid_t owner = getppid();
+    PoolMsg *m = (PoolMsg*)mmap(NULL, sizeof *m, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(m == MAP_FAILED) _exit(1);
+
+    for(;;){
+        char c;
+        ssize_t k = read(fd, &c, 1);
+        if(k < 0 && errno == EINTR) continue;
+        if(k <= 0) _exit(0);
+
+        usleep(SPAWN_DELAY_US);
+        memset(m, 0, sizeof *m);
+        m->pid = -1;
+        pid_t mid = fork();
+        if(mid == 0) _exit(spawn_pool(m, owner) < 0);
+        if(mid > 0){
+            int st;
+            while(waitpid(mid, &st, 0) < 0 && errno == EINTR) {}
+        }
+        if(write_all(fd, m, sizeof *m) < 0) _exit(0);
+    }
+}
+
+/* Démarre le lanceur (socketpair + fork) ; sa réponse est lue par la boucle epoll */
+static int spawner_start(void){
+    int sp[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sp) < 0) return -1;
+
+    pid_t p = fork();
+    if(p < 0){
+        close(sp[0]);
+        close(sp[1]);
+        return -1;
+    }
+    if(p == 0){
+        // Le lanceur ne sert rien : il lâche le port de contrôle et la boucle du serveur
+        close(sp[0]);
+        if(sock_ctrl >= 0) close(sock_ctrl);
+        close(ev_fd);
+        close(sig_fd);
+        spawner_loop(sp[1]);
+    }
+
+    close(sp[1]);
+    if(ev_add(sp[0], EV_TAG(EV_SPAWN, 0)) < 0){
+        close(sp[0]);
+        kill(p, SIGKILL);
+        waitpid(p, NULL, 0);
+        return -1;
+    }
+    spawner_fd = sp[0];
+    spawner_pid = p;
+    pool_asked = 0;
+    return 0;
+}
+
+/*
+    Arrête le lanceur : plus de demandes, les réponses encore en route sont lues
+    (processus arrêtés aussitôt), puis il sort sur EOF.
+*/
+static void spawner_stop(void){
+    if(spawner_fd < 0) return;
+    shutdown(spawner_fd, SHUT_WR);
+
+    PoolMsg m;
+    while(read_all(spawner_fd, &m, sizeof m) == 0){
+        if(m.pid <= 0) continue;
+        kill(m.pid, SIGTERM);
+        waitpid(m.pid, NULL, 0);
+    }
+    epoll_ctl(ev_fd, EPOLL_CTL_DEL, spawner_fd, NULL);
+    close(spawner_fd);
+    waitpid(spawner_pid, NULL, 0);
+    spawner_fd = -1;
+    spawner_pid = -1;
+    pool_asked = 0;
+}
+
+/*
+    Lanceur lisible (boucle epoll) : un processus lancé entre dans une place vide
+    de la réserve. Échec de lancement => remplissage différé (pool_hold) ; fin du
+    lanceur => relancé au prochain remplissage.
+*/
+static void pool_collect(void){
+    PoolMsg m;
+    if(read_all(spawner_fd, &m, sizeof m) < 0){
+        fprintf(stderr, "[Serveur] lanceur de la réserve arrêté, relancé dans 1 s.\n");
+        epoll_ctl(ev_fd, EPOLL_CTL_DEL, spawner_fd, NULL);
+        close(spawner_fd);
+        waitpid(spawner_pid, NULL, 0);
+        spawner_fd = -1;
+        spawner_pid = -1;
+        pool_asked = 0;
+        pool_hold = time(NULL) + 1;
+        return;
+    }
+    if(pool_asked) pool_asked--;
+    if(m.pid <= 0){
+        pool_hold = time(NULL) + 1;
+        return;
+    }
+
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid > 0) continue;
+        pool[k].pid = m.pid;
+        pool[k].start = m.start;
+        pool[k].addr = m.addr;
+        pool[k].seq = ++pool_seq;
+        pool[k].pidfd = child_watch(m.pid);
+        return;
+    }
+    kill(m.pid, SIGTERM);   // réserve déjà pleine
+    waitpid(m.pid, NULL, 0);
+}
+#endif
+
+/*
+    Prend un processus de réserve pour un CREATE : le plus ancien, un processus
+    qui vient d'arriver n'a peut-être pas fini son exec. Retourne son index, ou -1
+    si la réserve est vide (le CREATE repasse alors par spawn_group).
+*/
+static int pool_take(void){
+    int best = -1;
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid>0 && (best<0 || pool[k].seq < pool[best].seq)) best = (int)k;
+    }
+    return best;
+}
+
+/* Places vides dans la réserve */
+static unsigned pool_missing(void){
+    unsigned n = 0;
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid<=0) n++;
+    }
+    return n;
+}
+
+/*
+    Complète la réserve. Linux : demande au lanceur les processus manquants (pas
+    d'attente, appelée à chaque tour de boucle). Ailleurs : un fork + exec par
+    appel, quand la boucle est au repos. Retourne 1 s'il reste des places à remplir.
+*/
+static int pool_refill(void){
+    if(!NP || time(NULL) < pool_hold) return 0;
+
+#ifdef __linux__
+    if(spawner_fd < 0 && spawner_start() < 0){
+        perror("pool spawner");
+        pool_hold = time(NULL) + 1;
+        return 0;
+    }
+    unsigned want = pool_missing();
+    if(want > pool_asked){
+        char req[MAX_POOL];
+        memset(req, 0, sizeof req);
+        if(write_all(spawner_fd, req, want - pool_asked) == 0) pool_asked = want;
+    }
+    return 0;
+#else
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid>0) continue;
+        PoolMsg m;
+        if(spawn_pool(&m, getpid())<0){
+            pool[k].pid = -1;
+            pool_hold = time(NULL) + 1;
+            return 0;
+        }
+        pool[k].pid = m.pid;
+        pool[k].start = m.start;
+        pool[k].addr = m.addr;
+        pool[k].seq = ++pool_seq;
+        pool[k].pidfd = child_watch(m.pid);
+        break;
+    }
+    return pool_missing() > 0;
+#endif
+}
+
+/* Arrêt du serveur : les processus de réserve (sans groupe) s'arrêtent avec lui */
+static void pool_stop(void){
+#ifdef __linux__
+    spawner_stop();
+#endif
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid>0) kill(pool[k].pid, SIGTERM);
+    }
+    for(unsigned k=0;k<NP;k++){
+        if(pool[k].pid<=0) continue;
+        int st;
+        waitpid(pool[k].pid, &st, 0);
+        if(pool[k].pidfd>=0) close(pool[k].pidfd);
+        pool[k].pidfd = -1;
+        pool[k].pid = -1;
+    }
+}
+
+/* Worker vivant le moins chargé (ou -1 si aucun) */
+static int pick_worker(void){
+    int best = -1;
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pid <= 0) continue;
+        if(best<0 || workers[w].ngroups < workers[best].ngroups) best = (int)w;
+    }
+    return best;
+}
+
+/* Retrouve le worker émetteur d'un datagramme (GONE), ou -1 */
+static int worker_by_addr(const struct sockaddr_in *a){
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pid > 0 &&
+           workers[w].addr.sin_port == a->sin_port &&
+           workers[w].addr.sin_addr.s_addr == a->sin_addr.s_addr) return (int)w;
+    }
+    return -1;
+}
+
+/*
+    Réponse positive à CREATE / JOIN pour le groupe i :
+      - "OK <group> <port> [token]"              (un port par groupe)
+      - "OK <group> <port> <token|-> @<gid>"     (mono-port, CREATE)
+      - "OK <group> <port> @<gid>"               (mono-port, JOIN)
+    with_token : 1 pour CREATE (token renvoyé s'il existe).
+*/
+static void fmt_ok_reply(char *out, size_t n, unsigned i, int with_token){
+    const GroupRec *g = &groups[i];
+    int len = snprintf(out, n, "OK %s %u", g->name, (unsigned)g->port);
+
+    if(with_token && (g->admin_token[0] || g->gid>=0))
+        len += snprintf(out+len, n-(size_t)len, " %s", g->admin_token[0] ? g->admin_token : "-");
+    if(g->gid>=0)
+        snprintf(out+len, n-(size_t)len, " %c%d", ISY_MUX_TAG, g->gid);
+}
+
+/*
+    Envoie un datagramme au groupe i par son canal admin local.
+    En mono-port, le datagramme est préfixé par le gid du groupe.
+*/
+static void send_to_group(unsigned i, const char *payload){
+    char out[1200];
+    const char *p = payload;
+
+    if(groups[i].gid>=0){
+        snprintf(out,sizeof out,"%c%d %s", ISY_MUX_TAG, groups[i].gid, payload);
+        p = out;
+    }
+
+    (void)sendto(sock_ctrl, p, strlen(p), 0,
+                 (struct sockaddr*)&groups[i].addr, sizeof groups[i].addr);
+}
+
+/*
+    Envoie un message (payload) à tous les groupes actifs.
+    Exemple : diffusion d’une bannière ou d’un SYS.
+*/
+static void broadcast_to_groups(const char *payload){
+    for(unsigned i=0;i<GMAX;i++){
+        if(!groups[i].used) continue;
+        send_to_group(i, payload);
+    }
+}
+
+/* ───────────────────────── Token generator ───────────────────────── */
+/*
+    Génère un token "admin" côté serveur.
+    - Utilise /dev/urandom si disponible (préféré)
+    - Sinon, fallback sur time + pid
+    Format choisi : hex, pratique à copier-coller.
+*/
+static void gen_token(char out[ADMIN_TOKEN_LEN]){
+    unsigned char rnd[16];
 
     int fd = open("/dev/urandom", O_RDONLY);
     if(fd >= 0){
@@ -266,13 +1691,137 @@ static void gen_token(char out[ADMIN_TOKEN_LEN]){
     snprintf(out, ADMIN_TOKEN_LEN, "%08lx%08lx", a, b);
 }
 
-/* ───────────────────────── Thread input admin ───────────────────────── */
+/* ───────────────────────── Console admin ───────────────────────── */
+
+/* Aide affichée au démarrage du serveur */
+static void admin_help(void){
+    fprintf(stderr,
+        "[Serveur] Commandes admin:\n"
+        "  /banner <txt>     -> bannière serveur (tous les groupes)\n"
+        "  /banner_clr       -> retire bannière serveur\n"
+        "  /sys <txt>        -> message SYS (tous les groupes)\n"
+        "  /history <g> <n>  -> messages rejoués à l'arrivée dans le groupe g\n"
+        "  /list             -> liste groupes actifs\n"
+        "  /detach           -> arrêter le serveur, groupes conservés (STATE_FILE ; SIGTERM aussi)\n"
+        "  /upgrade [bin]    -> passer la main à un nouveau binaire sans coupure (défaut : lui-même)\n"
+        "  /quit             -> arrêter le serveur (Ctrl-C aussi)\n"
+    );
+}
+
 /*
-    Thread console :
-      - Lit stdin du serveur
+    Une ligne de la console (stdin du serveur) :
       - Envoie des commandes "CTRL" à tous les groupes
       - Affiche /list pour debug
       - /quit pour stopper proprement
+*/
+static void admin_line(char *line){
+    trimnl(line);
+
+    if(!strncmp(line,"/banner ",8)){
+        char out[1100];
+        snprintf(out,sizeof out,"CTRL BANNER_SET %s", line+8);
+        broadcast_to_groups(out);
+        fprintf(stderr,"[Serveur] Banner SET broadcast.\n");
+
+    }else if(!strcmp(line,"/banner_clr")){
+        broadcast_to_groups("CTRL BANNER_CLR");
+        fprintf(stderr,"[Serveur] Banner CLR broadcast.\n");
+
+    }else if(!strncmp(line,"/sys ",5)){
+        char out[1100];
+        snprintf(out,sizeof out,"SYS %s", line+5);
+        broadcast_to_groups(out);
+        fprintf(stderr,"[Serveur] SYS broadcast.\n");
+
+    }else if(!strncmp(line,"/history ",9)){
+        char gname[32]={0};
+        unsigned n=0;
+        int i = -1;
+        if(sscanf(line+9,"%31s %u",gname,&n)==2) i = find_group_by_name(gname);
+        if(i>=0){
+            char out[64];
+            snprintf(out,sizeof out,ISY_CTRL_HISTORY " %u", n);
+            send_to_group((unsigned)i, out);
+            fprintf(stderr,"[Serveur] Historique de %s -> %u.\n", gname, n);
+        }else{
+            fprintf(stderr,"[Serveur] Usage: /history <groupe> <n> (groupe existant)\n");
+        }
+
+    }else if(!strcmp(line,"/list")){
+        fprintf(stderr,"[Serveur] Groupes actifs:\n");
+        for(unsigned i=0;i<GMAX;i++){
+            if(groups[i].used){
+                fprintf(stderr,"  - %s  %u  (%s=%d) token=%s\n",
+                        groups[i].name,
+                        (unsigned)groups[i].port,
+                        groups[i].worker>=0 ? "worker" : "pid",
+                        (int)groups[i].pid,
+                        groups[i].admin_token[0] ? groups[i].admin_token : "(none)");
+            }
+        }
+
+    }else if(!strcmp(line,"/detach")){
+        if(gconf.state_file[0]){
+            detach = 1;
+            running = 0;
+        }else{
+            fprintf(stderr,"[Serveur] /detach : STATE_FILE absent de la configuration.\n");
+        }
+
+    }else if(!strcmp(line,"/upgrade") || !strncmp(line,"/upgrade ",9)){
+        const char *bin = line[8] ? line + 9 : srv_argv[0];
+        snprintf(upgrade_bin, sizeof upgrade_bin, "%s", bin);
+        upgrade_req = 1;
+
+    }else if(!strcmp(line,"/quit")){
+        running = 0;
+
+    }else if(line[0]){
+        fprintf(stderr,"[Serveur] Commandes: /banner <txt> | /banner_clr | /sys <txt> | /history <g> <n> | /list | /detach | /upgrade [bin] | /quit\n");
+    }
+}
+
+#ifdef __linux__
+/*
+    stdin lisible (boucle epoll) : lit ce qui est disponible et traite chaque ligne
+    complète. Une ligne plus longue que le tampon est traitée telle quelle.
+    Retourne 0 à la fin de stdin (la console se tait, le serveur continue).
+*/
+static int admin_read(void){
+    static char cin[1024];
+    static size_t clen = 0;
+
+    ssize_t n = read(STDIN_FILENO, cin + clen, sizeof cin - 1 - clen);
+    if(n < 0){
+        if(errno == EINTR || errno == EAGAIN) return 1;
+        // terminal repris par le shell (processus détaché de son job, EIO)
+        fprintf(stderr, "[Serveur] console perdue (%s) : arrêt par kill -TERM %d.\n", strerror(errno), (int)getpid());
+        return 0;
+    }
+    if(n == 0) return 0;
+    clen += (size_t)n;
+
+    char *start = cin;
+    for(;;){
+        char *nl = memchr(start, '\n', clen - (size_t)(start - cin));
+        if(!nl) break;
+        *nl = '\0';
+        admin_line(start);
+        start = nl + 1;
+    }
+
+    clen -= (size_t)(start - cin);
+    memmove(cin, start, clen);
+    if(clen == sizeof cin - 1){
+        cin[clen] = '\0';
+        admin_line(cin);
+        clen = 0;
+    }
+    return 1;
+}
+#else
+/*
+    Thread console (hors Linux) : lit stdin ligne à ligne.
     Note : on active l’annulation pthread_cancel pour pouvoir tuer le thread au shutdown.
 */
 static void *admin_input_thread(void *arg){
@@ -282,59 +1831,720 @@ static void *admin_input_thread(void *arg){
     pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
-    // Affiche une aide au démarrage du serveur
-    fprintf(stderr,
-        "[Serveur] Commandes admin:\n"
-        "  /banner <txt>     -> bannière serveur (tous les groupes)\n"
-        "  /banner_clr       -> retire bannière serveur\n"
-        "  /sys <txt>        -> message SYS (tous les groupes)\n"
-        "  /list             -> liste groupes actifs\n"
-        "  /quit             -> arrêter le serveur (Ctrl-C aussi)\n"
-    );
-
     char line[1024];
-
     while(running && fgets(line,sizeof line, stdin)){
-        trimnl(line);
-
-        if(!strncmp(line,"/banner ",8)){
-            char out[1100];
-            snprintf(out,sizeof out,"CTRL BANNER_SET %s", line+8);
-            broadcast_to_groups(out);
-            fprintf(stderr,"[Serveur] Banner SET broadcast.\n");
-
-        }else if(!strcmp(line,"/banner_clr")){
-            broadcast_to_groups("CTRL BANNER_CLR");
-            fprintf(stderr,"[Serveur] Banner CLR broadcast.\n");
-
-        }else if(!strncmp(line,"/sys ",5)){
-            char out[1100];
-            snprintf(out,sizeof out,"SYS %s", line+5);
-            broadcast_to_groups(out);
-            fprintf(stderr,"[Serveur] SYS broadcast.\n");
-
-        }else if(!strcmp(line,"/list")){
-            fprintf(stderr,"[Serveur] Groupes actifs:\n");
-            for(unsigned i=0;i<GMAX;i++){
-                if(groups[i].used){
-                    fprintf(stderr,"  - %s  %u  (pid=%d) token=%s\n",
-                            groups[i].name,
-                            (unsigned)groups[i].port,
-                            (int)groups[i].pid,
-                            groups[i].admin_token[0] ? groups[i].admin_token : "(none)");
+        admin_line(line);
+    }
+    return NULL;
+}
+#endif
+
+/* ───────────────────────── Requêtes clients ───────────────────────── */
+/*
+    Émetteur d'une requête : adresse + format de la requête reçue.
+    La réponse est renvoyée dans le même format (bin = 1 => trame binaire).
+*/
+typedef struct {
+    struct sockaddr_in addr;
+    socklen_t len;
+    int bin;
+} Peer;
+
+static void peer_send(const Peer *p, const void *buf, size_t n){
+    if(n) (void)sendto(sock_ctrl, buf, n, 0, (const struct sockaddr*)&p->addr, p->len);
+}
+
+/* Réponse libre : ligne texte, encapsulée (TEXT) pour un client binaire */
+static void reply_text(const Peer *p, const char *txt){
+    if(p->bin){
+        uint8_t fr[ISY_BIN_MAX];
+        peer_send(p, fr, isy_bin_text(fr, sizeof fr, ISY_BIN_NOGID, txt));
+    }else{
+        peer_send(p, txt, strlen(txt));
+    }
+}
+
+/* "ERR <reason>" ou trame ERR */
+static void reply_err(const Peer *p, const char *reason){
+    if(p->bin){
+        uint8_t fr[ISY_BIN_MAX];
+        ISYWr w;
+        isy_bin_begin(&w, fr, sizeof fr, ISY_OP_ERR, 0, ISY_BIN_NOGID, 0);
+        isy_bin_cstr(&w, reason);
+        peer_send(p, fr, isy_bin_end(&w));
+    }else{
+        char out[128];
+        snprintf(out, sizeof out, "ERR %s", reason);
+        peer_send(p, out, strlen(out));
+    }
+}
+
+/* Réponse positive à CREATE / JOIN pour le groupe i (voir fmt_ok_reply) */
+static void reply_ok(const Peer *p, unsigned i, int with_token){
+    if(p->bin){
+        const GroupRec *g = &groups[i];
+        uint8_t fr[ISY_BIN_MAX];
+        ISYWr w;
+        isy_bin_begin(&w, fr, sizeof fr, ISY_OP_OK, 0,
+                      g->gid>=0 ? (uint32_t)g->gid : ISY_BIN_NOGID, 0);
+        isy_bin_cstr(&w, g->name);
+        isy_bin_u16(&w, g->port);
+        isy_bin_cstr(&w, with_token ? g->admin_token : "");
+        peer_send(p, fr, isy_bin_end(&w));
+    }else{
+        char out[256];
+        fmt_ok_reply(out, sizeof out, i, with_token);
+        peer_send(p, out, strlen(out));
+    }
+}
+
+/* ───────────────────────── Démarrage des groupes (READY) ───────────────────────── */
+/*
+    Un groupe qui démarre (fork + exec, réserve, ADDGROUP) n'a pas encore lié son
+    socket : un client qui recevrait tout de suite le port pourrait y envoyer son
+    premier datagramme dans le vide. Les réponses CREATE/JOIN sont donc retenues ici
+    jusqu'au "READY <nom>" du groupe, sans bloquer la boucle : ready_poll les envoie
+    au READY, en ERR si le groupe a disparu entre-temps, ou à l'échéance READY_WAIT_MS
+    (groupe qui n'annonce rien : réponse comme avant). La table grandit avec les
+    rafales de CREATE ; si elle ne peut pas grandir, "ERR busy" (à redemander)
+    plutôt qu'un port pas encore ouvert.
+*/
+#define PEND_INIT     256    // taille initiale de pend[] (doublée à la demande)
+#define READY_WAIT_MS 1000   // délai max avant de répondre sans READY
+
+typedef struct {
+    Peer peer;
+    unsigned slot;
+    unsigned gen;          // groups[slot].gen à la mise en attente
+    int with_token;
+    uint64_t until;        // échéance (ms, horloge monotone)
+} PendRec;
+
+static PendRec *pend = NULL;
+static unsigned npend = 0, cap_pend = 0;
+static unsigned long pend_late = 0;    // réponses parties à l'échéance, sans READY
+static unsigned long pend_busy = 0;    // "ERR busy" : pend[] n'a pas pu grandir
+
+static uint64_t mono_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/* Réponse OK au CREATE/JOIN du groupe i : tout de suite s'il est prêt, sinon au READY */
+static void reply_ready(const Peer *p, unsigned i, int with_token){
+    if(groups[i].ready){
+        reply_ok(p, i, with_token);
+        return;
+    }
+    if(npend == cap_pend){
+        unsigned ncap = cap_pend ? cap_pend * 2 : PEND_INIT;
+        PendRec *np = (PendRec*)realloc(pend, ncap * sizeof *pend);
+        if(!np){
+            pend_busy++;
+            reply_err(p, "busy");
+            return;
+        }
+        pend = np;
+        cap_pend = ncap;
+    }
+    PendRec *e = &pend[npend++];
+    e->peer = *p;
+    e->slot = i;
+    e->gen = groups[i].gen;
+    e->with_token = with_token;
+    e->until = mono_ms() + READY_WAIT_MS;
+}
+
+/*
+    Envoie les réponses dont le groupe est prêt, disparu ou en retard. Retourne le
+    délai (ms) jusqu'à la prochaine échéance, -1 si plus rien n'attend.
+*/
+static int ready_poll(void){
+    uint64_t now = mono_ms();
+    int next = -1;
+
+    for(unsigned k=0;k<npend;){
+        PendRec *e = &pend[k];
+        const GroupRec *g = &groups[e->slot];
+
+        if(!g->used || g->gen != e->gen){
+            reply_err(&e->peer, "spawn");
+        }else if(g->ready){
+            reply_ok(&e->peer, e->slot, e->with_token);
+        }else if(now >= e->until){
+            pend_late++;
+            reply_ok(&e->peer, e->slot, e->with_token);
+        }else{
+            int left = (int)(e->until - now);
+            if(next < 0 || left < next) next = left;
+            k++;
+            continue;
+        }
+        pend[k] = pend[--npend];
+    }
+    return next;
+}
+
+/* Arrêt en laissant tourner les groupes (/detach, /upgrade) : répondre sans attendre */
+static void ready_flush(void){
+    for(unsigned k=0;k<npend;k++){
+        const PendRec *e = &pend[k];
+        if(groups[e->slot].used && groups[e->slot].gen == e->gen)
+            reply_ok(&e->peer, e->slot, e->with_token);
+    }
+    npend = 0;
+}
+
+/* GONE <name> (worker -> serveur) : accepté uniquement depuis le socket de contrôle d'un worker */
+static void srv_gone(const Peer *p, const char *name){
+    int w = worker_by_addr(&p->addr);
+    if(w<0) return;
+
+    int idx = find_group_by_name(name);
+    if(idx>=0 && groups[idx].worker==w){
+        group_release((unsigned)idx);
+        if(workers[w].ngroups) workers[w].ngroups--;
+    }
+}
+
+/*
+    Annonce d'un groupe (GSTAT, READY) : acceptée du worker qui l'héberge, ou du
+    processus GroupeISY dédié (depuis son propre port, en local). Retourne le slot
+    du groupe, -1 si l'émetteur ne correspond pas.
+*/
+static int group_by_sender(const Peer *p, const char *name){
+    int idx = find_group_by_name(name);
+    if(idx<0) return -1;
+
+    int w = worker_by_addr(&p->addr);
+    if(w>=0 ? groups[idx].worker!=w
+            : (groups[idx].worker>=0 || ntohs(p->addr.sin_port)!=groups[idx].port ||
+               p->addr.sin_addr.s_addr!=local_srv.sin_addr.s_addr)) return -1;
+    return idx;
+}
+
+/* GSTAT <name> <members> : nombre de membres du groupe (LIST +members) */
+static void srv_gstat(const Peer *p, const char *name, unsigned members){
+    int idx = group_by_sender(p, name);
+    if(idx<0) return;
+
+    if(groups[idx].members != members){
+        groups[idx].members = members;
+        dir_invalidate(1);
+        state_put((unsigned)idx);
+    }
+}
+
+/* READY <name> (groupe -> serveur) : socket du groupe lié, réponses en attente envoyées */
+static void srv_ready(const Peer *p, const char *name){
+    int idx = group_by_sender(p, name);
+    if(idx<0 || groups[idx].ready) return;
+
+    groups[idx].ready = 1;
+    (void)ready_poll();
+}
+
+/*
+    LIST [cursor] [+members] : une page de l'annuaire (memcpy du blob), suivie de
+    "#more=<cursor>\n" s'il en reste ; "(aucun)\n" si la page est vide.
+    En binaire : trame LISTR, cursor suivant dans seq et flag ISY_LF_MORE.
+*/
+static void srv_list(const Peer *p, unsigned cursor, int members){
+    const DirBlob *d = dir_get(p->bin, members);
+    if(!d){
+        reply_err(p, "nomem");
+        return;
+    }
+
+    unsigned k0, k1;
+    unsigned next = dir_page(d, cursor, &k0, &k1);
+    size_t len = d->off[k1] - d->off[k0];
+
+    if(p->bin){
+        uint8_t fr[ISY_BIN_HDR + ISY_LIST_PAGE + DIR_ENTRY_MAX];
+        uint8_t flags = (uint8_t)((members ? ISY_LF_MEMBERS : 0) | (next ? ISY_LF_MORE : 0));
+        ISYWr w;
+        isy_bin_begin(&w, fr, sizeof fr, ISY_OP_LISTR, flags, ISY_BIN_NOGID, next);
+        memcpy(fr + w.off, d->buf + d->off[k0], len);
+        w.off += len;
+        peer_send(p, fr, isy_bin_end(&w));
+        return;
+    }
+
+    char out[ISY_LIST_PAGE + DIR_ENTRY_MAX + 32];
+    if(len == 0){
+        peer_send(p, "(aucun)\n", 8);
+        return;
+    }
+    memcpy(out, d->buf + d->off[k0], len);
+    if(next) len += (size_t)snprintf(out + len, sizeof out - len, ISY_LIST_MORE "%u\n", next);
+    peer_send(p, out, len);
+}
+
+/* CREATE <name> [user] : user vide => création "legacy" sans token admin */
+static void srv_create(const Peer *p, const char *gname, const char *user){
+    // Si le groupe existe déjà : renvoyer le port (et le token si existant)
+    int idx = find_group_by_name(gname);
+    if(idx>=0){
+        reply_ready(p, (unsigned)idx, 1);
+        return;
+    }
+
+    // Cherche un slot libre
+    int freei = find_free_slot();
+    if(freei<0){
+        reply_err(p, "no_slot");
+        return;
+    }
+
+    // Port attribué = base_port + index du slot (mono-port : port commun, gid = index du slot)
+    uint16_t port = gconf.mux_port ? gconf.mux_port : gconf.base_port + (uint16_t)freei;
+    int gid = gconf.mux_port ? freei : -1;
+
+    /*
+        Héberge le groupe :
+          - mode workers : ADDGROUP au worker le moins chargé (pas de fork)
+          - sinon (ou si aucun worker vivant) : processus GroupeISY dédié
+            (impossible en mono-port : seul le worker sert le port commun)
+    */
+    pid_t pid;
+    int pidfd = -1;
+    uint64_t start = 0;
+    int w = pick_worker();
+    int k = (w<0 && gid<0) ? pool_take() : -1;
+    if(k>=0){
+        // Processus de réserve : déjà lancé et surveillé, il reçoit son groupe
+        char ctrl[128];
+        snprintf(ctrl,sizeof ctrl,ISY_CTRL_ASSIGN " %s %u %u",
+                 gname, (unsigned)port, gconf.idle_timeout);
+        sendto(sock_ctrl,ctrl,strlen(ctrl),0,
+               (struct sockaddr*)&pool[k].addr, sizeof pool[k].addr);
+
+        pid = pool[k].pid;
+        pidfd = pool[k].pidfd;
+        start = pool[k].start;
+        pool[k].pid = -1;
+        pool[k].pidfd = -1;
+    }else if(w>=0){
+        char ctrl[128];
+        if(gid>=0){
+            snprintf(ctrl,sizeof ctrl,ISY_CTRL_ADDGROUP " %s 0 %u %d",
+                     gname, gconf.idle_timeout, gid);
+        }else{
+            snprintf(ctrl,sizeof ctrl,ISY_CTRL_ADDGROUP " %s %u %u",
+                     gname, (unsigned)port, gconf.idle_timeout);
+        }
+        sendto(sock_ctrl,ctrl,strlen(ctrl),0,
+               (struct sockaddr*)&workers[w].addr, sizeof workers[w].addr);
+
+        pid = workers[w].pid;
+        workers[w].ngroups++;
+    }else if(gid>=0 || spawn_group(gname, port, gconf.idle_timeout, &pid)<0){
+        reply_err(p, "spawn");
+        return;
+    }else{
+        pidfd = child_watch(pid);
+        start = proc_start(pid);
+    }
+
+    // Remplit le slot groupe (un processus dédié est surveillé par son pidfd)
+    dir_invalidate(0);
+    groups[freei].used = 1;
+    groups[freei].members = 0;
+    groups[freei].pid  = pid;
+    groups[freei].pidfd = pidfd;
+    groups[freei].worker = w;
+    groups[freei].start = (w<0) ? start : workers[w].start;
+    groups[freei].adopted = 0;
+    groups[freei].ready = 0;
+    groups[freei].gid  = gid;
+    groups[freei].port = port;
+    strncpy(groups[freei].name, gname, NAME_LEN-1);
+    groups[freei].name[NAME_LEN-1] = '\0';
+    name_idx_insert((unsigned)freei);
+
+    // Canal admin local vers le groupe : 127.0.0.1:port
+    memset(&groups[freei].addr,0,sizeof groups[freei].addr);
+    groups[freei].addr.sin_family = AF_INET;
+    groups[freei].addr.sin_port   = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &groups[freei].addr.sin_addr);
+
+    // Token admin uniquement si le client fournit un "user" (création via client moderne)
+    // sinon : compatibilité / création "legacy" sans admin
+    groups[freei].admin_token[0] = '\0';
+    if(user[0]) gen_token(groups[freei].admin_token);
+    state_put((unsigned)freei);
+
+    // Réponse au READY du groupe (socket lié)
+    reply_ready(p, (unsigned)freei, 1);
+}
+
+/* JOIN <name> : renvoie le port du groupe (et son gid en mono-port) */
+static void srv_join(const Peer *p, const char *gname){
+    int idx = find_group_by_name(gname);
+    if(idx<0){
+        reply_err(p, "notfound");
+        return;
+    }
+    reply_ready(p, (unsigned)idx, 0);
+}
+
+/*
+    LOOKUP <name> : port du groupe (et gid en mono-port), sans pseudo.
+      texte   : "OK <name> <port> [@<gid>]" ou "ERR notfound"
+      binaire : OK / ERR
+    Comme pour JOIN, la réponse attend le READY d'un groupe qui démarre (reply_ready).
+*/
+static void srv_lookup(const Peer *p, const char *gname){
+    int idx = find_group_by_name(gname);
+    if(idx<0){
+        reply_err(p, "notfound");
+        return;
+    }
+    reply_ready(p, (unsigned)idx, 0);
+}
+
+/* MERGE : le groupe B redirige ses clients vers A (les deux tokens admin sont exigés) */
+static void srv_merge(const Peer *p, const char *user,
+                      const char *tokA, const char *gA, const char *tokB, const char *gB){
+    // Les deux groupes doivent exister
+    int iA = find_group_by_name(gA);
+    int iB = find_group_by_name(gB);
+    if(iA<0 || iB<0){
+        reply_err(p, "notfound");
+        return;
+    }
+
+    // Les deux groupes doivent avoir un token défini
+    if(!groups[iA].admin_token[0] || !groups[iB].admin_token[0]){
+        reply_err(p, "no_token");
+        return;
+    }
+
+    // Vérification des tokens
+    if(strcmp(groups[iA].admin_token, tokA)!=0 || strcmp(groups[iB].admin_token, tokB)!=0){
+        reply_err(p, "bad_token");
+        return;
+    }
+
+    /*
+        Fusion : on demande au groupe B de rediriger ses clients vers A.
+        Note : ici, la "fusion" est logique (redirect), pas un transfert complet d’historique.
+    */
+    char ctrl[512];
+    if(groups[iA].gid>=0){
+        snprintf(ctrl, sizeof ctrl, "CTRL REDIRECT %s %u %c%d merge",
+                 groups[iA].name, (unsigned)groups[iA].port, ISY_MUX_TAG, groups[iA].gid);
+    }else{
+        snprintf(ctrl, sizeof ctrl, "CTRL REDIRECT %s %u merge",
+                 groups[iA].name, (unsigned)groups[iA].port);
+    }
+
+    send_to_group((unsigned)iB, ctrl);
+
+    // Message "visible" à tous les groupes pour informer de l’action
+    char sysmsg[512];
+    snprintf(sysmsg, sizeof sysmsg, "SYS [Fusion] %s a fusionne %s -> %s",
+             user, groups[iB].name, groups[iA].name);
+    broadcast_to_groups(sysmsg);
+
+    // Réponse au client demandeur
+    char out[256];
+    snprintf(out, sizeof out, "OK MERGE %s %s", groups[iA].name, groups[iB].name);
+    reply_text(p, out);
+}
+
+/* Requête texte (buf terminé par '\0') : cascade historique de préfixes */
+static void dispatch_text(char *buf, const Peer *p){
+    /* ───────── GONE <name> (worker -> serveur) ───────── */
+    if(!strncmp(buf,ISY_WORKER_GONE " ",5)){
+        srv_gone(p, buf+5);
+        return;
+    }
+
+    /* ───────── READY <name> (groupe -> serveur) ───────── */
+    if(!strncmp(buf,ISY_GROUP_READY " ",6)){
+        char gname[NAME_LEN]={0};
+        if(sscanf(buf+6,"%31s", gname)==1) srv_ready(p, gname);
+        return;
+    }
+
+    /* ───────── GSTAT <name> <members> (groupe -> serveur) ───────── */
+    if(!strncmp(buf,ISY_GROUP_STAT " ",6)){
+        char gname[NAME_LEN]={0};
+        unsigned m=0;
+        if(sscanf(buf+6,"%31s %u", gname, &m)==2) srv_gstat(p, gname, m);
+        return;
+    }
+
+    /* ───────── LIST [cursor] [+members] ───────── */
+    if(!strncmp(buf,"LIST",4)){
+        unsigned cursor = 0;
+        int members = 0;
+        char *save = NULL;
+        for(char *t = strtok_r(buf+4, " \r\n", &save); t; t = strtok_r(NULL, " \r\n", &save)){
+            if(!strcmp(t, ISY_LIST_MEMBERS)) members = 1;
+            else cursor = (unsigned)strtoul(t, NULL, 10);
+        }
+        srv_list(p, cursor, members);
+        return;
+    }
+
+    /* ───────── CREATE <name> [user] ───────── */
+    if(!strncmp(buf,"CREATE ",7)){
+        char gname[NAME_LEN]={0};
+        char user[EME_LEN]={0};
+
+        // CREATE <group> <user> (user optionnel)
+        if(sscanf(buf+7,"%31s %19s", gname, user) < 1) return;
+        srv_create(p, gname, user);
+        return;
+    }
+
+    /* ───────── JOIN <name> <user> <cip> <cport> ───────── */
+    if(!strncmp(buf,"JOIN ",5)){
+        char gname[NAME_LEN]={0}, user[EME_LEN]={0}, cip[64]={0};
+        unsigned cport=0;
+
+        // cip/cport peuvent être ignorés (UDP, on récupère l’adresse via recvfrom côté groupe)
+        if(sscanf(buf+5,"%31s %19s %63s %u", gname, user, cip, &cport) < 2) return;
+        srv_join(p, gname);
+        return;
+    }
+
+    /* ───────── LOOKUP <name> ───────── */
+    if(!strncmp(buf,ISY_CMD_LOOKUP " ",7)){
+        char gname[NAME_LEN]={0};
+        if(sscanf(buf+7,"%31s", gname) != 1){
+            reply_err(p, "bad_args");
+            return;
+        }
+        srv_lookup(p, gname);
+        return;
+    }
+
+    /* ───────── MERGE <user> <tokenA> <groupA> <tokenB> <groupB> ───────── */
+    if(!strncmp(buf,"MERGE ",6)){
+        char user[EME_LEN]={0};
+        char tokA[ADMIN_TOKEN_LEN]={0}, tokB[ADMIN_TOKEN_LEN]={0};
+        char gA[NAME_LEN]={0}, gB[NAME_LEN]={0};
+
+        // On vérifie la syntaxe exacte
+        if(sscanf(buf+6, "%19s %63s %31s %63s %31s", user, tokA, gA, tokB, gB) != 5){
+            reply_err(p, "merge_syntax");
+            return;
+        }
+        srv_merge(p, user, tokA, gA, tokB, gB);
+        return;
+    }
+
+    /* ───────── Commande inconnue ───────── */
+    reply_err(p, "unknown_cmd");
+}
+
+/* Un champ binaire utilisé comme mot du protocole texte : non vide, sans blanc */
+static int is_word(const char *s){
+    if(!*s) return 0;
+    for(; *s; s++) if(isspace((unsigned char)*s)) return 0;
+    return 1;
+}
+
+/* Trame binaire v1 : saut direct sur l'opcode, champs lus par longueur */
+static void dispatch_bin(const ISYHdr *h, ISYRd *r, const Peer *p){
+    char gname[NAME_LEN], user[EME_LEN];
+
+    switch(h->op){
+    case ISY_OP_LIST:
+        srv_list(p, h->seq, (h->flags & ISY_LF_MEMBERS) != 0);
+        return;
+
+    case ISY_OP_CREATE:
+        if(isy_rd_cstr(r, gname, sizeof gname) < 0 || isy_rd_cstr(r, user, sizeof user) < 0 ||
+           !is_word(gname) || (user[0] && !is_word(user))){
+            reply_err(p, "bad_args");
+            return;
+        }
+        srv_create(p, gname, user);
+        return;
+
+    case ISY_OP_JOIN:
+        if(isy_rd_cstr(r, gname, sizeof gname) < 0 || isy_rd_cstr(r, user, sizeof user) < 0 ||
+           !is_word(gname)){
+            reply_err(p, "bad_args");
+            return;
+        }
+        srv_join(p, gname);
+        return;
+
+    case ISY_OP_LOOKUP:
+        if(isy_rd_cstr(r, gname, sizeof gname) < 0 || !is_word(gname)){
+            reply_err(p, "bad_args");
+            return;
+        }
+        srv_lookup(p, gname);
+        return;
+
+    case ISY_OP_MERGE: {
+        char tokA[ADMIN_TOKEN_LEN], tokB[ADMIN_TOKEN_LEN], gA[NAME_LEN], gB[NAME_LEN];
+        if(isy_rd_cstr(r, user, sizeof user) < 0 ||
+           isy_rd_cstr(r, tokA, sizeof tokA) < 0 || isy_rd_cstr(r, gA, sizeof gA) < 0 ||
+           isy_rd_cstr(r, tokB, sizeof tokB) < 0 || isy_rd_cstr(r, gB, sizeof gB) < 0){
+            reply_err(p, "merge_syntax");
+            return;
+        }
+        srv_merge(p, user, tokA, gA, tokB, gB);
+        return;
+    }
+
+    default:
+        reply_err(p, "unknown_cmd");
+        return;
+    }
+}
+
+/*
+    Un datagramme reçu sur sock_ctrl.
+    Aiguillage par format : une trame binaire commence par ISY_BIN_MAGIC,
+    tout le reste est une ligne texte. Une trame de version inconnue reçoit
+    une erreur texte : le client repasse alors en texte.
+*/
+static void handle_request(char *buf, size_t n, const struct sockaddr_in *cli, socklen_t cl){
+    Peer p;
+    p.addr = *cli;
+    p.len  = cl;
+
+    ISYHdr h;
+    ISYRd  r;
+    int k = isy_bin_parse(buf, n, &h, &r);
+
+    p.bin = (k > 0);
+    if(k > 0){
+        dispatch_bin(&h, &r, &p);
+    }else if(k < 0){
+        reply_err(&p, "bad_version");
+    }else{
+        buf[n]='\0';
+        dispatch_text(buf, &p);
+    }
+}
+
+#ifdef __linux__
+#define CTRL_RECV_BURST 64   // requêtes lues par réveil sur sock_ctrl
+
+/*
+    Boucle epoll : requêtes clients (par rafales), signaux, mort des enfants et
+    console admin, dans le même thread. epoll_wait sans timeout : aucun réveil
+    périodique, le serveur au repos ne consomme rien.
+*/
+static void serve_events(void){
+    char buf[1024];
+    struct epoll_event evs[16];
+
+    while(running){
+        /*
+            Réserve incomplète : demandes au lanceur (sans attente), dès qu'aucune
+            réponse CREATE/JOIN n'attend son READY (le groupe qui démarre garde le
+            CPU). Après un échec de lancement, réessai dans 1 s.
+        */
+        if(!npend) (void)pool_refill();
+        int tmo = -1;
+        if(pool_missing() > pool_asked && time(NULL) < pool_hold) tmo = 1000;
+
+        // Réponses CREATE/JOIN en attente : réveil à la prochaine échéance
+        int rt = npend ? ready_poll() : -1;
+        if(rt >= 0 && (tmo < 0 || rt < tmo)) tmo = rt;
+
+        int ne = epoll_wait(ev_fd, evs, 16, tmo);
+        if(ne<0){
+            if(errno==EINTR) continue;
+            die_perror("epoll_wait");
+        }
+        if(ne==0) continue;
+
+        for(int i=0;i<ne && running;i++){
+            uint64_t tag = evs[i].data.u64;
+
+            switch((int)(tag >> 32)){
+            case EV_CTRL:
+                for(int k=0;k<CTRL_RECV_BURST;k++){
+                    struct sockaddr_in cli;
+                    socklen_t cl=sizeof cli;
+
+                    ssize_t n = recvfrom(sock_ctrl, buf, sizeof buf -1, MSG_DONTWAIT,
+                                         (struct sockaddr*)&cli, &cl);
+                    if(n<0) break;
+                    handle_request(buf, (size_t)n, &cli, cl);
+                }
+                break;
+
+            case EV_SIGNAL: {
+                struct signalfd_siginfo si;
+                while(read(sig_fd, &si, sizeof si) == (ssize_t)sizeof si){
+                    if(si.ssi_signo == SIGCHLD){
+                        child_reap_unwatched();
+                        adopt_poll();
+                        continue;
+                    }
+                    if(si.ssi_signo == SIGTERM && gconf.state_file[0]) detach = 1;
+                    running = 0;
                 }
+                break;
             }
 
-        }else if(!strcmp(line,"/quit")){
-            running = 0;
-            break;
+            case EV_STDIN:
+                if(!admin_read()) epoll_ctl(ev_fd, EPOLL_CTL_DEL, STDIN_FILENO, NULL);
+                break;
+
+            case EV_CHILD:
+                child_reap((pid_t)(uint32_t)tag);
+                break;
 
-        }else if(line[0]){
-            fprintf(stderr,"[Serveur] Commandes: /banner <txt> | /banner_clr | /sys <txt> | /list | /quit\n");
+            case EV_SPAWN:
+                pool_collect();
+                break;
+            }
         }
+        upgrade_poll();
     }
+}
+#endif
 
-    return NULL;
+/* Crée sock_ctrl et le lie sur SERVER_IP:SERVER_PORT (adresse liée dans srv) */
+static void ctrl_open(struct sockaddr_in *srv){
+    // Socket UDP de contrôle (clients <-> serveur), non hérité par les groupes
+    sock_ctrl = socket(AF_INET, SOCK_DGRAM, 0);
+    if(sock_ctrl<0) die_perror("socket");
+    (void)fcntl(sock_ctrl, F_SETFD, FD_CLOEXEC);
+
+    // Permet de relancer rapidement le serveur
+    int yes=1;
+    (void)setsockopt(sock_ctrl, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+
+#ifndef __linux__
+    /*
+        Fix important pour Ctrl-C :
+        - recvfrom() est bloquant, donc sans timeout la boucle ne peut pas voir running=0.
+        - On ajoute un SO_RCVTIMEO => toutes les 300ms, recvfrom() se réveille.
+    */
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = 300000; // 300ms
+    (void)setsockopt(sock_ctrl, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+#endif
+
+    // Bind sur SERVER_IP:SERVER_PORT
+    memset(srv, 0, sizeof *srv);
+    srv->sin_family = AF_INET;
+    srv->sin_port   = htons(gconf.server_port);
+
+    if(!strcmp(gconf.bind_ip,"0.0.0.0")){
+        srv->sin_addr.s_addr = htonl(INADDR_ANY);
+    }else{
+        if(inet_pton(AF_INET, gconf.bind_ip, &srv->sin_addr)!=1) die_perror("inet_pton bind");
+    }
+
+    if(bind(sock_ctrl, (struct sockaddr*)srv, sizeof *srv)<0) die_perror("bind server");
 }
 
 /* ───────────────────────── Main ───────────────────────── */
@@ -343,64 +2553,131 @@ int main(int argc, char **argv){
         fprintf(stderr,"Usage: %s conf/server.conf\n", argv[0]);
         return 1;
     }
+    srv_argv = argv;
+
+    // Nouveau binaire d'un /upgrade : socket de passation et pid du relais de l'ancien serveur
+    int handoff_fd = -1;
+    if(argc>=4 && !strcmp(argv[2],"--handoff")){
+        handoff_fd = atoi(argv[3]);
+        if(argc>=5) drain_pid = (pid_t)atoi(argv[4]);
+    }
 
     // Lecture config serveur (serveur.conf)
     if(load_server_conf(argv[1], &gconf)<0) die_perror("server conf");
 
+#ifdef __linux__
+    // epoll + signalfd, avant tout fork (voir ev_init)
+    ev_init();
+#else
     // Handlers simples (portables) : stop / nettoyage enfants
     signal(SIGINT,  on_sigint);
     signal(SIGTERM, on_sigint);
     signal(SIGCHLD, on_sigchld);
+#endif
 
     // Alloue la table de groupes
     GMAX = gconf.max_groups;
     groups = (GroupRec*)calloc(GMAX, sizeof *groups);
-    if(!groups){
+    if(!groups || name_idx_init()<0){
         perror("calloc groups");
         return 1;
     }
 
-    // Socket UDP de contrôle (clients <-> serveur)
-    sock_ctrl = socket(AF_INET, SOCK_DGRAM, 0);
-    if(sock_ctrl<0) die_perror("socket");
-
-    // Permet de relancer rapidement le serveur
-    int yes=1;
-    (void)setsockopt(sock_ctrl, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+    for(unsigned w=0;w<MAX_WORKERS;w++) workers[w].pidfd = -1;
+    for(unsigned i=0;i<GMAX;i++) groups[i].pidfd = -1;
+    NW = gconf.group_workers;
 
     /*
-        Fix important pour Ctrl-C :
-        - recvfrom() est bloquant, donc sans timeout la boucle ne peut pas voir running=0.
-        - On ajoute un SO_RCVTIMEO => toutes les 300ms, recvfrom() se réveille.
+        Réserve : remplie par la boucle principale (pool_refill). Sous Linux, les
+        processus lancés par le lanceur auxiliaire sont rattachés au serveur.
     */
-    struct timeval tv;
-    tv.tv_sec = 0;
-    tv.tv_usec = 300000; // 300ms
-    (void)setsockopt(sock_ctrl, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    NP = gconf.pool;
+#ifdef __linux__
+    if(NP) (void)prctl(PR_SET_CHILD_SUBREAPER, 1);
+#endif
+    for(unsigned k=0;k<NP;k++){
+        pool[k].pid = -1;
+        pool[k].pidfd = -1;
+    }
 
-    // Bind sur SERVER_IP:SERVER_PORT
-    struct sockaddr_in srv={0};
-    srv.sin_family = AF_INET;
-    srv.sin_port   = htons(gconf.server_port);
+    // Passation : sock_ctrl (déjà lié, requêtes en attente) et table de l'ancien serveur
+    int handed = -1;
+    if(handoff_fd>=0){
+        handed = handoff_recv(handoff_fd);
+        if(handed<0){
+            fprintf(stderr,"[Serveur] passation impossible.\n");
+            return 1;
+        }
+    }
 
-    if(!strcmp(gconf.bind_ip,"0.0.0.0")){
-        srv.sin_addr.s_addr = htonl(INADDR_ANY);
+    struct sockaddr_in srv={0};
+    if(handed>=0){
+        socklen_t sl = sizeof srv;
+        if(getsockname(sock_ctrl, (struct sockaddr*)&srv, &sl)<0) die_perror("getsockname");
     }else{
-        if(inet_pton(AF_INET, gconf.bind_ip, &srv.sin_addr)!=1) die_perror("inet_pton bind");
+        ctrl_open(&srv);
     }
 
-    if(bind(sock_ctrl, (struct sockaddr*)&srv, sizeof srv)<0) die_perror("bind server");
+    // Adresse à laquelle les groupes locaux joignent le serveur
+    local_srv = srv;
+    if(srv.sin_addr.s_addr == htonl(INADDR_ANY)) local_srv.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /*
+        Redémarrage à chaud : reprise des workers et groupes du serveur précédent.
+        Après une passation, la table est déjà reprise : le fichier est juste réécrit.
+    */
+    if(gconf.state_file[0]){
+        int n = state_open(gconf.state_file, handed<0);
+        if(n<0) perror("state file");
+        else if(n>0) fprintf(stderr,"[Serveur] %d groupe(s) ré-adopté(s) depuis %s.\n", n, gconf.state_file);
+    }
+    if(handed>=0) fprintf(stderr,"[Serveur] passation reçue : %d groupe(s) repris.\n", handed);
+
+    // Workers multi-groupes (GROUP_WORKERS > 0), sauf ceux déjà repris
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pid>0) continue;   // ré-adopté
+        if(spawn_worker(&workers[w])<0){
+            perror("spawn worker");
+            workers[w].pid = -1;
+        }
+        state_put_worker(w);
+    }
 
-    // Démarre le thread d'input admin
+    // Console admin : stdin dans la boucle epoll (thread dédié hors Linux)
+    admin_help();
+#ifdef __linux__
+    if(ev_add(sock_ctrl, EV_TAG(EV_CTRL, 0))<0) die_perror("epoll_ctl sock_ctrl");
+    (void)ev_add(STDIN_FILENO, EV_TAG(EV_STDIN, 0));   // échoue si stdin est un fichier : pas de console
+#else
     pthread_create(&th_in, NULL, admin_input_thread, NULL);
+#endif
 
-    fprintf(stderr,"[Serveur] écoute UDP %s:%u  | groupes %u..%u  | idle=%us\n",
-            gconf.bind_ip,
-            (unsigned)gconf.server_port,
-            (unsigned)gconf.base_port,
-            (unsigned)(gconf.base_port+GMAX-1),
-            gconf.idle_timeout);
+    // Passation : sock_ctrl est servi, l'ancien serveur peut s'arrêter
+    if(handoff_fd>=0){
+        (void)write_all(handoff_fd, "R", 1);
+        close(handoff_fd);
+    }
+
+    if(gconf.mux_port){
+        fprintf(stderr,"[Serveur] écoute UDP %s:%u  | groupes mono-port %u (max %u)  | idle=%us\n",
+                gconf.bind_ip,
+                (unsigned)gconf.server_port,
+                (unsigned)gconf.mux_port,
+                GMAX,
+                gconf.idle_timeout);
+    }else{
+        fprintf(stderr,"[Serveur] écoute UDP %s:%u  | groupes %u..%u  | idle=%us | workers=%u | réserve=%u\n",
+                gconf.bind_ip,
+                (unsigned)gconf.server_port,
+                (unsigned)gconf.base_port,
+                (unsigned)(gconf.base_port+GMAX-1),
+                gconf.idle_timeout,
+                NW, NP);
+    }
 
+#ifdef __linux__
+    serve_events();
+#else
     /*
         Boucle principale UDP :
         - reçoit une commande
@@ -422,225 +2699,101 @@ int main(int argc, char **argv){
                 continue;
             }
             if(errno==EAGAIN || errno==EWOULDBLOCK){
-                // Timeout : on boucle juste pour relire running
+                // Timeout : on boucle pour relire running (groupes ré-adoptés, /upgrade)
+                adopt_poll();
+                upgrade_poll();
+                while(pool_refill()) {}
+                if(npend) (void)ready_poll();
                 continue;
             }
             die_perror("recvfrom");
         }
 
-        buf[n]='\0';
-
-        /* ───────── LIST ───────── */
-        if(!strncmp(buf,"LIST",4)){
-            char out[4096];
-            out[0]='\0';
-
-            for(unsigned i=0;i<GMAX;i++){
-                if(groups[i].used){
-                    char line[64];
-                    snprintf(line,sizeof line,"%s %u\n",
-                             groups[i].name, (unsigned)groups[i].port);
-                    strncat(out,line,sizeof out - strlen(out) - 1);
-                }
-            }
-
-            if(out[0]=='\0') strcpy(out,"(aucun)\n");
-
-            sendto(sock_ctrl,out,strlen(out),0,(struct sockaddr*)&cli,cl);
-            continue;
-        }
-
-        /* ───────── CREATE <name> [user] ───────── */
-        if(!strncmp(buf,"CREATE ",7)){
-            char gname[NAME_LEN]={0};
-            char user[EME_LEN]={0};
-
-            // CREATE <group> <user> (user optionnel)
-            int nb = sscanf(buf+7,"%31s %19s", gname, user);
-            if(nb < 1) continue;
-
-            // Si le groupe existe déjà : renvoyer le port (et le token si existant)
-            int idx = find_group_by_name(gname);
-            if(idx>=0){
-                char out[256];
-                if(groups[idx].admin_token[0]){
-                    snprintf(out,sizeof out,"OK %s %u %s",
-                             groups[idx].name,
-                             (unsigned)groups[idx].port,
-                             groups[idx].admin_token);
-                }else{
-                    snprintf(out,sizeof out,"OK %s %u",
-                             groups[idx].name,
-                             (unsigned)groups[idx].port);
-                }
-                sendto(sock_ctrl,out,strlen(out),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Cherche un slot libre
-            int freei = find_free_slot();
-            if(freei<0){
-                const char *err = "ERR no_slot";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Port attribué = base_port + index du slot
-            uint16_t port = gconf.base_port + (uint16_t)freei;
-
-            // Lance le processus GroupeISY
-            pid_t pid;
-            if(spawn_group(gname, port, gconf.idle_timeout, &pid)<0){
-                const char *err = "ERR spawn";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Remplit le slot groupe
-            groups[freei].used = 1;
-            groups[freei].pid  = pid;
-            groups[freei].port = port;
-            strncpy(groups[freei].name, gname, NAME_LEN-1);
-
-            // Canal admin local vers le groupe : 127.0.0.1:port
-            memset(&groups[freei].addr,0,sizeof groups[freei].addr);
-            groups[freei].addr.sin_family = AF_INET;
-            groups[freei].addr.sin_port   = htons(port);
-            inet_pton(AF_INET, "127.0.0.1", &groups[freei].addr.sin_addr);
-
-            // Token admin uniquement si le client fournit un "user" (création via client moderne)
-            groups[freei].admin_token[0] = '\0';
-            if(nb >= 2){
-                gen_token(groups[freei].admin_token);
-
-                char out[256];
-                snprintf(out,sizeof out,"OK %s %u %s",
-                         gname, (unsigned)port, groups[freei].admin_token);
-                sendto(sock_ctrl,out,strlen(out),0,(struct sockaddr*)&cli,cl);
-            }else{
-                // compatibilité / création "legacy" sans admin
-                char out[128];
-                snprintf(out,sizeof out,"OK %s %u",
-                         gname, (unsigned)port);
-                sendto(sock_ctrl,out,strlen(out),0,(struct sockaddr*)&cli,cl);
-            }
-
-            continue;
-        }
-
-        /* ───────── JOIN <name> <user> <cip> <cport> ───────── */
-        if(!strncmp(buf,"JOIN ",5)){
-            char gname[NAME_LEN]={0}, user[EME_LEN]={0}, cip[64]={0};
-            unsigned cport=0;
-
-            // cip/cport peuvent être ignorés (UDP, on récupère l’adresse via recvfrom côté groupe)
-            if(sscanf(buf+5,"%31s %19s %63s %u", gname, user, cip, &cport) < 2) continue;
-
-            int idx = find_group_by_name(gname);
-            if(idx<0){
-                const char *err="ERR notfound";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Renvoie le port du groupe
-            char out[128];
-            snprintf(out,sizeof out,"OK %s %u", groups[idx].name, (unsigned)groups[idx].port);
-            sendto(sock_ctrl,out,strlen(out),0,(struct sockaddr*)&cli,cl);
-            continue;
-        }
-
-        /* ───────── MERGE <user> <tokenA> <groupA> <tokenB> <groupB> ───────── */
-        if(!strncmp(buf,"MERGE ",6)){
-            char user[EME_LEN]={0};
-            char tokA[ADMIN_TOKEN_LEN]={0}, tokB[ADMIN_TOKEN_LEN]={0};
-            char gA[NAME_LEN]={0}, gB[NAME_LEN]={0};
-
-            // On vérifie la syntaxe exacte
-            if(sscanf(buf+6, "%19s %63s %31s %63s %31s", user, tokA, gA, tokB, gB) != 5){
-                const char *err="ERR merge_syntax";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Les deux groupes doivent exister
-            int iA = find_group_by_name(gA);
-            int iB = find_group_by_name(gB);
-            if(iA<0 || iB<0){
-                const char *err="ERR notfound";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Les deux groupes doivent avoir un token défini
-            if(!groups[iA].admin_token[0] || !groups[iB].admin_token[0]){
-                const char *err="ERR no_token";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            // Vérification des tokens
-            if(strcmp(groups[iA].admin_token, tokA)!=0 || strcmp(groups[iB].admin_token, tokB)!=0){
-                const char *err="ERR bad_token";
-                sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-                continue;
-            }
-
-            /*
-                Fusion : on demande au groupe B de rediriger ses clients vers A.
-                Note : ici, la "fusion" est logique (redirect), pas un transfert complet d’historique.
-            */
-            char ctrl[512];
-            snprintf(ctrl, sizeof ctrl, "CTRL REDIRECT %s %u merge",
-                     groups[iA].name, (unsigned)groups[iA].port);
-
-            sendto(sock_ctrl, ctrl, strlen(ctrl), 0,
-                   (struct sockaddr*)&groups[iB].addr, sizeof groups[iB].addr);
-
-            // Message "visible" à tous les groupes pour informer de l’action
-            char sysmsg[512];
-            snprintf(sysmsg, sizeof sysmsg, "SYS [Fusion] %s a fusionne %s -> %s",
-                     user, groups[iB].name, groups[iA].name);
-            broadcast_to_groups(sysmsg);
-
-            // Réponse au client demandeur
-            char out[256];
-            snprintf(out, sizeof out, "OK MERGE %s %s", groups[iA].name, groups[iB].name);
-            sendto(sock_ctrl,out,strlen(out),0,(struct sockaddr*)&cli,cl);
-            continue;
-        }
-
-        /* ───────── Commande inconnue ───────── */
-        {
-            const char *err="ERR unknown_cmd";
-            sendto(sock_ctrl,err,strlen(err),0,(struct sockaddr*)&cli,cl);
-        }
+        handle_request(buf, (size_t)n, &cli, cl);
+        upgrade_poll();
+        if(npend) (void)ready_poll();
     }
+#endif
 
     /* ───────────────────────── Arrêt propre ───────────────────────── */
     fprintf(stderr,"[Serveur] arrêt…\n");
 
+#ifndef __linux__
     // Stop thread admin proprement
     pthread_cancel(th_in);
     pthread_join(th_in, NULL);
+#endif
+
+    // Réserve : processus sans groupe, arrêtés dans tous les cas
+    pool_stop();
+
+    // Groupes conservés : les réponses encore en attente partent sans READY
+    if(upgraded_to || detach) ready_flush();
+    if(pend_late)
+        fprintf(stderr,"[Serveur] %lu réponse(s) CREATE/JOIN envoyée(s) sans READY (délai %d ms).\n",
+                pend_late, READY_WAIT_MS);
+    if(pend_busy)
+        fprintf(stderr,"[Serveur] %lu réponse(s) CREATE/JOIN refusée(s) (ERR busy, mémoire).\n", pend_busy);
+    free(pend);
+    pend = NULL;
+
+    if(upgraded_to){
+        // Relais d'une passation réussie : le nouveau binaire sert sock_ctrl et surveille les groupes
+        fprintf(stderr,"[Serveur] relais passé au nouveau binaire (pid %d).\n", (int)upgraded_to);
+    }else if(detach){
+        // Arrêt détaché : les groupes continuent, le prochain serveur les ré-adopte
+        fprintf(stderr,"[Serveur] groupes conservés (état dans %s).\n", gconf.state_file);
+    }else{
+        // Tuer tous les groupes encore actifs
+        for(unsigned i=0;i<GMAX;i++){
+            if(groups[i].used){
+                kill(groups[i].pid, SIGINT);
+            }
+        }
 
-    // Tuer tous les groupes encore actifs
-    for(unsigned i=0;i<GMAX;i++){
-        if(groups[i].used){
-            kill(groups[i].pid, SIGINT);
+        for(unsigned w=0;w<NW;w++){
+            if(workers[w].pid>0) kill(workers[w].pid, SIGINT);
         }
-    }
 
-    // Attendre la fin des processus enfants
-    for(unsigned i=0;i<GMAX;i++){
-        if(groups[i].used){
-            int st;
-            waitpid(groups[i].pid, &st, 0);
+        // Attendre la fin des processus (un worker peut apparaître plusieurs fois ;
+        // un processus ré-adopté n'est pas notre enfant : on attend sa disparition)
+        for(unsigned i=0;i<GMAX;i++){
+            if(groups[i].used && groups[i].worker<0){
+                int st;
+                if(waitpid(groups[i].pid, &st, 0)<0 && errno==ECHILD)
+                    while(proc_alive(groups[i].pid, groups[i].start)) usleep(10000);
+            }
+        }
+        for(unsigned w=0;w<NW;w++){
+            if(workers[w].pid>0){
+                int st;
+                if(waitpid(workers[w].pid, &st, 0)<0 && errno==ECHILD)
+                    while(proc_alive(workers[w].pid, workers[w].start)) usleep(10000);
+            }
         }
     }
+    state_close(gconf.state_file);
 
     // Libération ressources
+    for(unsigned i=0;i<GMAX;i++){
+        if(groups[i].used && groups[i].pidfd>=0) close(groups[i].pidfd);
+    }
+    for(unsigned w=0;w<NW;w++){
+        if(workers[w].pidfd>=0) close(workers[w].pidfd);
+    }
+#ifdef __linux__
+    close(sig_fd);
+    close(ev_fd);
+#endif
     if(sock_ctrl>=0) close(sock_ctrl);
+    for(int b=0;b<2;b++){
+        for(int m=0;m<2;m++){
+            free(dir[b][m].buf);
+            free(dir[b][m].off);
+            free(dir[b][m].slot);
+        }
+    }
+    free(name_idx);
     free(groups);
     return 0;
 }
@@ -17,6 +17,9 @@
       - Il ne parle pas au réseau : il communique avec ClientISY via 2 FIFOs :
           * fifo_in  : ClientISY -> AffichageISY  (événements UI à afficher)
           * fifo_out : AffichageISY -> ClientISY  (entrées clavier de l'utilisateur)
+      - Optionnel (argv[3..4], Linux) : ring SHM ISYRing + eventfd hérité.
+        ClientISY y dépose les événements sans appel système par ligne ;
+        fifo_in reste ouvert (repli, et EOF si le client meurt).
 
     Objectif :
       - Garder les bannières (admin + inactivité) "pinnées" en haut du terminal.
@@ -25,16 +28,32 @@
       - Redessiner proprement lors d'un resize (SIGWINCH).
 */
 
-#define MAX_LOG_LINES 800   // taille max de l'historique conservé
+#define LOG_LINES_DEFAULT 800     // historique conservé (UI HISTORY <n> pour changer)
+#define LOG_LINES_MAX     100000
+#define LOG_ARENA_PER_LINE 256    // octets d'arène prévus par ligne (moyenne)
 #define MAX_LINE      1024  // taille max d'une ligne UI
+#define UI_FPS_DEFAULT    30      // rendus max par seconde (UI FPS <n> pour changer)
+
+/*
+    Historique : anneau de descripteurs (log_head = plus ancienne ligne) et
+    arène de texte circulaire. Chaque ligne y est stockée d'un bloc avec son
+    '\0' ; si la fin de l'arène est trop courte, on repart au début. Ajouter
+    une ligne coûte sa copie plus l'éviction des plus anciennes qu'elle
+    recouvre : rien ne dépend de la profondeur de l'historique.
+*/
+typedef struct {
+    uint32_t off;   // position dans l'arène
+    uint32_t len;   // longueur (sans '\0')
+} LogEnt;
 
 /*
     Etat UI:
       - joined : 1 si le client est dans un groupe, sinon 0
       - user/group : affichés dans le header
       - admin_banner / idle_banner : bannières "pinnées"
-      - log[] : historique des messages à afficher
-      - dirty : 1 => nécessite redraw
+      - log / arena : historique des messages à afficher (voir LogEnt)
+      - dirty : 1 => nécessite redraw (au plus un rendu par frame_ms)
+      - urgent : 1 => redraw sans attendre la prochaine frame (saisie clavier)
       - quit  : 1 => boucle principale se termine
 */
 typedef struct {
@@ -48,10 +67,17 @@ typedef struct {
     int idle_banner_active;
     char idle_banner[TXT_LEN];
 
-    char log[MAX_LOG_LINES][MAX_LINE];
-    int  log_count;
+    LogEnt  *log;
+    unsigned log_cap;       // nombre max de lignes
+    unsigned log_head;      // indice (dans log) de la plus ancienne
+    unsigned log_count;
+    char    *arena;
+    uint32_t arena_sz;
+    uint32_t arena_w;       // prochaine écriture dans l'arène
 
     int dirty;
+    int urgent;
+    unsigned frame_ms;      // intervalle mini entre deux rendus (0 => à chaque tour)
     int quit;
 } UIState;
 
@@ -82,199 +108,412 @@ static int term_height(void){
     return 24;
 }
 
-/*
-    Renvoie le nombre de "lignes écran" consommées si on affiche s
-    avec un wrap à width.
+/* i-ème ligne du log (0 = plus ancienne) */
+static const char *log_line(const UIState *st, unsigned i){
+    return st->arena + st->log[(st->log_head + i) % st->log_cap].off;
+}
 
-    Exemple :
-      - width = 10
-      - "HelloWorld123" => 2 lignes (HelloWorld + 123)
+/*
+    Ajoute une ligne au log.
+    Si le log est plein (lignes ou arène), les plus anciennes sont oubliées.
 */
-static int wrapped_line_count(const char *s, int width){
-    if(!s || !*s) return 1;
-    if(width < 10) width = 10;
+static void add_log(UIState *st, const char *line){
+    if(!line || !st->log_cap) return;
 
-    int lines = 1;
-    int col = 0;
+    uint32_t len = (uint32_t)strnlen(line, MAX_LINE - 1);
+    uint32_t need = len + 1;
 
-    for(const char *p = s; *p; p++){
-        if(*p == '\n'){
-            lines++;
-            col = 0;
-            continue;
-        }
-        col++;
-        if(col >= width){
-            lines++;
-            col = 0;
-        }
+    // Place : à la suite, ou au début de l'arène si la fin est trop courte
+    uint32_t at = st->arena_w, span = need;
+    if(at + need > st->arena_sz){
+        span += st->arena_sz - at;
+        at = 0;
     }
-    return lines;
+
+    /*
+        Eviction des plus anciennes : les lignes présentes suivent arena_w dans
+        l'arène (ordre circulaire), on retire celles que [arena_w, at + need)
+        recouvre ainsi que celle dont le descripteur va être réutilisé.
+    */
+    while(st->log_count){
+        const LogEnt *e = &st->log[st->log_head];
+        uint32_t dist = (e->off + st->arena_sz - st->arena_w) % st->arena_sz;
+        if(st->log_count < st->log_cap && dist >= span) break;
+        st->log_head = (st->log_head + 1) % st->log_cap;
+        st->log_count--;
+    }
+
+    memcpy(st->arena + at, line, len);
+    st->arena[at + len] = '\0';
+    st->arena_w = at + need;
+
+    LogEnt *e = &st->log[(st->log_head + st->log_count) % st->log_cap];
+    e->off = at;
+    e->len = len;
+    st->log_count++;
+
+    st->dirty = 1;
 }
 
-/*
-    Affiche s avec wrap à width
-    et renvoie le nombre de lignes consommées.
+/* Efface l'historique */
+static void clear_log(UIState *st){
+    st->log_head = 0;
+    st->log_count = 0;
+    st->arena_w = 0;
+    st->dirty = 1;
+}
 
-    Remarque :
-      - On force un '\n' final si la dernière ligne n'en contient pas.
+/*
+    Change la profondeur de l'historique (UI HISTORY <n>), en gardant les
+    lignes les plus récentes. Retour 0 si OK, -1 si allocation impossible
+    (l'historique actuel est alors conservé tel quel).
 */
-static int wrap_print(const char *s, int width){
-    if(!s || !*s){
-        putchar('\n');
-        return 1;
+static int log_resize(UIState *st, unsigned cap){
+    if(cap < 1) cap = 1;
+    if(cap > LOG_LINES_MAX) cap = LOG_LINES_MAX;
+
+    uint32_t asz = (uint32_t)cap * LOG_ARENA_PER_LINE;
+    if(asz < 4 * MAX_LINE) asz = 4 * MAX_LINE;
+
+    UIState nw = *st;
+    nw.log = (LogEnt*)calloc(cap, sizeof *nw.log);
+    nw.arena = (char*)malloc(asz);
+    if(!nw.log || !nw.arena){
+        free(nw.log);
+        free(nw.arena);
+        return -1;
+    }
+    nw.log_cap = cap;
+    nw.arena_sz = asz;
+    nw.log_head = nw.log_count = 0;
+    nw.arena_w = 0;
+
+    // recopie des plus récentes (add_log évince au besoin)
+    unsigned keep = st->log_count < cap ? st->log_count : cap;
+    for(unsigned i = st->log_count - keep; i < st->log_count; i++){
+        add_log(&nw, log_line(st, i));
     }
-    if(width < 10) width = 10;
 
-    int lines = 1;
-    int col = 0;
+    free(st->log);
+    free(st->arena);
+    *st = nw;
+    st->dirty = 1;
+    return 0;
+}
 
-    for(const char *p = s; *p; p++){
-        putchar(*p);
+/*
+    Rendu différentiel
+    ──────────────────
+    On compose l'écran complet dans un Frame (une ligne terminal = une ligne
+    du Frame), puis on le compare au Frame précédemment affiché :
+      - seules les lignes qui changent sont réécrites (CUP + texte + EL) ;
+      - si la fenêtre de log n'a fait que défiler de k lignes, on la fait
+        défiler côté terminal (DECSTBM + k '\n') au lieu de tout réécrire ;
+      - tout le frame part en un seul write().
+    Le Frame précédent est invalidé (ligne à -1) quand on ne sait plus ce
+    que montre le terminal : premier rendu, resize, écho clavier.
+
+    Disposition (h lignes) :
+      bannières, header, ligne vide, log [log_top, h-3), ligne vide,
+      prompt en h-2, h-1 libre (le retour chariot de l'utilisateur y descend
+      sans faire défiler l'écran).
+*/
+typedef struct {
+    int w, h;
+    char *txt;      // h * w octets
+    int  *len;      // longueur de chaque ligne, -1 => contenu inconnu
+    int log_top;    // première ligne de la fenêtre de log
+} Frame;
 
-        if(*p == '\n'){
-            lines++;
-            col = 0;
-            continue;
-        }
+/* Tampon de sortie : tout le frame, envoyé d'un coup */
+typedef struct {
+    char  *p;
+    size_t len, cap;
+} OutBuf;
 
-        col++;
-        if(col >= width){
-            putchar('\n');
-            lines++;
-            col = 0;
-        }
-    }
+typedef struct {
+    Frame cur, prev;
+    OutBuf out;
+    int fd;                 // STDOUT_FILENO, -1 => rendu compté mais non écrit (bench)
+    int w, h;               // taille terminal courante
+    unsigned long bytes;    // octets émis depuis le début
+} Screen;
+
+static int frame_alloc(Frame *f, int w, int h){
+    free(f->txt);
+    free(f->len);
+    f->txt = (char*)malloc((size_t)w * (size_t)h);
+    f->len = (int*)malloc(sizeof(int) * (size_t)h);
+    if(!f->txt || !f->len) return -1;
+    f->w = w;
+    f->h = h;
+    f->log_top = 0;
+    for(int r = 0; r < h; r++) f->len[r] = -1;
+    return 0;
+}
 
-    if(col != 0){
-        putchar('\n');
-    }
+static int frame_same(const Frame *a, int ra, const Frame *b, int rb){
+    return a->len[ra] >= 0 && a->len[ra] == b->len[rb] &&
+           memcmp(a->txt + (size_t)ra * a->w, b->txt + (size_t)rb * b->w, (size_t)a->len[ra]) == 0;
+}
 
-    return lines;
+static void frame_copy_row(Frame *f, int dst, int src){
+    f->len[dst] = f->len[src];
+    if(f->len[src] > 0)
+        memcpy(f->txt + (size_t)dst * f->w, f->txt + (size_t)src * f->w, (size_t)f->len[src]);
 }
 
 /*
-    Ajoute une ligne au log.
-    Si le log est plein, on "scroll" (on décale tout) et on met à la fin.
+    Découpe s en lignes de w colonnes ('\n' force une nouvelle ligne) et les
+    place dans f à partir de *row (seules les lignes < lim sont écrites).
+    Avec f == NULL, compte seulement. Renvoie le nombre de lignes écran.
+
+    Exemple :
+      - w = 10
+      - "HelloWorld123" => 2 lignes (HelloWorld + 123)
 */
-static void add_log(UIState *st, const char *line){
-    if(!line) return;
+static int frame_wrap(Frame *f, int *row, int lim, int w, const char *s){
+    int lines = 0;
+    if(!s) s = "";
+
+    do{
+        size_t n = strcspn(s, "\n");
+        size_t off = 0;
+
+        do{
+            size_t k = n - off;
+            if(k > (size_t)w) k = (size_t)w;
+
+            if(f){
+                if(*row < lim){
+                    char *dst = f->txt + (size_t)(*row) * f->w;
+                    // caractères de contrôle (ESC...) neutralisés : une colonne chacun
+                    for(size_t i = 0; i < k; i++){
+                        unsigned char ch = (unsigned char)s[off + i];
+                        dst[i] = (ch < ' ' || ch == 0x7f) ? ' ' : (char)ch;
+                    }
+                    f->len[*row] = (int)k;
+                }
+                (*row)++;
+            }
+            off += k;
+            lines++;
+        }while(off < n);
 
-    if(st->log_count < MAX_LOG_LINES){
-        isy_strcpy(st->log[st->log_count], sizeof st->log[st->log_count], line);
-        st->log_count++;
-    }else{
-        for(int i=1;i<MAX_LOG_LINES;i++){
-            strcpy(st->log[i-1], st->log[i]);
-        }
-        isy_strcpy(st->log[MAX_LOG_LINES-1], sizeof st->log[MAX_LOG_LINES-1], line);
+        s += n;
+        if(*s == '\n') s++;
+    }while(*s);
+
+    return lines;
+}
+
+static void ob_put(OutBuf *o, const char *s, size_t n){
+    if(o->len + n > o->cap){
+        size_t cap = o->cap ? o->cap : 16384;
+        while(cap < o->len + n) cap *= 2;
+        char *p = (char*)realloc(o->p, cap);
+        if(!p) return;          // frame tronqué : le prochain rendu complet rattrapera
+        o->p = p;
+        o->cap = cap;
     }
+    memcpy(o->p + o->len, s, n);
+    o->len += n;
+}
 
-    st->dirty = 1;
+static void ob_printf(OutBuf *o, const char *fmt, ...){
+    char tmp[64];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof tmp, fmt, ap);
+    va_end(ap);
+    if(n > 0) ob_put(o, tmp, (size_t)n < sizeof tmp ? (size_t)n : sizeof tmp - 1);
 }
 
-/* Efface l'historique */
-static void clear_log(UIState *st){
-    st->log_count = 0;
-    st->dirty = 1;
+/* Relit la taille du terminal ; le prochain rendu repart d'un écran vide */
+static void screen_resize(Screen *sc, int w, int h){
+    if(w < 20) w = 20;
+    if(h < 10) h = 10;
+    sc->w = w;
+    sc->h = h;
+    sc->prev.w = 0;     // contenu du terminal inconnu : effacement au prochain rendu
+}
+
+/* Oublie ce que montre le terminal sur les lignes [from, to) */
+static void screen_forget(Screen *sc, int from, int to){
+    if(sc->prev.w != sc->w || sc->prev.h != sc->h) return;  // déjà à refaire entièrement
+    for(int r = from; r < to && r < sc->prev.h; r++){
+        if(r >= 0) sc->prev.len[r] = -1;
+    }
 }
 
 /*
-    redraw():
-      - Clear écran + curseur en haut
-      - Affiche les bannières "pinnées"
-      - Affiche un header (groupe / user)
-      - Affiche une fenêtre de log (les dernières lignes qui tiennent)
-      - Affiche un prompt minimal en bas
+    compose():
+      - bannières "pinnées" en haut
+      - header (groupe / user)
+      - fenêtre de log (les dernières lignes qui tiennent)
+      - prompt minimal en bas
 
     But :
       - Même si le log est énorme, les bannières restent visibles en haut.
 */
-static void redraw(UIState *st){
-    int w = term_width();
-    int h = term_height();
+static int compose(const UIState *st, Screen *sc){
+    Frame *f = &sc->cur;
+    int w = sc->w, h = sc->h;
 
-    if(w < 20) w = 20;
-    if(h < 10) h = 10;
-
-    // Clear + home (ANSI escape)
-    printf("\033[2J\033[H");
+    if(f->w != w || f->h != h){
+        if(frame_alloc(f, w, h) < 0) return -1;
+    }
+    for(int r = 0; r < h; r++) f->len[r] = 0;
 
-    int used_lines = 0;
+    int row = 0;
+    int lim = h - 3;    // ligne vide + prompt + ligne libre
+    char hdr[128];
 
     /* ───────── Bannières ───────── */
     if(st->admin_banner_active){
-        printf("=== BANNIERE ADMIN (SERVEUR) ===\n");
-        used_lines += 1;
-
-        used_lines += wrap_print(st->admin_banner, w);
-
-        putchar('\n');
-        used_lines += 1;
+        frame_wrap(f, &row, lim, w, "=== BANNIERE ADMIN (SERVEUR) ===");
+        frame_wrap(f, &row, lim, w, st->admin_banner);
+        row++;
     }
 
     if(st->idle_banner_active){
-        printf("=== BANNIERE INACTIVITE ===\n");
-        used_lines += 1;
-
-        used_lines += wrap_print(st->idle_banner, w);
-
-        putchar('\n');
-        used_lines += 1;
+        frame_wrap(f, &row, lim, w, "=== BANNIERE INACTIVITE ===");
+        frame_wrap(f, &row, lim, w, st->idle_banner);
+        row++;
     }
 
     /* ───────── Header ───────── */
     if(st->joined){
-        printf("=== GROUPE: %s | USER: %s ===\n\n", st->group, st->user);
+        snprintf(hdr, sizeof hdr, "=== GROUPE: %s | USER: %s ===", st->group, st->user);
     }else{
-        printf("=== PAS DANS UN GROUPE | USER: %s ===\n\n", st->user);
+        snprintf(hdr, sizeof hdr, "=== PAS DANS UN GROUPE | USER: %s ===", st->user);
     }
-    used_lines += 2; // header + ligne vide
-
-    /*
-        Calcul du nombre de lignes restantes pour le log.
-        On réserve 2 lignes pour un prompt minimal.
-    */
-    int reserved_for_prompt = 2;
-    int avail = h - used_lines - reserved_for_prompt;
-    if(avail < 1) avail = 1;
+    frame_wrap(f, &row, lim, w, hdr);
+    row++;  // ligne vide
 
     /*
         On veut afficher la fin du log :
           - on remonte depuis la dernière ligne
           - on cumule le nombre de lignes écran consommées (avec wrap)
-          - on s'arrête dès qu'on dépasse avail
+          - on s'arrête dès qu'on dépasse la place restante
+        Une dernière ligne trop longue pour tenir est affichée seule (tronquée).
     */
-    int start = st->log_count;
+    f->log_top = row < lim ? row : lim;
+    int avail = lim - f->log_top;
+
+    unsigned start = st->log_count;
     int acc = 0;
 
     while(start > 0){
-        const char *ln = st->log[start - 1];
-        int need = wrapped_line_count(ln, w);
-
+        int need = frame_wrap(NULL, NULL, 0, w, log_line(st, start - 1));
         if(acc + need > avail) break;
-
         acc += need;
         start--;
     }
-
-    /*
-        Cas extrême :
-          - si la dernière ligne ne tient même pas (trop longue),
-            on l'affiche quand même seule.
-    */
     if(start == st->log_count && st->log_count > 0){
         start = st->log_count - 1;
     }
 
-    /* ───────── Affichage du log ───────── */
-    for(int i = start; i < st->log_count; i++){
-        wrap_print(st->log[i], w);
+    row = f->log_top;
+    for(unsigned i = start; i < st->log_count; i++){
+        frame_wrap(f, &row, lim, w, log_line(st, i));
     }
 
     /* ───────── Prompt ───────── */
-    printf("\n> ");
-    fflush(stdout);
+    memcpy(f->txt + (size_t)(h - 2) * w, "> ", 2);
+    f->len[h - 2] = 2;
+    return 0;
+}
+
+/*
+    Défilement : si la fenêtre de log [top, lim) de cur est celle de prev
+    décalée de k lignes vers le haut, renvoie k (0 sinon).
+*/
+static int scroll_amount(const Frame *cur, const Frame *prev, int top, int lim){
+    int n = lim - top;
+    for(int k = 1; k < n; k++){
+        int r = top;
+        while(r < lim - k && frame_same(cur, r, prev, r + k)) r++;
+        if(r == lim - k) return k;
+    }
+    return 0;
+}
+
+static void screen_flush(Screen *sc){
+    size_t off = 0;
+    sc->bytes += sc->out.len;
+    while(sc->fd >= 0 && off < sc->out.len){
+        ssize_t n = write(sc->fd, sc->out.p + off, sc->out.len - off);
+        if(n < 0){
+            if(errno == EINTR) continue;
+            break;
+        }
+        off += (size_t)n;
+    }
+    sc->out.len = 0;
+}
+
+/*
+    redraw():
+      - compose le nouvel écran
+      - émet la différence avec l'écran précédent (un seul write())
+      - remet le curseur là où l'utilisateur tape (DECSC / DECRC),
+        ou après "> " si la ligne du prompt a été réécrite
+*/
+static void redraw(UIState *st, Screen *sc){
+    if(compose(st, sc) < 0) return;
+
+    Frame *cur = &sc->cur, *prev = &sc->prev;
+    OutBuf *o = &sc->out;
+    int w = sc->w, h = sc->h;
+
+    o->len = 0;
+
+    if(prev->w != w || prev->h != h){
+        // taille changée / premier rendu : écran effacé, prev = écran vide
+        if(frame_alloc(prev, w, h) < 0) return;
+        for(int r = 0; r < h; r++) prev->len[r] = 0;
+        ob_put(o, "\033[H\033[2J", 7);
+        prev->len[h - 2] = -1;  // force le prompt (et donc le placement du curseur)
+    }
+
+    int prompt_known = prev->len[h - 2] >= 0 && frame_same(cur, h - 2, prev, h - 2);
+    if(prompt_known) ob_put(o, "\0337", 2);
+
+    /* ───────── Défilement de la fenêtre de log ───────── */
+    int top = cur->log_top, lim = h - 3;
+    if(prev->log_top == top && lim - top > 1){
+        int k = scroll_amount(cur, prev, top, lim);
+        if(k > 0){
+            ob_printf(o, "\033[%d;%dr\033[%d;1H", top + 1, lim, lim);
+            for(int i = 0; i < k; i++) ob_put(o, "\n", 1);
+            ob_put(o, "\033[r", 3);
+
+            for(int r = top; r < lim - k; r++) frame_copy_row(prev, r, r + k);
+            for(int r = lim - k; r < lim; r++) prev->len[r] = 0;
+        }
+    }
+
+    /* ───────── Lignes modifiées ───────── */
+    for(int r = 0; r < h; r++){
+        if(frame_same(cur, r, prev, r)) continue;
+
+        ob_printf(o, "\033[%d;1H", r + 1);
+        ob_put(o, cur->txt + (size_t)r * w, (size_t)cur->len[r]);
+        // en fin de ligne pleine, EL effacerait la dernière colonne
+        if(cur->len[r] < w) ob_put(o, "\033[K", 3);
+    }
+
+    if(prompt_known) ob_put(o, "\0338", 2);
+    else ob_printf(o, "\033[%d;3H", h - 1);
+
+    if(o->len > (prompt_known ? 4u : 0u)) screen_flush(sc);
+    else o->len = 0;
+
+    // cur devient l'écran affiché
+    Frame t = *prev;
+    *prev = *cur;
+    *cur = t;
 
     st->dirty = 0;
 }
@@ -330,6 +569,65 @@ static int fifo_readline(int fd, char *out, size_t outsz){
     }
 }
 
+/*
+    Ring SHM (voir ISYRing dans Commun.h) : NULL si ClientISY ne l'a pas fourni.
+    ring_efd : sonnette eventfd, lisible quand le client nous a réveillés.
+*/
+static ISYRing *g_ring = NULL;
+static int ring_efd = -1;
+
+/*
+    Mappe le ring créé par ClientISY puis retire son nom (le mapping suffit).
+    En cas d'échec, on reste sur fifo_in : le client y repassera seul
+    faute de place libérée dans le ring.
+*/
+static void ring_open(const char *name, const char *efd){
+    int fd = shm_open(name, O_RDWR, 0600);
+    if(fd < 0) return;
+
+    void *p = mmap(NULL, sizeof(ISYRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    shm_unlink(name);
+    if(p == MAP_FAILED) return;
+
+    g_ring = (ISYRing*)p;
+    ring_efd = atoi(efd);
+}
+
+/*
+    Lecture d'une ligne dans le ring (recolle les cases CONT).
+    Retour :
+      1  => une ligne est disponible dans out
+      0  => ring vide pour l'instant
+*/
+static int ring_readline(ISYRing *r, char *out, size_t outsz){
+    static char part[MAX_LINE];
+    static size_t plen = 0;
+
+    uint32_t rd = __atomic_load_n(&r->ridx, __ATOMIC_RELAXED);
+
+    while(rd != __atomic_load_n(&r->widx, __ATOMIC_ACQUIRE)){
+        const ISYMsg *m = &r->ring[rd % SHM_RING_CAP];
+        int last = strncmp(m->Ordre, ISY_RING_CONT, sizeof m->Ordre) != 0;
+
+        size_t n = strnlen(m->Texte, sizeof m->Texte);
+        if(n > sizeof part - 1 - plen) n = sizeof part - 1 - plen;
+        memcpy(part + plen, m->Texte, n);
+        plen += n;
+
+        // case copiée : on la rend au producteur
+        __atomic_store_n(&r->ridx, ++rd, __ATOMIC_RELEASE);
+
+        if(last){
+            part[plen] = '\0';
+            isy_strcpy(out, outsz, part);
+            plen = 0;
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /*
     handle_ui_event():
       - parse les événements reçus depuis ClientISY via fifo_in
@@ -376,6 +674,20 @@ static void handle_ui_event(UIState *st, const char *line){
         return;
     }
 
+    // UI HISTORY <n> : profondeur de l'historique (lignes)
+    if(!strncmp(line, "UI HISTORY ", 11)){
+        long n = strtol(line + 11, NULL, 10);
+        if(n > 0) log_resize(st, (unsigned)n);
+        return;
+    }
+
+    // UI FPS <n> : rendus max par seconde (0 => rendu à chaque événement)
+    if(!strncmp(line, "UI FPS ", 7)){
+        long n = strtol(line + 7, NULL, 10);
+        if(n >= 0) st->frame_ms = n ? (unsigned)(1000 / (n > 1000 ? 1000 : n)) : 0;
+        return;
+    }
+
     // UI LOG <txt...> : ajoute une ligne au log
     if(!strncmp(line, "UI LOG ", 7)){
         add_log(st, line + 7);
@@ -422,9 +734,77 @@ static void handle_ui_event(UIState *st, const char *line){
     add_log(st, line);
 }
 
+/* Horloge monotone en ms (cadence des rendus) */
+static long mono_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+    Banc de rendu sans terminal (--bench-render) : n messages reçus, un rendu
+    par message, sortie comptée mais jamais écrite. Mode "diff" = renderer
+    courant ; mode "full" = effacement + réécriture complète à chaque rendu
+    (comportement de l'ancien redraw), pour comparaison.
+*/
+static int bench_render(unsigned n, int w, int h){
+    static const char *modes[2] = { "diff", "full" };
+    char line[MAX_LINE];
+
+    for(int m = 0; m < 2; m++){
+        UIState st;
+        Screen sc;
+        memset(&st, 0, sizeof st);
+        memset(&sc, 0, sizeof sc);
+
+        if(log_resize(&st, LOG_LINES_DEFAULT) < 0) return 1;
+        st.joined = 1;
+        isy_strcpy(st.user, sizeof st.user, "bench");
+        isy_strcpy(st.group, sizeof st.group, "BENCH");
+        st.admin_banner_active = 1;
+        isy_strcpy(st.admin_banner, sizeof st.admin_banner, "Maintenance du serveur ce soir a 22h.");
+        sc.fd = -1;
+        screen_resize(&sc, w, h);
+        redraw(&st, &sc);
+        sc.bytes = 0;
+
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+
+        for(unsigned i = 0; i < n; i++){
+            // longueurs variées : une ligne sur huit passe à la ligne
+            snprintf(line, sizeof line, "Message de user%u : message numero %u%s", i % 7, i,
+                     (i % 8) ? "" : " -- suite assez longue pour depasser la largeur du terminal et passer a la ligne");
+            add_log(&st, line);
+            if(m == 1) sc.prev.w = 0;
+            redraw(&st, &sc);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        double us = (double)(t1.tv_sec - t0.tv_sec) * 1e6 + (double)(t1.tv_nsec - t0.tv_nsec) / 1e3;
+
+        printf("render %s : %u messages, %dx%d, %.1f octets/message, %.2f us/message\n",
+               modes[m], n, w, h, (double)sc.bytes / n, us / n);
+
+        free(st.log); free(st.arena);
+        free(sc.cur.txt); free(sc.cur.len);
+        free(sc.prev.txt); free(sc.prev.len);
+        free(sc.out.p);
+    }
+    return 0;
+}
+
 int main(int argc, char **argv){
+    if(argc >= 2 && !strcmp(argv[1], "--bench-render")){
+        unsigned n = (argc >= 3) ? (unsigned)strtoul(argv[2], NULL, 10) : 100000;
+        int w = (argc >= 4) ? atoi(argv[3]) : 80;
+        int h = (argc >= 5) ? atoi(argv[4]) : 24;
+        return bench_render(n ? n : 1, w, h);
+    }
+
     if(argc < 3){
-        fprintf(stderr, "Usage: %s <fifo_in> <fifo_out>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <fifo_in> <fifo_out> [shm_ring eventfd]\n"
+                        "       %s --bench-render [messages] [colonnes] [lignes]\n", argv[0], argv[0]);
         return 1;
     }
 
@@ -450,14 +830,24 @@ int main(int argc, char **argv){
     int fd_out = open(fifo_out_path, O_WRONLY);
     if(fd_out < 0) die_perror("AffichageISY open fifo_out");
 
+    if(argc >= 5) ring_open(argv[3], argv[4]);
+
     UIState st;
     memset(&st, 0, sizeof st);
 
     isy_strcpy(st.user, sizeof st.user, "user");
+    if(log_resize(&st, LOG_LINES_DEFAULT) < 0) die_perror("AffichageISY historique");
+    st.frame_ms = 1000 / UI_FPS_DEFAULT;
     st.dirty = 1;
 
+    Screen sc;
+    memset(&sc, 0, sizeof sc);
+    sc.fd = STDOUT_FILENO;
+    screen_resize(&sc, term_width(), term_height());
+
     // Premier rendu
-    redraw(&st);
+    redraw(&st, &sc);
+    long last_draw = mono_ms();
 
     char line[MAX_LINE];
 
@@ -465,12 +855,29 @@ int main(int argc, char **argv){
         // Resize détecté ?
         if(g_winch){
             g_winch = 0;
+            screen_resize(&sc, term_width(), term_height());
             st.dirty = 1;
         }
 
-        // Rendu si nécessaire
+        /*
+            Rendu découplé de la lecture : tous les événements disponibles
+            sont appliqués à l'état, puis on dessine au plus une fois par
+            frame_ms. Une rafale de N lignes coûte donc N add_log et quelques
+            rendus, quel que soit le débit. La saisie clavier (urgent) passe
+            devant.
+        */
+        long wait_ms = 250;
         if(st.dirty){
-            redraw(&st);
+            long now = mono_ms();
+            long due = last_draw + (long)st.frame_ms;
+
+            if(st.urgent || now >= due){
+                redraw(&st, &sc);
+                st.urgent = 0;
+                last_draw = now;
+            }else{
+                wait_ms = due - now;
+            }
         }
 
         // On attend soit un event UI (fifo_in), soit une entrée clavier (stdin)
@@ -482,8 +889,25 @@ int main(int argc, char **argv){
         int maxfd = (fd_in > STDIN_FILENO) ? fd_in : STDIN_FILENO;
 
         struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 250000; // 250ms
+        tv.tv_sec = wait_ms / 1000;
+        tv.tv_usec = (wait_ms % 1000) * 1000; // 250ms, ou jusqu'à la prochaine frame
+
+        /*
+            Ring : on annonce qu'on va dormir (waiting=1) puis on relit widx.
+            Si le client a publié entre-temps, pas de sommeil ; sinon il
+            verra waiting=1 et sonnera l'eventfd.
+        */
+        if(g_ring){
+            FD_SET(ring_efd, &rfds);
+            if(ring_efd > maxfd) maxfd = ring_efd;
+
+            __atomic_store_n(&g_ring->waiting, 1, __ATOMIC_SEQ_CST);
+            if(__atomic_load_n(&g_ring->widx, __ATOMIC_SEQ_CST) !=
+               __atomic_load_n(&g_ring->ridx, __ATOMIC_RELAXED)){
+                tv.tv_sec = 0;
+                tv.tv_usec = 0;
+            }
+        }
 
         int r = select(maxfd + 1, &rfds, NULL, NULL, &tv);
         if(r < 0){
@@ -491,6 +915,22 @@ int main(int argc, char **argv){
             break;
         }
 
+        /* ───────── Events du ring SHM (avant fifo_in : ordre conservé en cas de repli) ───────── */
+        if(g_ring){
+            __atomic_store_n(&g_ring->waiting, 0, __ATOMIC_RELAXED);
+
+            if(FD_ISSET(ring_efd, &rfds)){
+                uint64_t n;
+                if(read(ring_efd, &n, sizeof n) < 0){ /* EAGAIN : déjà vidée */ }
+            }
+
+            while(!st.quit && ring_readline(g_ring, line, sizeof line) == 1){
+                handle_ui_event(&st, line);
+            }
+
+            if(__atomic_load_n(&g_ring->closed, __ATOMIC_ACQUIRE)) st.quit = 1;
+        }
+
         /* ───────── Events venant du client ───────── */
         if(FD_ISSET(fd_in, &rfds)){
             for(;;){
@@ -517,6 +957,16 @@ int main(int argc, char **argv){
             if(fgets(inbuf, sizeof inbuf, stdin)){
                 trimnl(inbuf);
 
+                /*
+                    Le terminal a fait l'écho de la saisie et du retour chariot
+                    sur le prompt et la ligne libre : on les redessine. Une saisie
+                    plus longue que la ligne a pu faire défiler tout l'écran.
+                */
+                if((int)strlen(inbuf) + 3 >= sc.w) sc.prev.w = 0;
+                else screen_forget(&sc, sc.h - 2, sc.h);
+                st.dirty = 1;
+                st.urgent = 1;
+
                 // On renvoie tel quel au client (même vide)
                 dprintf(fd_out, "%s\n", inbuf);
             }else{
@@ -526,6 +976,14 @@ int main(int argc, char **argv){
         }
     }
 
+    if(g_ring) munmap(g_ring, sizeof(ISYRing));
+    free(sc.cur.txt);
+    free(sc.cur.len);
+    free(sc.prev.txt);
+    free(sc.prev.len);
+    free(sc.out.p);
+    free(st.log);
+    free(st.arena);
     close(fd_in);
     close(fd_out);
     return 0;